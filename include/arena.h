@@ -0,0 +1,51 @@
+/*  =========================================================================
+    arena - memory arena
+
+    An arena takes memory from a backing allocator in large chunks, and
+    serves small blocks from per-size-class free lists. Released blocks are
+    recycled inside the arena, and all memory goes back to the backing
+    allocator at once when the arena is destroyed.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __ARENA_H_INCLUDED__
+#define __ARENA_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor.
+// alloc_fn and free_fn are the backing allocator with its context, or NULL
+// to use malloc and free.
+arena_t *arena_new (vrp_alloc_t alloc_fn, vrp_free_t free_fn, void *context);
+
+// Destructor. All blocks of arena are freed at once.
+void arena_free (arena_t **self_p);
+
+// Allocate a block of at least size bytes
+void *arena_alloc (arena_t *self, size_t size);
+
+// Resize a block allocated by arena.
+// If ptr is NULL, it is the same as arena_alloc ().
+void *arena_realloc (arena_t *self, void *ptr, size_t size);
+
+// Return block to the arena it was allocated from. ptr could be NULL.
+void arena_release (void *ptr);
+
+// Number of bytes taken from backing allocator
+size_t arena_reserved_size (const arena_t *self);
+
+// Number of bytes of blocks in use
+size_t arena_used_size (const arena_t *self);
+
+// Self test
+void arena_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
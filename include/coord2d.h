@@ -12,6 +12,8 @@
 extern "C" {
 #endif
 
+#define COORD2D_EARTH_RADIUS 6373.0 // km, used by haversine formula
+
 // Distance between two points under the same coordinate system
 double coord2d_distance (const coord2d_t *p1,
                          const coord2d_t *p2,
@@ -34,6 +36,16 @@ bool coord2d_is_none (const coord2d_t *point);
 int coord2d_compare_polar_angle (const coord2d_t *p1,
                                  const coord2d_t *p2);
 
+// Get indices of points in ascending order of polar angle around ref
+// (origin if NULL) into order, which should hold num indices.
+// Angles are quantized to 32-bit integers and sorted by radix sort in linear
+// time; points of equal quantized angle keep their order.
+void coord2d_sort_by_polar_angle (const coord2d_t **points,
+                                  size_t num,
+                                  const coord2d_t *ref,
+                                  coord2d_sys_t coord_sys,
+                                  size_t *order);
+
 // Generate an array of random 2D cartesian coordinates within a square.
 // Caller is responsible for freeing it after use.
 coord2d_t *coord2d_random_cartesian_range (double xmin, double xmax,
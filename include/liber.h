@@ -48,7 +48,7 @@ typedef struct {
     double v2; // y, or theta, lng
 } coord2d_t;
 
-typedef listu_t route_t;
+typedef struct _route_t route_t;
 typedef struct _solution_t solution_t;
 
 typedef enum {
@@ -67,7 +67,14 @@ typedef size_t (*vrp_arc_duration_t) (const void *model,
 
 typedef struct _vrp_t vrp_t;
 
+// Memory allocator hooks. context is the user data set along with them.
+typedef void *(*vrp_alloc_t) (void *context, size_t size);
+typedef void (*vrp_free_t) (void *context, void *ptr);
+
+typedef struct _arena_t arena_t;
+
 // Public API headers
+#include "arena.h"
 #include "coord2d.h"
 #include "route.h"
 #include "solution.h"
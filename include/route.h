@@ -2,6 +2,8 @@
     route - node sequence
 
     A route is represented by a sequence of node IDs.
+    Short routes keep their nodes in inline storage of the route object, so
+    no extra allocation is needed for them.
 
     Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
     =========================================================================
@@ -14,15 +16,30 @@
 extern "C" {
 #endif
 
+// Number of nodes stored inline in route object. Longer routes switch to
+// heap storage. Could be overridden at compile time.
+#ifndef ROUTE_INLINE_SIZE
+#define ROUTE_INLINE_SIZE 16
+#endif
 
 // Constructor
 // alloc_size is the pre-allocated length of the route,
 // or 0 to use a default value.
 route_t *route_new (size_t alloc_size);
 
+// Constructor: create route in arena.
+// Route and its node storage are taken from arena, or from heap if arena is
+// NULL. route_free () returns them to where they come from.
+route_t *route_new_in_arena (arena_t *arena, size_t alloc_size);
+
 // Constructor: create route object from node id array
 route_t *route_new_from_array (const size_t *node_ids, size_t num_nodes);
 
+// Constructor: create route object from node id array in arena
+route_t *route_new_from_array_in_arena (arena_t *arena,
+                                        const size_t *node_ids,
+                                        size_t num_nodes);
+
 // Constructor: create route object from node id list
 route_t *route_new_from_list (const listu_t *node_ids);
 
@@ -32,7 +49,7 @@ route_t *route_new_range (size_t start, size_t stop, int step);
 // Destructor
 void route_free (route_t **self_p);
 
-// Duplicator
+// Duplicator. The copy is created in the same arena (or heap) as self.
 route_t *route_dup (const route_t *self);
 
 // Matcher
@@ -23,6 +23,9 @@ typedef struct {
 // Constructor
 solution_t *solution_new ();
 
+// Constructor: create solution object in arena, or on heap if arena is NULL.
+solution_t *solution_new_in_arena (arena_t *arena);
+
 // Destructor
 void solution_free (solution_t **self_p);
 
@@ -72,7 +75,7 @@ void solution_increase_total_distance (solution_t *self, double delta_distance);
 // Get total distance
 double solution_total_distance (const solution_t *self);
 
-// Duplicator
+// Duplicator. The copy and its routes are always created on heap.
 solution_t *solution_dup (const solution_t *self);
 
 // Printer
@@ -28,6 +28,18 @@ void vrp_free (vrp_t **self_p);
 // Self test
 void vrp_test (bool verbose);
 
+// Set memory allocator of model.
+// Nodes, vehicles, requests and the per-solve arenas of solvers take memory
+// from it. Set alloc_fn and free_fn to NULL to use malloc and free (default).
+// Must be called before any node, vehicle or request is added.
+void vrp_set_allocator (vrp_t *self,
+                        vrp_alloc_t alloc_fn,
+                        vrp_free_t free_fn,
+                        void *context);
+
+// Create an arena backed by allocator of model
+arena_t *vrp_new_arena (const vrp_t *self);
+
 // ---------------------------------------------------------------------------
 // Roadgraph: nodes and arcs
 // ---------------------------------------------------------------------------
@@ -39,9 +51,73 @@ void vrp_set_coord_sys (vrp_t *self, coord2d_sys_t coord_sys);
 // Return node ID (ID_NONE if node already exists).
 size_t vrp_add_node (vrp_t *self, const char *ext_id);
 
+// Add nodes in bulk.
+// coords could be NULL. node_ids (could be NULL) receives ID of each node,
+// ID_NONE if it already exists.
+// Return number of nodes added.
+// Node IDs are indexed once at the end, which is much faster than adding
+// nodes one by one for large models.
+size_t vrp_add_nodes (vrp_t *self,
+                      const char **ext_ids,
+                      const coord2d_t *coords,
+                      size_t num_nodes,
+                      size_t *node_ids);
+
 // Set node coordinate
 void vrp_set_node_coord (vrp_t *self, size_t node_id, coord2d_t coord);
 
+// Set road network, for arcs computed by vrp_generate_road_arcs ().
+// Directed edge k goes from vertex tails[k] to vertex heads[k] (vertices are
+// 0 ~ num_vertices-1), with lengths[k] and travel_times[k]. travel_times
+// could be NULL, then durations are not generated from the network.
+void vrp_set_road_network (vrp_t *self,
+                           size_t num_vertices,
+                           const size_t *tails,
+                           const size_t *heads,
+                           const double *lengths,
+                           const double *travel_times,
+                           size_t num_edges);
+
+// Set road network vertex where node is
+void vrp_set_node_vertex (vrp_t *self, size_t node_id, size_t vertex);
+
+// Set storage mode of arc distance and duration matrices.
+// compact: distances are stored as float32 and durations as uint32, which
+// halves the memory of matrices.
+// symmetric: only one triangle of matrices is stored, and arc (i, j) shares
+// value with arc (j, i).
+// Default: not compact, not symmetric.
+// Must be called before any arc distance or duration is set.
+void vrp_set_arc_storage (vrp_t *self, bool compact, bool symmetric);
+
+// Set integer distance mode.
+// Arc distances are stored as int32 and rounded to nearest integer when set.
+// Every sum of distances is then an integer which double holds exactly, so
+// cost tracking in solvers is free of rounding drift.
+// Default: false. Must be called before any arc distance is set.
+void vrp_set_integer_distances (vrp_t *self, bool integer);
+
+// Compute arc distances on demand from node coordinates, instead of storing
+// a distance matrix. Memory is O(n), for models too large for a matrix.
+// cache_rows > 0 enables a cache of that many recently used rows per thread.
+// Durations generated by vrp_generate_durations () are then on demand too.
+// Arcs set afterwards, e.g. by vrp_update_arcs (), are kept sparsely and
+// override computed ones, as with vrp_set_sparse_arcs ().
+// Must be called before any arc distance is set.
+void vrp_set_on_demand_distances (vrp_t *self, size_t cache_rows);
+
+// Store arcs sparsely: only arcs set by vrp_set_arc_distance () and
+// vrp_set_arc_duration () are kept, typically road distances from each node
+// to its k nearest neighbours (see vrp_nearest_nodes ()) plus depot rows.
+// Other arcs fall back to on-demand beeline distance * detour_factor (>= 1),
+// and durations to distance / speed of vrp_generate_durations ().
+// cache_rows is as in vrp_set_on_demand_distances ().
+// Must be called before any arc distance or duration is set.
+void vrp_set_sparse_arcs (vrp_t *self, double detour_factor, size_t cache_rows);
+
+// Check if arc distances are integers
+bool vrp_integer_distances (const vrp_t *self);
+
 // Set arc distance
 void vrp_set_arc_distance (vrp_t *self,
                            size_t from_node_id, size_t to_node_id,
@@ -52,6 +128,43 @@ void vrp_set_arc_duration (vrp_t *self,
                            size_t from_node_id, size_t to_node_id,
                            size_t duration);
 
+// Use time-dependent arc durations: duration of each arc is given at the
+// start of num_slices time slices of slice_duration each (e.g. 96 slices of
+// 15 minutes), and interpolated linearly in between, respecting FIFO.
+// Durations then depend on departure time, see vrp_arc_duration_at ().
+void vrp_set_time_dependent_durations (vrp_t *self,
+                                       size_t num_slices,
+                                       size_t slice_duration);
+
+// Set time-dependent durations of arc: durations at start of each slice
+// (num_slices values). Values dropping faster than time passes are raised
+// to keep FIFO.
+void vrp_set_arc_durations_by_time (vrp_t *self,
+                                    size_t from_node_id,
+                                    size_t to_node_id,
+                                    const size_t *durations);
+
+// Load arc distances from binary matrix file (see vrp_save_arc_distances).
+// File is memory-mapped and its pages are used as the distance matrix
+// directly, without parsing or copying. Storage mode is taken from the file.
+// Matrix index is node ID, and matrix should cover all nodes added so far.
+// Must be called before any arc distance is set, and not with on-demand or
+// sparse arcs. If durations are already set, storage modes should agree.
+// Set arcs are counted lazily, at the first validation.
+// Return 0 if succeeded, -1 if failed.
+int vrp_load_arc_distances (vrp_t *self, const char *filename);
+
+// Load arc durations from binary matrix file. See vrp_load_arc_distances ().
+int vrp_load_arc_durations (vrp_t *self, const char *filename);
+
+// Save arc distances to binary matrix file.
+// Return 0 if succeeded, -1 if failed.
+int vrp_save_arc_distances (const vrp_t *self, const char *filename);
+
+// Save arc durations to binary matrix file.
+// Return 0 if succeeded, -1 if failed.
+int vrp_save_arc_durations (const vrp_t *self, const char *filename);
+
 // Generate straight arc distances accroding to coordinates
 void vrp_generate_beeline_distances (vrp_t *self);
 
@@ -59,6 +172,40 @@ void vrp_generate_beeline_distances (vrp_t *self);
 // Note that arc distances should already be set or generated.
 void vrp_generate_durations (vrp_t *self, double speed);
 
+// Set arcs between a node and other nodes at once, e.g. for a node added to
+// a model in progress (a new customer or a vehicle position).
+// out_distances[k] is distance from node to other_ids[k], and
+// in_distances[k] from other_ids[k] to node (NULL: same as out_distances).
+// If durations were generated by vrp_generate_durations (), they are set
+// with the same speed. Matrices grow geometrically and only the row and
+// column of node are set, so the cost is O(num_others).
+void vrp_set_node_arcs (vrp_t *self,
+                        size_t node_id,
+                        const size_t *other_ids,
+                        const double *out_distances,
+                        const double *in_distances,
+                        size_t num_others);
+
+// Generate beeline arcs between a node and all nodes, in O(n).
+// See vrp_set_node_arcs ().
+void vrp_generate_node_beeline_arcs (vrp_t *self, size_t node_id);
+
+// Generate arc distances (and durations if road network has travel times)
+// as shortest paths on road network, with one search per node in parallel.
+// Durations are travel times along shortest paths by length. With symmetric
+// arc storage, road network should be symmetric too.
+// Road network and vertices of all nodes should be set. Arcs between nodes
+// not connected by the network are not set.
+void vrp_generate_road_arcs (vrp_t *self);
+
+// Renumber rows of arc matrices in Hilbert curve order of node coordinates,
+// so that arcs between nearby nodes are near in memory. Node IDs do not
+// change: the model maps node IDs to matrix rows. Arcs already set are
+// moved, and nodes added later get the next rows.
+// Coordinates of all nodes should be set. Matrix files could not be loaded
+// or saved afterwards, as their rows are node IDs.
+void vrp_renumber_nodes_spatially (vrp_t *self);
+
 // Get coordinate system of roadgraph
 coord2d_sys_t vrp_coord_sys (vrp_t *self);
 
@@ -66,13 +213,21 @@ coord2d_sys_t vrp_coord_sys (vrp_t *self);
 // Return node ID if node exists, ID_NONE otherwise.
 size_t vrp_query_node (vrp_t *self, const char *node_ext_id);
 
+// Query nodes by external IDs at once: node_ids[k] is ID of node
+// node_ext_ids[k], or ID_NONE.
+// Return number of nodes found.
+size_t vrp_query_nodes (vrp_t *self,
+                        const char **node_ext_ids,
+                        size_t num_nodes,
+                        size_t *node_ids);
+
 // Check if node exists by id
 bool vrp_node_exists (vrp_t *self, size_t node_id);
 
 // Get external ID of node
 const char *vrp_node_ext_id (const vrp_t *self, size_t node_id);
 
-// Get node coordinate
+// Get node coordinate. The pointer is invalidated when nodes are added.
 const coord2d_t *vrp_node_coord (vrp_t *self, size_t node_id);
 
 // Get list of associated request ids
@@ -92,6 +247,76 @@ double vrp_arc_distance (const vrp_t *self, size_t from_node_id, size_t to_node_
 // The caller must ensure that arc durations are already properly set.
 size_t vrp_arc_duration (const vrp_t *self, size_t from_node_id, size_t to_node_id);
 
+// Get duration between two nodes departing at departure_time.
+// Same as vrp_arc_duration () if durations are not time-dependent, which
+// otherwise gives duration departing at time 0.
+size_t vrp_arc_duration_at (const vrp_t *self,
+                            size_t from_node_id,
+                            size_t to_node_id,
+                            size_t departure_time);
+
+// Get latest departure time from node to arrive at another node no later
+// than arrival_time
+size_t vrp_arc_latest_departure (const vrp_t *self,
+                                 size_t from_node_id,
+                                 size_t to_node_id,
+                                 size_t arrival_time);
+
+// Get IDs of (at most) k nodes nearest to a node by beeline distance, nearest
+// first, e.g. to pick arcs to query for sparse arcs. Nodes are found with a
+// spatial index of node coordinates, built on first spatial query.
+// node_ids should hold k IDs. Return number of IDs got.
+size_t vrp_nearest_nodes (vrp_t *self,
+                          size_t node_id,
+                          size_t k,
+                          size_t *node_ids);
+
+// Get up to k nodes nearest to coord into node_ids, nearest first, and
+// their straight-line distances (without detour factor) into distances if
+// it is not NULL. Nodes without coordinates are not considered.
+// Coordinate system should be set.
+// Return number of nodes found.
+size_t vrp_nearest_nodes_to_coord (vrp_t *self,
+                                   coord2d_t coord,
+                                   size_t k,
+                                   size_t *node_ids,
+                                   double *distances);
+
+// Get nodes within straight-line distance radius of coord into node_ids
+// (cleared first), in no particular order.
+// Coordinate system should be set.
+// Return number of nodes found.
+size_t vrp_nodes_within (vrp_t *self,
+                         coord2d_t coord,
+                         double radius,
+                         listu_t *node_ids);
+
+// Update distances and/or durations of a batch of arcs (from_node_ids[k],
+// to_node_ids[k]). distances or durations could be NULL to keep them.
+// Updated arcs are recorded until vrp_reevaluate_solution () or
+// vrp_clear_arc_changes () is called.
+void vrp_update_arcs (vrp_t *self,
+                      const size_t *from_node_ids,
+                      const size_t *to_node_ids,
+                      const double *distances,
+                      const size_t *durations,
+                      size_t num_arcs);
+
+// Number of arc updates recorded since last re-evaluation
+size_t vrp_num_changed_arcs (const vrp_t *self);
+
+// Forget recorded arc updates
+void vrp_clear_arc_changes (vrp_t *self);
+
+// Re-evaluate solution after arc updates: only routes using an updated arc
+// are visited. Total distance of solution is adjusted, and indices of
+// visited routes which violate time windows are appended to
+// late_route_indices (if not NULL). Recorded updates are cleared.
+// Return number of routes using updated arcs.
+size_t vrp_reevaluate_solution (vrp_t *self,
+                                solution_t *sol,
+                                listu_t *late_route_indices);
+
 // ---------------------------------------------------------------------------
 // Fleet
 // ---------------------------------------------------------------------------
@@ -105,6 +330,19 @@ size_t vrp_add_vehicle (vrp_t *self,
                         size_t start_node_id,
                         size_t end_node_id);
 
+// Add vehicles in bulk.
+// start_node_ids or end_node_ids could be NULL, which means ID_NONE for all.
+// vehicle_ids (could be NULL) receives ID of each vehicle, ID_NONE if it
+// already exists.
+// Return number of vehicles added.
+size_t vrp_add_vehicles (vrp_t *self,
+                         const char **vehicle_ext_ids,
+                         const double *max_capacities,
+                         const size_t *start_node_ids,
+                         const size_t *end_node_ids,
+                         size_t num_vehicles,
+                         size_t *vehicle_ids);
+
 // Attach a route to vehicle
 void vrp_attach_route_to_vehicle (vrp_t *self, size_t vehicle_id, size_t route_id);
 
@@ -150,6 +388,37 @@ size_t vrp_vehicle_end_node_id (vrp_t *self, size_t vehicle_id);
 // Get vehicle's route ID
 size_t vrp_vehicle_route_id (vrp_t *self, size_t vehicle_id);
 
+// Fix executed prefix of vehicle's route: stops in node_ids are visited in
+// order, and vehicle leaves the last one (its current position) at
+// departure_time. Requests received at the stops are completed and no longer
+// planned. Calling again extends the prefix.
+// Solvers keep the prefix and plan only the rest of route from the current
+// position.
+// Each stop must have exactly one pending request, which is received there.
+// The last stop could instead be a position node without pending requests,
+// e.g. a node added for GPS position of vehicle with arcs set by
+// vrp_set_node_arcs (), which is not start, end or stop of any vehicle.
+// Return 0 for success, -1 if some stop has no pending request to receive,
+// has other pending requests, or is repeated.
+int vrp_fix_route_prefix (vrp_t *self,
+                          size_t vehicle_id,
+                          const size_t *node_ids,
+                          size_t num_nodes,
+                          size_t departure_time);
+
+// Get visited stops of vehicle's fixed route prefix, or NULL
+const listu_t *vrp_vehicle_fixed_node_ids (vrp_t *self, size_t vehicle_id);
+
+// Get quantity delivered in vehicle's fixed route prefix
+double vrp_vehicle_fixed_quantity (vrp_t *self, size_t vehicle_id);
+
+// Get departure time of vehicle from its current position, or SIZE_NONE if
+// route prefix is not fixed
+size_t vrp_vehicle_departure_time (vrp_t *self, size_t vehicle_id);
+
+// Get number of vehicles with fixed route prefix
+size_t vrp_num_fixed_vehicles (vrp_t *self);
+
 // ----------------------------------------------------------------------------
 // Requests
 // ----------------------------------------------------------------------------
@@ -164,6 +433,20 @@ size_t vrp_add_request (vrp_t *self,
                         size_t receiver,
                         double quantity);
 
+// Add requests in bulk.
+// senders or receivers could be NULL, which means ID_NONE for all;
+// quantities could be NULL, which means 0 for all.
+// request_ids (could be NULL) receives ID of each request, ID_NONE if it
+// already exists.
+// Return number of requests added.
+size_t vrp_add_requests (vrp_t *self,
+                         const char **request_ext_ids,
+                         const size_t *senders,
+                         const size_t *receivers,
+                         const double *quantities,
+                         size_t num_requests,
+                         size_t *request_ids);
+
 // Add time window for sender or receiver of request.
 // Return 0 for success, -1 for failure.
 // Multiple time windows can be added by calling this one by one. But they
@@ -176,6 +459,15 @@ int vrp_add_time_window (vrp_t *self,
                          size_t earliest,
                          size_t latest);
 
+// Add time windows in bulk, for sender or receiver of each request.
+// Return number of time windows added. Overlapping ones are skipped.
+size_t vrp_add_time_windows (vrp_t *self,
+                             const size_t *request_ids,
+                             node_role_t node_role,
+                             const size_t *earliests,
+                             const size_t *latests,
+                             size_t num_time_windows);
+
 // Set service duration for sender or receiver of request.
 // Default: 0.
 void vrp_set_service_duration (vrp_t *self,
@@ -183,10 +475,39 @@ void vrp_set_service_duration (vrp_t *self,
                                node_role_t node_role,
                                size_t service_duration);
 
+// Cancel a pending request. It is no longer planned by solver.
+// Return 0 for success, -1 if request is not pending.
+int vrp_cancel_request (vrp_t *self, size_t request_id);
+
+// Remove completed and cancelled requests from model. Their IDs are no longer
+// valid.
+// Return number of requests removed.
+size_t vrp_archive_requests (vrp_t *self);
+
+// Compact a long-lived model: archive requests (see vrp_archive_requests ()),
+// remove nodes which are used by neither a pending request nor a vehicle,
+// and renumber the rest of nodes and requests with consecutive IDs in their
+// original order. Arc storage is shrunk to live nodes, and recorded arc
+// updates are cleared. IDs in solutions got before are not valid after this.
+// node_id_map and request_id_map (could be NULL) receive new ID of each old
+// ID (i.e. map[old_id]), ID_NONE for removed ones.
+// Return number of nodes kept.
+size_t vrp_compact (vrp_t *self,
+                    listu_t *node_id_map,
+                    listu_t *request_id_map);
+
 // Query a request by external ID.
 // Return request ID if request exists, ID_NONE if not.
 size_t vrp_query_request (vrp_t *self, const char *request_ext_id);
 
+// Query requests by external IDs at once: request_ids[k] is ID of request
+// request_ext_ids[k], or ID_NONE.
+// Return number of requests found.
+size_t vrp_query_requests (vrp_t *self,
+                           const char **request_ext_ids,
+                           size_t num_requests,
+                           size_t *request_ids);
+
 // Get number of requests
 size_t vrp_num_requests (vrp_t* self);
 
@@ -248,11 +569,13 @@ size_t vrp_service_duration (vrp_t *self,
                              size_t request_id,
                              node_role_t node_role);
 
-// Get time windows list representation (read only).
-// Format of list: (earliest_tw1, latest_tw1, earliest_tw2, latest_tw2, ...)
-const listu_t *vrp_time_windows (vrp_t *self,
-                                 size_t request_id,
-                                 node_role_t node_role);
+// Get time windows array representation (read only), of
+// 2 * vrp_num_time_windows () values:
+// (earliest_tw1, latest_tw1, earliest_tw2, latest_tw2, ...)
+// The array is invalidated when time windows or requests are added.
+const size_t *vrp_time_windows (vrp_t *self,
+                                size_t request_id,
+                                node_role_t node_role);
 
 // Check if pickup or delivery time windows are equal for two requests
 bool vrp_time_windows_are_equal (vrp_t *self,
@@ -263,9 +586,40 @@ bool vrp_time_windows_are_equal (vrp_t *self,
 // Solve
 // ---------------------------------------------------------------------------
 
-// Solve
+// Pending requests are merged into customers before a submodel is created
+// by vrp_solve () or vrp_resolve (): requests from the same sender with
+// equal delivery time windows are merged if they go to the same receiver,
+// or to co-located receivers (same coordinates and zero distance) while
+// their total quantity fits the smallest vehicle capacity. Requests which do
+// not fit start another customer, except that requests to the same receiver
+// are never split: the model is not solved if they exceed capacity.
+// A customer is represented by its request with the smallest ID. Routes of
+// returned solutions visit the receivers of the other merged requests right
+// after the customer.
+
+// Get IDs of requests which represent customers, sorted ascendingly
+const listu_t *vrp_customer_request_ids (vrp_t *self);
+
+// Get total quantity of customer which pending request is merged into
+double vrp_customer_quantity (vrp_t *self, size_t request_id);
+
+// Get total delivery service duration of customer which pending request is
+// merged into
+size_t vrp_customer_service_duration (vrp_t *self, size_t request_id);
+
+// Solve. Routes of vehicles with fixed prefix (see vrp_fix_route_prefix ())
+// continue from their current positions: routes planned from depot are
+// handed to them as in vrp_resolve ().
 solution_t *vrp_solve (vrp_t *self);
 
+// Solve again after requests are added or cancelled, starting from previous
+// solution (got from vrp_solve () or vrp_resolve ()): cancelled customers are
+// removed from it, new ones are inserted at cheapest feasible positions, and
+// the repaired plan and a few perturbations of it are improved by local
+// search. Falls back to vrp_solve () if previous is NULL or model has no
+// warm start (TSP).
+solution_t *vrp_resolve (vrp_t *self, const solution_t *previous);
+
 
 #ifdef __cplusplus
 }
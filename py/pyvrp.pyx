@@ -36,6 +36,12 @@ cdef extern from "../src/classes.h":
     void vrp_set_coord_sys (vrp_t *self, coord2d_sys_t coord_sys)
     size_t vrp_add_node (vrp_t *self, const char *ext_id)
     void vrp_set_node_coord (vrp_t *self, size_t node_id, coord2d_t coord)
+    void vrp_set_arc_storage (vrp_t *self, bool compact, bool symmetric)
+    void vrp_set_integer_distances (vrp_t *self, bool integer)
+    void vrp_set_on_demand_distances (vrp_t *self, size_t cache_rows)
+    void vrp_set_sparse_arcs (vrp_t *self, double detour_factor, size_t cache_rows)
+    int vrp_load_arc_distances (vrp_t *self, const char *filename)
+    int vrp_load_arc_durations (vrp_t *self, const char *filename)
     void vrp_set_arc_distance (vrp_t *self,
                                size_t from_node_id, size_t to_node_id,
                                double distance)
@@ -44,6 +50,10 @@ cdef extern from "../src/classes.h":
                                size_t duration)
     void vrp_generate_beeline_distances (vrp_t *self)
     void vrp_generate_durations (vrp_t *self, double speed)
+    void vrp_renumber_nodes_spatially (vrp_t *self)
+    void vrp_set_node_vertex (vrp_t *self, size_t node_id, size_t vertex)
+    void vrp_generate_road_arcs (vrp_t *self)
+    void vrp_generate_node_beeline_arcs (vrp_t *self, size_t node_id)
 
     size_t vrp_add_vehicle (vrp_t *self,
                             const char *vehicle_ext_id,
@@ -68,8 +78,14 @@ cdef extern from "../src/classes.h":
                                    size_t sender_or_receiver_id,
                                    size_t service_duration)
 
+    int vrp_cancel_request (vrp_t *self, size_t request_id)
+
+    size_t vrp_archive_requests (vrp_t *self)
+
     solution_t *vrp_solve (vrp_t *self)
 
+    solution_t *vrp_resolve (vrp_t *self, const solution_t *previous)
+
 
     # Solution
     void solution_free (solution_t **self_p)
@@ -125,6 +141,30 @@ cdef class VRPSolver:
         vrp_set_node_coord (self._model, node_id, c)
 
 
+    cpdef void set_arc_storage (self, compact, symmetric):
+        vrp_set_arc_storage (self._model, compact, symmetric)
+
+
+    cpdef void set_integer_distances (self, integer):
+        vrp_set_integer_distances (self._model, integer)
+
+
+    cpdef void set_on_demand_distances (self, cache_rows):
+        vrp_set_on_demand_distances (self._model, cache_rows)
+
+
+    cpdef void set_sparse_arcs (self, detour_factor, cache_rows):
+        vrp_set_sparse_arcs (self._model, detour_factor, cache_rows)
+
+
+    cpdef int load_arc_distances (self, filename):
+        return vrp_load_arc_distances (self._model, filename)
+
+
+    cpdef int load_arc_durations (self, filename):
+        return vrp_load_arc_durations (self._model, filename)
+
+
     cpdef void set_arc_distance (self, from_node_id, to_node_id, distance):
         vrp_set_arc_distance (self._model, from_node_id, to_node_id, distance)
 
@@ -146,6 +186,22 @@ cdef class VRPSolver:
             return -1
 
 
+    cpdef void renumber_nodes_spatially (self):
+        vrp_renumber_nodes_spatially (self._model)
+
+
+    cpdef void set_node_vertex (self, node_id, vertex):
+        vrp_set_node_vertex (self._model, node_id, vertex)
+
+
+    cpdef void generate_road_arcs (self):
+        vrp_generate_road_arcs (self._model)
+
+
+    cpdef void generate_node_beeline_arcs (self, node_id):
+        vrp_generate_node_beeline_arcs (self._model, node_id)
+
+
     cpdef size_t add_vehicle (self, ext_id, max_capacity, start_node, end_node):
         return vrp_add_vehicle (self._model, ext_id, max_capacity,
                                 start_node, end_node)
@@ -182,10 +238,25 @@ cdef class VRPSolver:
         vrp_set_service_duration (self._model, request_id, nr, service_duration)
 
 
+    cpdef int cancel_request (self, request_id):
+        return vrp_cancel_request (self._model, request_id)
+
+
+    cpdef size_t archive_requests (self):
+        return vrp_archive_requests (self._model)
+
+
     cpdef void solve (self):
         self._sol = vrp_solve (self._model)
 
 
+    cpdef void resolve (self):
+        cdef solution_t *sol = vrp_resolve (self._model, self._sol)
+        if self._sol is not NULL:
+            solution_free (&self._sol)
+        self._sol = sol
+
+
     cpdef void print_solution (self):
         if self._sol is not NULL:
             solution_print (self._sol)
@@ -3,6 +3,9 @@ from Cython.Build import cythonize
 
 # list of all source files for building the lib
 _src = [
+    "arcmatrix.c",
+    "arena.c",
+    "beeline.c",
     "arrayi.c",
     "arrayset.c",
     "arrayu.c",
@@ -18,9 +21,15 @@ _src = [
     "queue.c",
     "deps/pcg/entropy.c",
     "rng.c",
+    "roadnet.c",
+    "rowcache.c",
     "route.c",
     "solution.c",
+    "sparsearcs.c",
+    "strindex.c",
+    "spatialindex.c",
     "string_ext.c",
+    "tdarcs.c",
     "timer.c",
     "tsp.c",
     "tspi.c",
@@ -33,6 +42,7 @@ src = [_srcdir + s for s in _src]
 src.append("py/pyvrp.pyx")
 
 # add undef_macros = [ "NDEBUG" ] to undefine NDEBUG when compiling
-ext = Extension(name="pyvrp", sources=src, undef_macros = [ "NDEBUG" ])
+ext = Extension(name="pyvrp", sources=src, undef_macros = [ "NDEBUG" ],
+                extra_link_args = [ "-pthread" ])
 # ext = Extension(name="pyer", sources=src)
 setup(ext_modules=cythonize(ext))
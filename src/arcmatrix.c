@@ -0,0 +1,526 @@
+/*  =========================================================================
+    arcmatrix - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#define ARCMATRIX_FILE_MAGIC "ERARCMAT"
+#define ARCMATRIX_FILE_VERSION 1
+#define ARCMATRIX_FILE_BYTE_ORDER 0x0102030405060708ULL
+
+
+// Header of binary matrix file, followed by matrix cells in memory layout of
+// arcmatrix (row-major full matrix with stride order, or packed lower
+// triangle). 64 bytes, so cells are aligned for all value types.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t type; // arcmatrix_type_t
+    uint32_t symmetric;
+    uint32_t value_size; // size of one value in bytes
+    uint64_t order;
+    uint64_t byte_order; // ARCMATRIX_FILE_BYTE_ORDER in byte order of writer
+    char reserved[24];
+} s_file_header_t;
+
+
+struct _arcmatrix_t {
+    arcmatrix_type_t type;
+    bool symmetric; // packed lower triangle if true
+    size_t order; // number of rows in use
+    size_t capacity; // number of rows allocated (row stride of full matrix)
+    void *data;
+    void *map; // mapped file which data lies in, or NULL if data is allocated
+    size_t map_size;
+};
+
+
+// Size of one value
+static size_t s_value_size (arcmatrix_type_t type) {
+    switch (type) {
+        case AM_FLOAT64: return sizeof (double);
+        case AM_FLOAT32: return sizeof (float);
+        case AM_SIZE: return sizeof (size_t);
+        case AM_UINT32: return sizeof (uint32_t);
+        case AM_INT32: return sizeof (int32_t);
+    }
+    assert (false);
+    return 0;
+}
+
+
+// Release matrix storage: unmap file or free memory
+static void s_release_data (arcmatrix_t *self) {
+    if (self->map != NULL) {
+        munmap (self->map, self->map_size);
+        self->map = NULL;
+        self->map_size = 0;
+    }
+    else
+        free (self->data);
+    self->data = NULL;
+}
+
+
+// Number of cells for matrix with capacity rows
+static size_t s_num_cells (bool symmetric, size_t capacity) {
+    return symmetric ? capacity * (capacity + 1) / 2 : capacity * capacity;
+}
+
+
+// Fill cells with "not set" value.
+// All bits set is NaN for float types, max value for unsigned types, and -1
+// for int32.
+static void s_fill_none (void *data, size_t num_cells, size_t value_size) {
+    memset (data, 0xFF, num_cells * value_size);
+}
+
+
+// Cell index of arc (i, j)
+static size_t arcmatrix_index (const arcmatrix_t *self, size_t i, size_t j) {
+    if (!self->symmetric)
+        return i * self->capacity + j;
+    return (i >= j) ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i;
+}
+
+
+arcmatrix_t *arcmatrix_new (arcmatrix_type_t type, bool symmetric, size_t order) {
+    arcmatrix_t *self = (arcmatrix_t *) malloc (sizeof (arcmatrix_t));
+    assert (self);
+
+    self->type = type;
+    self->symmetric = symmetric;
+    self->order = 0;
+    self->capacity = 0;
+    self->data = NULL;
+    self->map = NULL;
+    self->map_size = 0;
+
+    arcmatrix_reserve (self, order);
+    return self;
+}
+
+
+arcmatrix_t *arcmatrix_new_from_file (const char *filename) {
+    assert (filename);
+
+    int fd = open (filename, O_RDONLY);
+    if (fd < 0) {
+        print_error ("Open matrix file %s failed.\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (s_file_header_t)) {
+        print_error ("Invalid matrix file %s.\n", filename);
+        close (fd);
+        return NULL;
+    }
+
+    // Private writable mapping: pages are shared with page cache until a cell
+    // is modified.
+    size_t map_size = (size_t) st.st_size;
+    void *map = mmap (NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        print_error ("Map matrix file %s failed.\n", filename);
+        return NULL;
+    }
+
+    const s_file_header_t *header = (const s_file_header_t *) map;
+    const char *error = NULL;
+    if (memcmp (header->magic, ARCMATRIX_FILE_MAGIC, 8) != 0)
+        error = "not a matrix file";
+    else if (header->version != ARCMATRIX_FILE_VERSION)
+        error = "unsupported version";
+    else if (header->byte_order != ARCMATRIX_FILE_BYTE_ORDER)
+        error = "byte order mismatch";
+    else if (header->type > AM_INT32 ||
+             header->value_size != s_value_size (header->type))
+        error = "unsupported value type";
+    else if (header->order > ((uint64_t) 1 << 28) ||
+             s_num_cells (header->symmetric, header->order) * header->value_size >
+             map_size - sizeof (s_file_header_t))
+        error = "file is truncated";
+
+    if (error != NULL) {
+        print_error ("Invalid matrix file %s: %s.\n", filename, error);
+        munmap (map, map_size);
+        return NULL;
+    }
+
+    arcmatrix_t *self = (arcmatrix_t *) malloc (sizeof (arcmatrix_t));
+    assert (self);
+    self->type = (arcmatrix_type_t) header->type;
+    self->symmetric = header->symmetric != 0;
+    self->order = header->order;
+    self->capacity = header->order;
+    self->data = (char *) map + sizeof (s_file_header_t);
+    self->map = map;
+    self->map_size = map_size;
+    return self;
+}
+
+
+void arcmatrix_free (arcmatrix_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        arcmatrix_t *self = *self_p;
+        s_release_data (self);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+arcmatrix_type_t arcmatrix_type (const arcmatrix_t *self) {
+    assert (self);
+    return self->type;
+}
+
+
+bool arcmatrix_is_symmetric (const arcmatrix_t *self) {
+    assert (self);
+    return self->symmetric;
+}
+
+
+size_t arcmatrix_order (const arcmatrix_t *self) {
+    assert (self);
+    return self->order;
+}
+
+
+// Grow matrix to order, with storage for new_capacity rows if it has to be
+// reallocated
+static void arcmatrix_grow (arcmatrix_t *self,
+                            size_t order, size_t new_capacity) {
+    if (order <= self->order)
+        return;
+
+    if (order > self->capacity) {
+        assert (new_capacity >= order);
+        size_t value_size = s_value_size (self->type);
+        size_t old_cells = s_num_cells (self->symmetric, self->capacity);
+        size_t new_cells = s_num_cells (self->symmetric, new_capacity);
+
+        if (self->symmetric) {
+            // Packed triangle keeps cell indices when growing
+            if (self->map != NULL) {
+                void *data = malloc (new_cells * value_size);
+                assert (data);
+                memcpy (data, self->data, old_cells * value_size);
+                s_release_data (self);
+                self->data = data;
+            }
+            else {
+                self->data = realloc (self->data, new_cells * value_size);
+                assert (self->data);
+            }
+            s_fill_none ((char *) self->data + old_cells * value_size,
+                         new_cells - old_cells, value_size);
+        }
+        else {
+            // Row stride changes: copy rows into new storage
+            void *data = malloc (new_cells * value_size);
+            assert (data);
+            s_fill_none (data, new_cells, value_size);
+            for (size_t i = 0; i < self->order; i++)
+                memcpy ((char *) data + i * new_capacity * value_size,
+                        (char *) self->data + i * self->capacity * value_size,
+                        self->order * value_size);
+            s_release_data (self);
+            self->data = data;
+        }
+        self->capacity = new_capacity;
+    }
+    self->order = order;
+}
+
+
+void arcmatrix_reserve (arcmatrix_t *self, size_t order) {
+    assert (self);
+    arcmatrix_grow (self, order, order);
+}
+
+
+void arcmatrix_reserve_geometric (arcmatrix_t *self, size_t order) {
+    assert (self);
+    arcmatrix_grow (self, order, max2 (order, self->capacity * 2));
+}
+
+
+void arcmatrix_set (arcmatrix_t *self, size_t i, size_t j, double value) {
+    assert (self);
+    // Storage doubles, so that setting arcs of nodes appended one by one
+    // takes amortized constant time per cell
+    arcmatrix_reserve_geometric (self, max2 (i, j) + 1);
+
+    size_t idx = arcmatrix_index (self, i, j);
+    switch (self->type) {
+        case AM_FLOAT64:
+            ((double *) self->data)[idx] = value;
+            break;
+        case AM_FLOAT32:
+            ((float *) self->data)[idx] = (float) value;
+            break;
+        case AM_SIZE:
+            assert (value >= 0 && value < (double) SIZE_MAX);
+            ((size_t *) self->data)[idx] = (size_t) value;
+            break;
+        case AM_UINT32:
+            assert (value >= 0 && value < (double) UINT32_MAX);
+            ((uint32_t *) self->data)[idx] = (uint32_t) value;
+            break;
+        case AM_INT32:
+            // Round to nearest integer
+            assert (value >= 0 && value < (double) INT32_MAX);
+            ((int32_t *) self->data)[idx] = (int32_t) (value + 0.5);
+            break;
+    }
+}
+
+
+void arcmatrix_set_row (arcmatrix_t *self,
+                        size_t i,
+                        const size_t *cols,
+                        const double *values,
+                        size_t num_values) {
+    assert (self);
+    assert (i < self->order);
+
+    // One typed loop per row instead of a switch per value. Cells (i, j) of
+    // full matrix, and of triangle with j <= i, are at row base + j.
+    size_t base = self->symmetric ? i * (i + 1) / 2 : i * self->capacity;
+    switch (self->type) {
+        case AM_FLOAT64: {
+            double *data = (double *) self->data;
+            for (size_t k = 0; k < num_values; k++) {
+                size_t j = cols[k];
+                data[(!self->symmetric || j <= i) ?
+                     base + j : arcmatrix_index (self, i, j)] = values[k];
+            }
+            break;
+        }
+        case AM_FLOAT32: {
+            float *data = (float *) self->data;
+            for (size_t k = 0; k < num_values; k++) {
+                size_t j = cols[k];
+                data[(!self->symmetric || j <= i) ?
+                     base + j : arcmatrix_index (self, i, j)] = (float) values[k];
+            }
+            break;
+        }
+        default:
+            for (size_t k = 0; k < num_values; k++)
+                arcmatrix_set (self, i, cols[k], values[k]);
+    }
+}
+
+
+double arcmatrix_get (const arcmatrix_t *self, size_t i, size_t j) {
+    assert (self);
+    assert (i < self->order && j < self->order);
+
+    size_t idx = arcmatrix_index (self, i, j);
+    switch (self->type) {
+        case AM_FLOAT64: {
+            double value = ((const double *) self->data)[idx];
+            return isnan (value) ? DOUBLE_NONE : value;
+        }
+        case AM_FLOAT32: {
+            float value = ((const float *) self->data)[idx];
+            return isnan (value) ? DOUBLE_NONE : (double) value;
+        }
+        case AM_SIZE: {
+            size_t value = ((const size_t *) self->data)[idx];
+            return (value == SIZE_MAX) ? DOUBLE_NONE : (double) value;
+        }
+        case AM_UINT32: {
+            uint32_t value = ((const uint32_t *) self->data)[idx];
+            return (value == UINT32_MAX) ? DOUBLE_NONE : (double) value;
+        }
+        case AM_INT32: {
+            int32_t value = ((const int32_t *) self->data)[idx];
+            return (value < 0) ? DOUBLE_NONE : (double) value;
+        }
+    }
+    assert (false);
+    return DOUBLE_NONE;
+}
+
+
+size_t arcmatrix_get_size (const arcmatrix_t *self, size_t i, size_t j) {
+    assert (self);
+    assert (i < self->order && j < self->order);
+
+    size_t idx = arcmatrix_index (self, i, j);
+    switch (self->type) {
+        case AM_SIZE: {
+            size_t value = ((const size_t *) self->data)[idx];
+            return (value == SIZE_MAX) ? SIZE_NONE : value;
+        }
+        case AM_UINT32: {
+            uint32_t value = ((const uint32_t *) self->data)[idx];
+            return (value == UINT32_MAX) ? SIZE_NONE : (size_t) value;
+        }
+        case AM_INT32: {
+            int32_t value = ((const int32_t *) self->data)[idx];
+            return (value < 0) ? SIZE_NONE : (size_t) value;
+        }
+        default: {
+            double value = arcmatrix_get (self, i, j);
+            return double_is_none (value) ? SIZE_NONE : (size_t) value;
+        }
+    }
+}
+
+
+bool arcmatrix_is_set (const arcmatrix_t *self, size_t i, size_t j) {
+    assert (self);
+    if (i >= self->order || j >= self->order)
+        return false;
+    return !double_is_none (arcmatrix_get (self, i, j));
+}
+
+
+bool arcmatrix_is_mapped (const arcmatrix_t *self) {
+    assert (self);
+    return self->map != NULL;
+}
+
+
+int arcmatrix_save (const arcmatrix_t *self, const char *filename) {
+    assert (self);
+    assert (filename);
+
+    FILE *file = fopen (filename, "wb");
+    if (file == NULL) {
+        print_error ("Open matrix file %s for writing failed.\n", filename);
+        return -1;
+    }
+
+    s_file_header_t header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, ARCMATRIX_FILE_MAGIC, 8);
+    header.version = ARCMATRIX_FILE_VERSION;
+    header.type = (uint32_t) self->type;
+    header.symmetric = self->symmetric ? 1 : 0;
+    header.value_size = (uint32_t) s_value_size (self->type);
+    header.order = self->order;
+    header.byte_order = ARCMATRIX_FILE_BYTE_ORDER;
+
+    size_t value_size = header.value_size;
+    bool ok = fwrite (&header, sizeof (header), 1, file) == 1;
+    if (self->symmetric) {
+        size_t num_cells = s_num_cells (true, self->order);
+        ok = ok && fwrite (self->data, value_size, num_cells, file) == num_cells;
+    }
+    else {
+        // Rows are written with stride order
+        for (size_t i = 0; ok && i < self->order; i++)
+            ok = fwrite ((const char *) self->data +
+                         i * self->capacity * value_size,
+                         value_size, self->order, file) == self->order;
+    }
+
+    if (fclose (file) != 0)
+        ok = false;
+    if (!ok) {
+        print_error ("Write matrix file %s failed.\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+size_t arcmatrix_memory_size (const arcmatrix_t *self) {
+    assert (self);
+    return s_num_cells (self->symmetric, self->capacity) *
+           s_value_size (self->type);
+}
+
+
+void arcmatrix_test (bool verbose) {
+    print_info (" * arcmatrix: \n");
+
+    arcmatrix_type_t types[] =
+        {AM_FLOAT64, AM_FLOAT32, AM_SIZE, AM_UINT32, AM_INT32};
+    for (size_t t = 0; t < 5; t++) {
+        for (int symmetric = 0; symmetric <= 1; symmetric++) {
+            arcmatrix_t *m = arcmatrix_new (types[t], symmetric, 2);
+            assert (arcmatrix_order (m) == 2);
+            assert (!arcmatrix_is_set (m, 0, 1));
+
+            // Grow silently
+            size_t order = 50;
+            for (size_t i = 0; i < order; i++)
+                for (size_t j = 0; j <= i; j++) {
+                    arcmatrix_set (m, i, j, (double) (i * 100 + j));
+                    if (!symmetric)
+                        arcmatrix_set (m, j, i, (double) (i * 100 + j));
+                }
+            assert (arcmatrix_order (m) == order);
+
+            for (size_t i = 0; i < order; i++)
+                for (size_t j = 0; j < order; j++) {
+                    size_t expected = max2 (i, j) * 100 + min2 (i, j);
+                    assert (arcmatrix_get (m, i, j) == (double) expected);
+                    assert (arcmatrix_get_size (m, i, j) == expected);
+                }
+
+            arcmatrix_reserve (m, order + 1);
+            assert (!arcmatrix_is_set (m, order, 0));
+            assert (double_is_none (arcmatrix_get (m, 0, order)));
+
+            if (arcmatrix_type (m) == AM_INT32) {
+                arcmatrix_set (m, 0, 1, 2.6);
+                assert (arcmatrix_get (m, 0, 1) == 3);
+            }
+
+            if (symmetric)
+                assert (arcmatrix_memory_size (m) <
+                        order * order * s_value_size (types[t]));
+
+            // Save and map back
+            const char *filename = "arcmatrix-test.tmp";
+            assert (arcmatrix_save (m, filename) == 0);
+            arcmatrix_t *m2 = arcmatrix_new_from_file (filename);
+            assert (m2);
+            assert (arcmatrix_is_mapped (m2));
+            assert (arcmatrix_type (m2) == types[t]);
+            assert (arcmatrix_is_symmetric (m2) == symmetric);
+            assert (arcmatrix_order (m2) == arcmatrix_order (m));
+            for (size_t i = 0; i < order; i++)
+                for (size_t j = 0; j < order; j++)
+                    assert (arcmatrix_get_size (m2, i, j) ==
+                            arcmatrix_get_size (m, i, j));
+
+            // Mapped matrix is writable and growable
+            arcmatrix_set (m2, 1, 2, 7);
+            assert (arcmatrix_get (m2, 1, 2) == 7);
+            arcmatrix_set (m2, order + 10, 0, 8);
+            assert (!arcmatrix_is_mapped (m2));
+            assert (arcmatrix_get (m2, order + 10, 0) == 8);
+            assert (arcmatrix_get (m2, 1, 2) == 7);
+            assert (arcmatrix_get (m2, 3, 2) == 302);
+            arcmatrix_free (&m2);
+            remove (filename);
+
+            arcmatrix_free (&m);
+            assert (m == NULL);
+        }
+    }
+
+    assert (arcmatrix_new_from_file ("arcmatrix-none.tmp") == NULL);
+
+    print_info ("OK\n");
+}
@@ -0,0 +1,105 @@
+/*  =========================================================================
+    arcmatrix - storage of arc values (distances or durations)
+
+    Square matrix of arc values with selectable value type and layout:
+
+    - value type: float64, float32, size_t, uint32 or int32. int32 is for
+      integer costs (e.g. TSPLIB nint distances), values are rounded.
+    - layout: full matrix, or packed lower triangle for symmetric arcs, in
+      which arc (i, j) and (j, i) share one cell
+
+    Matrix grows silently when an arc beyond its order is set. Unset arcs
+    read as DOUBLE_NONE (or SIZE_NONE by arcmatrix_get_size).
+
+    Matrix could be saved to a versioned binary file, and loaded by mapping
+    the file, in which case the mapped pages are used as storage directly.
+    Modified cells get private copies of their pages; the file is never
+    written. Growth moves storage to heap.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __ARCMATRIX_H_INCLUDED__
+#define __ARCMATRIX_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AM_FLOAT64,
+    AM_FLOAT32,
+    AM_SIZE,
+    AM_UINT32,
+    AM_INT32
+} arcmatrix_type_t;
+
+// Constructor
+arcmatrix_t *arcmatrix_new (arcmatrix_type_t type, bool symmetric, size_t order);
+
+// Create matrix from binary matrix file by mapping it.
+// Return NULL if file could not be mapped or is invalid.
+arcmatrix_t *arcmatrix_new_from_file (const char *filename);
+
+// Destructor
+void arcmatrix_free (arcmatrix_t **self_p);
+
+// Value type
+arcmatrix_type_t arcmatrix_type (const arcmatrix_t *self);
+
+// Check if matrix is stored as symmetric
+bool arcmatrix_is_symmetric (const arcmatrix_t *self);
+
+// Order of matrix (number of rows)
+size_t arcmatrix_order (const arcmatrix_t *self);
+
+// Grow matrix to order at least. Storage is grown to exactly order rows.
+void arcmatrix_reserve (arcmatrix_t *self, size_t order);
+
+// Grow matrix to order at least. If storage has to be reallocated, its
+// capacity at least doubles, so that growing by one row at a time takes
+// amortized constant time per cell.
+void arcmatrix_reserve_geometric (arcmatrix_t *self, size_t order);
+
+// Set value of arc (i, j). Matrix grows if needed, and its storage doubles
+// then.
+// For size_t and uint32 value is truncated, for int32 it is rounded.
+void arcmatrix_set (arcmatrix_t *self, size_t i, size_t j, double value);
+
+// Set values of arcs (i, cols[k]) for k < num_values.
+// Matrix should already be large enough; it does not grow here, so distinct
+// rows could be set from different threads.
+void arcmatrix_set_row (arcmatrix_t *self,
+                        size_t i,
+                        const size_t *cols,
+                        const double *values,
+                        size_t num_values);
+
+// Get value of arc (i, j), or DOUBLE_NONE if it is not set
+double arcmatrix_get (const arcmatrix_t *self, size_t i, size_t j);
+
+// Get value of arc (i, j) of integer matrix, or SIZE_NONE if it is not set
+size_t arcmatrix_get_size (const arcmatrix_t *self, size_t i, size_t j);
+
+// Check if arc (i, j) is set
+bool arcmatrix_is_set (const arcmatrix_t *self, size_t i, size_t j);
+
+// Check if storage is a mapped file
+bool arcmatrix_is_mapped (const arcmatrix_t *self);
+
+// Save matrix to binary matrix file.
+// Return 0 if succeeded, -1 if failed.
+int arcmatrix_save (const arcmatrix_t *self, const char *filename);
+
+// Number of bytes of matrix storage
+size_t arcmatrix_memory_size (const arcmatrix_t *self);
+
+// Self test
+void arcmatrix_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,325 @@
+/*  =========================================================================
+    arena - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+
+
+#define ARENA_MIN_BLOCK_SIZE 16 // payload size of the smallest size class
+#define ARENA_NUM_SIZE_CLASSES 12 // 16 bytes ~ 32 KB
+#define ARENA_CHUNK_SIZE (256 * 1024)
+#define ARENA_LARGE_BLOCK SIZE_MAX // size class of blocks out of chunks
+
+
+// Header in front of each block. 16 bytes, so payload keeps the alignment
+// of malloc.
+typedef struct {
+    arena_t *arena; // owner
+    size_t size_class; // index of size class, or ARENA_LARGE_BLOCK
+} s_header_t;
+
+
+// Large block: allocated directly from backing allocator, and linked in arena
+// to be freed with it.
+typedef struct _s_large_t {
+    struct _s_large_t *prev;
+    struct _s_large_t *next;
+    size_t size; // payload size
+    size_t padding;
+    s_header_t header;
+} s_large_t;
+
+
+// Chunk: memory taken from backing allocator which small blocks are cut from
+typedef struct _s_chunk_t {
+    struct _s_chunk_t *next;
+    size_t size;
+} s_chunk_t;
+
+
+struct _arena_t {
+    vrp_alloc_t alloc_fn;
+    vrp_free_t free_fn;
+    void *context;
+
+    s_chunk_t *chunks; // chunk list, the newest first
+    char *cursor; // free space of newest chunk: [cursor, limit)
+    char *limit;
+
+    void *free_lists[ARENA_NUM_SIZE_CLASSES]; // released blocks, linked
+                                              // through their payload
+    s_large_t *large_blocks;
+
+    size_t reserved_size;
+    size_t used_size;
+};
+
+
+static void *s_default_alloc (void *context, size_t size) {
+    return malloc (size);
+}
+
+
+static void s_default_free (void *context, void *ptr) {
+    free (ptr);
+}
+
+
+// Payload size of size class
+static size_t s_class_size (size_t size_class) {
+    return ((size_t) ARENA_MIN_BLOCK_SIZE) << size_class;
+}
+
+
+// Smallest size class to hold size bytes, or ARENA_LARGE_BLOCK
+static size_t s_size_class (size_t size) {
+    size_t size_class = 0;
+    while (size_class < ARENA_NUM_SIZE_CLASSES &&
+           s_class_size (size_class) < size)
+        size_class++;
+    return (size_class < ARENA_NUM_SIZE_CLASSES) ?
+           size_class : ARENA_LARGE_BLOCK;
+}
+
+
+static s_header_t *s_header (const void *ptr) {
+    return ((s_header_t *) ptr) - 1;
+}
+
+
+// Large block of header. Header is the last member of s_large_t.
+static s_large_t *s_large (s_header_t *header) {
+    return ((s_large_t *) (header + 1)) - 1;
+}
+
+
+// Add a new chunk which could hold at least size bytes
+static void arena_add_chunk (arena_t *self, size_t size) {
+    size_t chunk_size = sizeof (s_chunk_t) + size;
+    if (chunk_size < ARENA_CHUNK_SIZE)
+        chunk_size = ARENA_CHUNK_SIZE;
+
+    s_chunk_t *chunk = (s_chunk_t *) self->alloc_fn (self->context, chunk_size);
+    assert (chunk);
+    chunk->size = chunk_size;
+    chunk->next = self->chunks;
+    self->chunks = chunk;
+
+    self->cursor = (char *) (chunk + 1);
+    self->limit = (char *) chunk + chunk_size;
+    self->reserved_size += chunk_size;
+}
+
+
+// Allocate block of a size class
+static void *arena_alloc_small (arena_t *self, size_t size_class) {
+    void *ptr = self->free_lists[size_class];
+    if (ptr != NULL) {
+        self->free_lists[size_class] = *(void **) ptr;
+    }
+    else {
+        size_t block_size = sizeof (s_header_t) + s_class_size (size_class);
+        if (self->cursor == NULL ||
+            (size_t) (self->limit - self->cursor) < block_size)
+            arena_add_chunk (self, block_size);
+
+        s_header_t *header = (s_header_t *) self->cursor;
+        header->arena = self;
+        header->size_class = size_class;
+        self->cursor += block_size;
+        ptr = header + 1;
+    }
+    self->used_size += s_class_size (size_class);
+    return ptr;
+}
+
+
+// Allocate large block
+static void *arena_alloc_large (arena_t *self, size_t size) {
+    size_t total_size = sizeof (s_large_t) + size;
+    s_large_t *large = (s_large_t *) self->alloc_fn (self->context, total_size);
+    assert (large);
+
+    large->size = size;
+    large->header.arena = self;
+    large->header.size_class = ARENA_LARGE_BLOCK;
+    large->prev = NULL;
+    large->next = self->large_blocks;
+    if (self->large_blocks != NULL)
+        self->large_blocks->prev = large;
+    self->large_blocks = large;
+
+    self->reserved_size += total_size;
+    self->used_size += size;
+    return &large->header + 1;
+}
+
+
+arena_t *arena_new (vrp_alloc_t alloc_fn, vrp_free_t free_fn, void *context) {
+    assert ((alloc_fn == NULL) == (free_fn == NULL));
+    if (alloc_fn == NULL) {
+        alloc_fn = s_default_alloc;
+        free_fn = s_default_free;
+    }
+
+    // Arena object itself is also taken from backing allocator
+    arena_t *self = (arena_t *) alloc_fn (context, sizeof (arena_t));
+    assert (self);
+
+    self->alloc_fn = alloc_fn;
+    self->free_fn = free_fn;
+    self->context = context;
+
+    self->chunks = NULL;
+    self->cursor = NULL;
+    self->limit = NULL;
+    for (size_t idx = 0; idx < ARENA_NUM_SIZE_CLASSES; idx++)
+        self->free_lists[idx] = NULL;
+    self->large_blocks = NULL;
+
+    self->reserved_size = 0;
+    self->used_size = 0;
+    return self;
+}
+
+
+void arena_free (arena_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        arena_t *self = *self_p;
+
+        while (self->chunks != NULL) {
+            s_chunk_t *next = self->chunks->next;
+            self->free_fn (self->context, self->chunks);
+            self->chunks = next;
+        }
+
+        while (self->large_blocks != NULL) {
+            s_large_t *next = self->large_blocks->next;
+            self->free_fn (self->context, self->large_blocks);
+            self->large_blocks = next;
+        }
+
+        self->free_fn (self->context, self);
+        *self_p = NULL;
+    }
+}
+
+
+void *arena_alloc (arena_t *self, size_t size) {
+    assert (self);
+    size_t size_class = s_size_class (size);
+    return (size_class != ARENA_LARGE_BLOCK) ?
+           arena_alloc_small (self, size_class) :
+           arena_alloc_large (self, size);
+}
+
+
+void *arena_realloc (arena_t *self, void *ptr, size_t size) {
+    assert (self);
+    if (ptr == NULL)
+        return arena_alloc (self, size);
+
+    s_header_t *header = s_header (ptr);
+    assert (header->arena == self);
+
+    size_t old_size = (header->size_class != ARENA_LARGE_BLOCK) ?
+                      s_class_size (header->size_class) :
+                      s_large (header)->size;
+    if (size <= old_size)
+        return ptr;
+
+    void *new_ptr = arena_alloc (self, size);
+    memcpy (new_ptr, ptr, old_size);
+    arena_release (ptr);
+    return new_ptr;
+}
+
+
+void arena_release (void *ptr) {
+    if (ptr == NULL)
+        return;
+
+    s_header_t *header = s_header (ptr);
+    arena_t *self = header->arena;
+    assert (self);
+
+    if (header->size_class != ARENA_LARGE_BLOCK) {
+        assert (header->size_class < ARENA_NUM_SIZE_CLASSES);
+        *(void **) ptr = self->free_lists[header->size_class];
+        self->free_lists[header->size_class] = ptr;
+        self->used_size -= s_class_size (header->size_class);
+    }
+    else {
+        s_large_t *large = s_large (header);
+        if (large->prev != NULL)
+            large->prev->next = large->next;
+        else
+            self->large_blocks = large->next;
+        if (large->next != NULL)
+            large->next->prev = large->prev;
+
+        self->used_size -= large->size;
+        self->reserved_size -= sizeof (s_large_t) + large->size;
+        self->free_fn (self->context, large);
+    }
+}
+
+
+size_t arena_reserved_size (const arena_t *self) {
+    assert (self);
+    return self->reserved_size;
+}
+
+
+size_t arena_used_size (const arena_t *self) {
+    assert (self);
+    return self->used_size;
+}
+
+
+void arena_test (bool verbose) {
+    print_info (" * arena: \n");
+
+    arena_t *arena = arena_new (NULL, NULL, NULL);
+    assert (arena);
+
+    // Small blocks are recycled through free lists
+    size_t *a = (size_t *) arena_alloc (arena, 10 * sizeof (size_t));
+    for (size_t idx = 0; idx < 10; idx++)
+        a[idx] = idx;
+    size_t reserved = arena_reserved_size (arena);
+    arena_release (a);
+    assert (arena_used_size (arena) == 0);
+    size_t *b = (size_t *) arena_alloc (arena, 9 * sizeof (size_t));
+    assert (b == a);
+    assert (arena_reserved_size (arena) == reserved);
+
+    // Growth keeps content
+    b = (size_t *) arena_realloc (arena, b, 1000 * sizeof (size_t));
+    for (size_t idx = 0; idx < 9; idx++)
+        assert (b[idx] == idx);
+
+    // Large block
+    char *c = (char *) arena_alloc (arena, 1024 * 1024);
+    memset (c, 1, 1024 * 1024);
+    c = (char *) arena_realloc (arena, c, 2 * 1024 * 1024);
+    assert (c[1024 * 1024 - 1] == 1);
+    arena_release (c);
+
+    // Many blocks over several chunks
+    for (size_t cnt = 0; cnt < 100000; cnt++) {
+        double *d = (double *) arena_alloc (arena, cnt % 100 + 1);
+        *d = (double) cnt;
+        if (cnt % 2 == 0)
+            arena_release (d);
+    }
+
+    arena_release (b);
+    arena_free (&arena);
+    assert (arena == NULL);
+    print_info ("OK\n");
+}
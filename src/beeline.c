@@ -0,0 +1,302 @@
+/*  =========================================================================
+    beeline - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+#include <pthread.h>
+
+
+#define BEELINE_ROWS_PER_TASK 16 // rows taken by a worker at a time
+#define BEELINE_MIN_PAIRS_PER_THREAD 100000 // below this, fewer threads
+
+
+typedef struct {
+    arcmatrix_t *matrix;
+    const size_t *ids;
+    size_t num_points;
+    bool spherical; // points are unit vectors (x, y, z) on sphere
+
+    // Durations: distances rows are read from, or NULL for beeline
+    // distances. Unset distances are skipped.
+    const arcmatrix_t *distances;
+    double speed;
+
+    // Coordinates in structure-of-arrays form
+    double *x;
+    double *y;
+    double *z;
+
+    pthread_mutex_t mutex;
+    size_t next_row; // next row to be taken
+} s_job_t;
+
+
+// Durations from point i to points [0, end), DOUBLE_NONE if distance is
+// not set
+static void s_compute_duration_row (const s_job_t *job, size_t i, size_t end,
+                                    double *row) {
+    size_t id = job->ids[i];
+    for (size_t j = 0; j < end; j++) {
+        double dist = arcmatrix_get (job->distances, id, job->ids[j]);
+        row[j] = double_is_none (dist) ?
+                 DOUBLE_NONE : (double) (size_t) (dist / job->speed);
+    }
+}
+
+
+// Distances from point i to points [0, end)
+static void s_compute_row (const s_job_t *job, size_t i, size_t end,
+                           double *row) {
+    const double *x = job->x;
+    const double *y = job->y;
+    const double xi = x[i], yi = y[i];
+
+    if (!job->spherical) {
+        for (size_t j = 0; j < end; j++) {
+            double dx = xi - x[j];
+            double dy = yi - y[j];
+            row[j] = sqrt (dx * dx + dy * dy);
+        }
+    }
+    else {
+        // Haversine: a = sin²(c/2) = chord² / 4, c = 2 asin (chord / 2).
+        // Chord length from unit vectors has no cancellation for close
+        // points, and needs no trigonometric function per pair but asin.
+        const double *z = job->z;
+        const double zi = z[i];
+        for (size_t j = 0; j < end; j++) {
+            double dx = xi - x[j];
+            double dy = yi - y[j];
+            double dz = zi - z[j];
+            double half_chord = 0.5 * sqrt (dx * dx + dy * dy + dz * dz);
+            row[j] = 2 * COORD2D_EARTH_RADIUS *
+                     asin (half_chord < 1 ? half_chord : 1);
+        }
+    }
+}
+
+
+static void *s_worker (void *args) {
+    s_job_t *job = (s_job_t *) args;
+    bool symmetric = arcmatrix_is_symmetric (job->matrix);
+    double *row = (double *) malloc ((job->num_points + 1) * sizeof (double));
+    assert (row);
+    size_t *cols = NULL;
+    if (job->distances != NULL) {
+        cols = (size_t *) malloc ((job->num_points + 1) * sizeof (size_t));
+        assert (cols);
+    }
+
+    while (true) {
+        pthread_mutex_lock (&job->mutex);
+        size_t begin = job->next_row;
+        size_t end = min2 (begin + BEELINE_ROWS_PER_TASK, job->num_points);
+        job->next_row = end;
+        pthread_mutex_unlock (&job->mutex);
+        if (begin >= end)
+            break;
+
+        // Symmetric matrix: lower triangle, each pair computed once.
+        // Full matrix: whole rows. Computing each pair twice is cheaper than
+        // writing the mirrored column, which misses cache on every cell.
+        for (size_t i = begin; i < end; i++) {
+            size_t row_size = symmetric ? i + 1 : job->num_points;
+            if (job->distances == NULL) {
+                s_compute_row (job, i, row_size, row);
+                row[i] = 0;
+                arcmatrix_set_row (job->matrix, job->ids[i], job->ids,
+                                   row, row_size);
+                continue;
+            }
+
+            // Durations: cells of unset distances are left unset
+            s_compute_duration_row (job, i, row_size, row);
+            size_t num_set = 0;
+            for (size_t j = 0; j < row_size; j++) {
+                if (!double_is_none (row[j])) {
+                    cols[num_set] = job->ids[j];
+                    row[num_set++] = row[j];
+                }
+            }
+            arcmatrix_set_row (job->matrix, job->ids[i], cols, row, num_set);
+        }
+    }
+
+    free (cols);
+    free (row);
+    return NULL;
+}
+
+
+// Share rows of job out among threads. Automatic number (0) is limited for
+// small matrices.
+static void s_run_job (s_job_t *job, size_t num_threads) {
+    job->next_row = 0;
+    pthread_mutex_init (&job->mutex, NULL);
+
+    if (num_threads == 0) {
+        size_t num_pairs = job->num_points * (job->num_points - 1) / 2;
+        num_threads = max2 (min2 (num_online_processors (),
+                                  num_pairs / BEELINE_MIN_PAIRS_PER_THREAD), 1);
+    }
+
+    pthread_t *threads =
+        (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+    assert (threads);
+    size_t num_started = 0;
+    for (size_t idx = 1; idx < num_threads; idx++) {
+        if (pthread_create (&threads[num_started], NULL, s_worker, job) == 0)
+            num_started++;
+    }
+    s_worker (job); // calling thread works too
+    for (size_t idx = 0; idx < num_started; idx++)
+        pthread_join (threads[idx], NULL);
+
+    free (threads);
+    pthread_mutex_destroy (&job->mutex);
+}
+
+
+void beeline_fill_matrix (arcmatrix_t *matrix,
+                          const coord2d_t *coords,
+                          const size_t *ids,
+                          size_t num_points,
+                          coord2d_sys_t coord_sys,
+                          size_t num_threads) {
+    assert (matrix);
+    assert (coords);
+    assert (ids);
+    if (num_points == 0)
+        return;
+
+    s_job_t job;
+    job.matrix = matrix;
+    job.ids = ids;
+    job.num_points = num_points;
+    job.spherical = (coord_sys == CS_WGS84 || coord_sys == CS_GCJ02);
+    job.x = (double *) malloc (3 * num_points * sizeof (double));
+    assert (job.x);
+    job.y = job.x + num_points;
+    job.z = job.y + num_points;
+    job.distances = NULL;
+    job.speed = 0;
+
+    if (coord_sys == CS_GCJ02)
+        print_warning ("for CS_GCJ02 the result may not be correct.\n");
+
+    // Per-point terms
+    for (size_t k = 0; k < num_points; k++) {
+        const coord2d_t *c = &coords[k];
+        switch (coord_sys) {
+            case CS_CARTESIAN2D:
+                job.x[k] = c->v1;
+                job.y[k] = c->v2;
+                break;
+            case CS_POLAR2D:
+                job.x[k] = c->v1 * cos (c->v2);
+                job.y[k] = c->v1 * sin (c->v2);
+                break;
+            case CS_WGS84:
+            case CS_GCJ02: {
+                double lat = c->v1 * PI / 180.0;
+                double lng = c->v2 * PI / 180.0;
+                job.x[k] = cos (lat) * cos (lng);
+                job.y[k] = cos (lat) * sin (lng);
+                job.z[k] = sin (lat);
+                break;
+            }
+            default:
+                print_error ("coordinate system not supported.\n");
+                assert (false);
+        }
+    }
+
+    s_run_job (&job, num_threads);
+    free (job.x);
+}
+
+
+void beeline_fill_durations (arcmatrix_t *durations,
+                             const arcmatrix_t *distances,
+                             const size_t *ids,
+                             size_t num_points,
+                             double speed,
+                             size_t num_threads) {
+    assert (durations);
+    assert (distances);
+    assert (ids);
+    assert (speed > 0);
+    if (num_points == 0)
+        return;
+
+    s_job_t job;
+    job.matrix = durations;
+    job.ids = ids;
+    job.num_points = num_points;
+    job.spherical = false;
+    job.x = job.y = job.z = NULL;
+    job.distances = distances;
+    job.speed = speed;
+    s_run_job (&job, num_threads);
+}
+
+
+void beeline_test (bool verbose) {
+    print_info (" * beeline: \n");
+
+    size_t num_points = 300;
+    rng_t *rng = rng_new ();
+    coord2d_t *points =
+        coord2d_random_cartesian_range (-50, 50, -50, 50, num_points, rng);
+    size_t *ids = (size_t *) malloc (num_points * sizeof (size_t));
+    assert (ids);
+    for (size_t k = 0; k < num_points; k++)
+        ids[k] = num_points - 1 - k; // matrix index differs from point index
+
+    coord2d_sys_t systems[] = {CS_CARTESIAN2D, CS_WGS84};
+    for (size_t s = 0; s < 2; s++) {
+        for (int symmetric = 0; symmetric <= 1; symmetric++) {
+            arcmatrix_t *m = arcmatrix_new (AM_FLOAT64, symmetric, num_points);
+            beeline_fill_matrix (m, points, ids, num_points, systems[s], 4);
+            for (size_t i = 0; i < num_points; i++) {
+                for (size_t j = 0; j < num_points; j++) {
+                    double expected =
+                        coord2d_distance (&points[i], &points[j], systems[s]);
+                    double dist = arcmatrix_get (m, ids[i], ids[j]);
+                    assert (fabs (dist - expected) <= 1e-9 * (1 + expected));
+                }
+            }
+
+            // Durations of set distances; unset cells stay unset
+            arcmatrix_t *d = arcmatrix_new (AM_SIZE, symmetric, num_points);
+            arcmatrix_t *partial =
+                arcmatrix_new (AM_FLOAT64, symmetric, num_points);
+            for (size_t i = 0; i < num_points; i += 2)
+                for (size_t j = 0; j < num_points; j++)
+                    arcmatrix_set (partial, ids[i], ids[j],
+                                   arcmatrix_get (m, ids[i], ids[j]));
+            beeline_fill_durations (d, partial, ids, num_points, 0.5, 4);
+            for (size_t i = 0; i < num_points; i++) {
+                for (size_t j = 0; j < num_points; j++) {
+                    double dist = arcmatrix_get (partial, ids[i], ids[j]);
+                    if (double_is_none (dist))
+                        assert (!arcmatrix_is_set (d, ids[i], ids[j]));
+                    else
+                        assert (arcmatrix_get_size (d, ids[i], ids[j]) ==
+                                (size_t) (dist / 0.5));
+                }
+            }
+            arcmatrix_free (&partial);
+            arcmatrix_free (&d);
+            arcmatrix_free (&m);
+        }
+    }
+
+    free (ids);
+    free (points);
+    rng_free (&rng);
+    print_info ("OK\n");
+}
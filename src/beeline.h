@@ -0,0 +1,51 @@
+/*  =========================================================================
+    beeline - beeline distance matrix kernel
+
+    Computes beeline distances between all pairs of points into an arc
+    matrix. Coordinates are converted once into structure-of-arrays form
+    (Cartesian x, y, or unit vectors on the sphere for geodetic systems), so
+    that the inner loop over a row is branch-free and vectorizable. Each
+    pair is computed once, and rows are shared out among threads. The same
+    row kernel derives durations from a distance matrix.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __BEELINE_H_INCLUDED__
+#define __BEELINE_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compute beeline distances between points and set them in matrix.
+// ids[k] is the matrix index of coords[k]. Matrix should already be large
+// enough. If matrix is not symmetric, both arc directions are set.
+// num_threads: number of worker threads, 0 for number of online processors.
+void beeline_fill_matrix (arcmatrix_t *matrix,
+                          const coord2d_t *coords,
+                          const size_t *ids,
+                          size_t num_points,
+                          coord2d_sys_t coord_sys,
+                          size_t num_threads);
+
+// Set durations (distance / speed, truncated) of arcs among points whose
+// distance is set; arcs of unset distances are left unset.
+// ids[k] is the matrix index of point k in both matrices. Duration matrix
+// should already be large enough. num_threads as above.
+void beeline_fill_durations (arcmatrix_t *durations,
+                             const arcmatrix_t *distances,
+                             const size_t *ids,
+                             size_t num_points,
+                             double speed,
+                             size_t num_threads);
+
+// Self test
+void beeline_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,17 +10,40 @@
 
 // External APIs
 #include "../include/liber.h"
+#include <unistd.h>
 
 // Private class structures
+typedef struct _arcmatrix_t arcmatrix_t;
+typedef struct _rowcache_t rowcache_t;
+typedef struct _roadnet_t roadnet_t;
+typedef struct _tdarcs_t tdarcs_t;
+typedef struct _sparsearcs_t sparsearcs_t;
+typedef struct _strindex_t strindex_t;
+typedef struct _spatialindex_t spatialindex_t;
 typedef struct _tspi_t tspi_t;
 typedef struct _tsp_t tsp_t;
 typedef struct _cvrp_t cvrp_t;
 typedef struct _vrptw_t vrptw_t;
 
 // Internal API headers
+#include "arcmatrix.h"
+#include "beeline.h"
+#include "rowcache.h"
+#include "roadnet.h"
+#include "tdarcs.h"
+#include "sparsearcs.h"
+#include "strindex.h"
+#include "spatialindex.h"
 #include "tspi.h"
 #include "tsp.h"
 #include "cvrp.h"
 #include "vrptw.h"
 
+// Number of online processors, at least 1. Automatic number of threads of
+// parallel kernels is limited by it.
+static inline size_t num_online_processors (void) {
+    long num = sysconf (_SC_NPROCESSORS_ONLN);
+    return (num > 0) ? (size_t) num : 1;
+}
+
 #endif
@@ -7,9 +7,6 @@
 
 #include "classes.h"
 
-#define EARTH_RADIUS 6373.0
-
-
 static double angle_degree_to_radian (double angle) {
     return angle * PI / 180.0;
 }
@@ -52,7 +49,7 @@ double coord2d_distance (const coord2d_t *p1,
             a = pow (sin (dlat/2), 2) +
                 cos (lat1) * cos (lat2) * pow (sin (dlng/2), 2);
             c = 2 * atan2 (sqrt (a), sqrt (1-a));
-            return EARTH_RADIUS * c;
+            return COORD2D_EARTH_RADIUS * c;
 
         default:
             print_error ("coordinate system not supported.\n");
@@ -62,12 +59,13 @@ double coord2d_distance (const coord2d_t *p1,
 }
 
 
-coord2d_t coord2d_to_polar (const coord2d_t *point,
-                            const coord2d_t *ref,
-                            coord2d_sys_t coord_sys) {
-    assert (point);
-    double dx, dy, x, y, lat1, lng1, lat2, lng2;
-    coord2d_t polar;
+// Polar angle of point around ref (origin if NULL), in [0, 2*PI).
+// CS_GCJ02 is treated as CS_WGS84.
+static double s_polar_angle (const coord2d_t *point,
+                             const coord2d_t *ref,
+                             coord2d_sys_t coord_sys) {
+    double dx, dy, x, y, lat1, lng1, lat2, lng2, angle;
+    const coord2d_t origin = {0.0, 0.0};
 
     switch (coord_sys) {
         case CS_CARTESIAN2D:
@@ -80,29 +78,17 @@ coord2d_t coord2d_to_polar (const coord2d_t *point,
                 dy = point->v2;
             }
 
-            polar.v1 = sqrt (dx * dx + dy * dy);
-            if (polar.v1 > 0) {
-                polar.v2 = atan2 (dy, dx);
-                if (polar.v2 < 0 )
-                    polar.v2 += 2*PI;
-            }
-            else
-                polar.v2 = 0;
-
-            return polar;
-
-        case CS_POLAR2D:
-            print_warning ("input point is already a polar.\n");
-            return *point;
+            if (dx == 0 && dy == 0)
+                return 0;
+            angle = atan2 (dy, dx);
+            if (angle < 0)
+                angle += 2*PI;
+            return angle;
 
         case CS_GCJ02:
-            print_warning ("for CS_GCJ02 the result may not be correct.\n");
-
         case CS_WGS84:
             if (ref == NULL)
-                ref = &((coord2d_t) {0.0, 0.0});
-
-            polar.v1 = coord2d_distance (point, ref, coord_sys);
+                ref = &origin;
 
             // Formula for computing (initial) bearing:
             // The bearing to a point is the angle measured in a clockwise
@@ -118,10 +104,55 @@ coord2d_t coord2d_to_polar (const coord2d_t *point,
             y = sin (lng2 - lng1) * cos (lat2);
             x = cos (lat1) * sin (lat2) -
                 sin (lat1) * cos (lat2) * cos (lng2 - lng1);
-            polar.v2 = atan2 (y, x);
-            if (polar.v2 < 0)
-                polar.v2 += 2*PI;
+            angle = atan2 (y, x);
+            if (angle < 0)
+                angle += 2*PI;
+            return angle;
+
+        default:
+            print_error ("coordinate system not supported.\n");
+            assert (false);
+            return 0;
+    }
+}
+
+
+coord2d_t coord2d_to_polar (const coord2d_t *point,
+                            const coord2d_t *ref,
+                            coord2d_sys_t coord_sys) {
+    assert (point);
+    double dx, dy;
+    const coord2d_t origin = {0.0, 0.0};
+    coord2d_t polar;
 
+    switch (coord_sys) {
+        case CS_CARTESIAN2D:
+            if (ref) {
+                dx = point->v1 - ref->v1;
+                dy = point->v2 - ref->v2;
+            }
+            else {
+                dx = point->v1;
+                dy = point->v2;
+            }
+
+            polar.v1 = sqrt (dx * dx + dy * dy);
+            polar.v2 = (polar.v1 > 0) ?
+                       s_polar_angle (point, ref, coord_sys) : 0;
+            return polar;
+
+        case CS_POLAR2D:
+            print_warning ("input point is already a polar.\n");
+            return *point;
+
+        case CS_GCJ02:
+            print_warning ("for CS_GCJ02 the result may not be correct.\n");
+
+        case CS_WGS84:
+            if (ref == NULL)
+                ref = &origin;
+            polar.v1 = coord2d_distance (point, ref, coord_sys);
+            polar.v2 = s_polar_angle (point, ref, coord_sys);
             return polar;
 
         default:
@@ -153,6 +184,52 @@ int coord2d_compare_polar_angle (const coord2d_t *p1,
 }
 
 
+void coord2d_sort_by_polar_angle (const coord2d_t **points,
+                                  size_t num,
+                                  const coord2d_t *ref,
+                                  coord2d_sys_t coord_sys,
+                                  size_t *order) {
+    assert (points);
+    assert (order);
+    if (num == 0)
+        return;
+
+    // Angle in [0, 2*PI) quantized to full range of 32-bit key
+    uint32_t *keys = (uint32_t *) malloc (2 * num * sizeof (uint32_t));
+    size_t *buffer = (size_t *) malloc (num * sizeof (size_t));
+    assert (keys && buffer);
+    uint32_t *key_buffer = keys + num;
+    for (size_t idx = 0; idx < num; idx++) {
+        double key = s_polar_angle (points[idx], ref, coord_sys) /
+                     (2*PI) * 4294967296.0;
+        keys[idx] = (key < 4294967295.0) ? (uint32_t) key : UINT32_MAX;
+        order[idx] = idx;
+    }
+
+    // LSD radix sort by bytes, which keeps order of equal keys. Passes of
+    // a byte shared by all keys are skipped.
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t counts[257] = {0};
+        for (size_t idx = 0; idx < num; idx++)
+            counts[((keys[idx] >> shift) & 0xff) + 1]++;
+        if (counts[((keys[0] >> shift) & 0xff) + 1] == num)
+            continue;
+        for (size_t b = 0; b < 256; b++)
+            counts[b + 1] += counts[b];
+        for (size_t idx = 0; idx < num; idx++) {
+            size_t pos = counts[(keys[idx] >> shift) & 0xff]++;
+            key_buffer[pos] = keys[idx];
+            buffer[pos] = order[idx];
+        }
+        memcpy (keys, key_buffer, num * sizeof (uint32_t));
+        memcpy (order, buffer, num * sizeof (size_t));
+    }
+
+    free (keys);
+    free (buffer);
+}
+
+
 coord2d_t *coord2d_random_cartesian_range (double xmin, double xmax,
                                            double ymin, double ymax,
                                            size_t num,
@@ -7,7 +7,7 @@
 
 /* Todos:
 
-- [ ] remove customer duplicates when creating model
+- [x] remove customer duplicates when creating model
 - [x] fitness (cost of splited giant tour)
 - [x] split giant tour to solution_t
 - [x] intra-route local search for evol
@@ -40,12 +40,20 @@ Notes:
 In this implemetation, nodes in route and solution are directly represented by
 generic IDs (i.e. ID in the generic model).
 
+A vehicle with fixed route prefix is represented by an anchor node: the
+current position of vehicle, with demand of the delivered quantity. Route of
+vehicle starts at its anchor instead of depot in warm start, and anchor is
+never moved. Prefix is restored for output.
+
 */
 
 #include "classes.h"
 
 
 #define SMALL_NUM_NODES 30
+#define NUM_WARM_START_PERTURBATIONS 4
+#define CW_MAX_FULL_SAVINGS_CUSTOMERS 1000 // larger: savings of neighbours
+#define CW_NUM_NEIGHBORS 30 // nearest customers paired in CW savings
 
 
 // Private node representation
@@ -53,6 +61,7 @@ typedef struct {
     size_t id; // node ID in roadgraph of generic model
     double demand;
     const coord2d_t *coord;
+    const listu_t *fixed_node_ids; // anchor: visited stops of vehicle
 } s_node_t;
 
 
@@ -62,7 +71,14 @@ struct _cvrp_t {
     size_t num_vehicles;
     size_t num_customers;
     s_node_t *nodes; // indices: depot: 0; customers: 1, 2, ..., num_customers
+                     // anchors: num_customers + 1, ..., + num_anchors
+    size_t num_anchors; // vehicles with fixed route prefix
+    size_t *node_idx; // index in nodes of generic node ID, or SIZE_NONE
+    size_t max_node_id; // size of node_idx - 1
+    size_t *sweep_order; // customers (index - 1) in ascending polar angle
+                         // around depot, or NULL until first sweep
     rng_t *rng;
+    arena_t *arena; // storage of genomes, routes, solutions and temporaries
 };
 
 
@@ -77,18 +93,19 @@ static double cvrp_arc_distance_by_idx (cvrp_t *self,
 }
 
 
-// Get demand of node. i.e. associated request's quantity
-static double cvrp_node_demand (cvrp_t *self, size_t node_id) {
-    if (node_id == self->nodes[0].id) // depot
-        return 0;
+// Get index in self->nodes of generic node ID, or SIZE_NONE if node is not
+// depot, a customer or an anchor
+static size_t cvrp_node_idx (cvrp_t *self, size_t node_id) {
+    return (node_id <= self->max_node_id) ? self->node_idx[node_id] : SIZE_NONE;
+}
+
 
-    const listu_t *requests =
-        vrp_node_pending_request_ids (self->vrp, node_id);
-    assert (requests);
-    assert (listu_size (requests) == 1);
-    size_t request_id = listu_get (requests, 0);
-    assert (node_id == vrp_request_receiver (self->vrp, request_id));
-    return vrp_request_quantity (self->vrp, request_id);
+// Get demand of node: customer quantity, delivered quantity of anchor, or 0
+// for depot
+static double cvrp_node_demand (cvrp_t *self, size_t node_id) {
+    size_t idx = cvrp_node_idx (self, node_id);
+    assert (idx != SIZE_NONE);
+    return self->nodes[idx].demand;
 }
 
 
@@ -123,7 +140,7 @@ static double cvrp_route_slice_demand (cvrp_t *self, route_t *route,
 
 // Transform CVRP solution to giant tour representation
 static route_t *cvrp_giant_tour_from_solution (cvrp_t *self, solution_t *sol) {
-    route_t *gtour = route_new (self->num_customers);
+    route_t *gtour = route_new_in_arena (self->arena, self->num_customers);
     for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
         route_t *route = solution_route (sol, idx_r);
         for (size_t idx = 0; idx < route_size (route); idx++) {
@@ -193,11 +210,13 @@ static solution_t *cvrp_split (cvrp_t *self, route_t *gtour) {
     size_t depot = self->nodes[0].id;
 
     // cost of the shortest path from node 0 to node (1 ~ N) in H
-    double *sp_cost = (double *) malloc ((N + 1) * sizeof (double));
+    double *sp_cost =
+        (double *) arena_alloc (self->arena, (N + 1) * sizeof (double));
     assert (sp_cost);
 
     // predecessor of node (1 ~ N) on the shortest path
-    size_t *predecessor = (size_t *) malloc ((N + 1) * sizeof (size_t));
+    size_t *predecessor =
+        (size_t *) arena_alloc (self->arena, (N + 1) * sizeof (size_t));
     assert (predecessor);
 
     // initialize
@@ -240,7 +259,7 @@ static solution_t *cvrp_split (cvrp_t *self, route_t *gtour) {
         }
     }
 
-    solution_t *sol = solution_new (self->vrp);
+    solution_t *sol = solution_new_in_arena (self->arena);
     assert (sol);
 
     size_t j = N;
@@ -248,7 +267,7 @@ static solution_t *cvrp_split (cvrp_t *self, route_t *gtour) {
 
     while (i != SIZE_NONE) {
         // Add route: (depot, i+1, ..., j, depot)
-        route_t *route = route_new (2 + j - i);
+        route_t *route = route_new_in_arena (self->arena, 2 + j - i);
         assert (route);
         route_append_node (route, depot); // depot
         for (size_t k = i + 1; k <= j; k++)
@@ -264,8 +283,8 @@ static solution_t *cvrp_split (cvrp_t *self, route_t *gtour) {
     solution_set_total_distance (sol, sp_cost[N]);
     // assert (sp_cost[N] == solution_cal_set_total_distance (sol, self->vrp));
 
-    free (sp_cost);
-    free (predecessor);
+    arena_release (sp_cost);
+    arena_release (predecessor);
     return sol;
 }
 
@@ -284,7 +303,8 @@ typedef struct {
 static s_genome_t *cvrp_new_genome (cvrp_t *self,
                                     route_t *gtour, solution_t *sol) {
     assert (gtour != NULL || sol != NULL);
-    s_genome_t *genome = (s_genome_t *) malloc (sizeof (s_genome_t));
+    s_genome_t *genome =
+        (s_genome_t *) arena_alloc (self->arena, sizeof (s_genome_t));
     assert (genome);
     genome->gtour = gtour;
     genome->sol = sol;
@@ -309,7 +329,7 @@ static void s_genome_free (s_genome_t **self_p) {
         s_genome_t *self = *self_p;
         route_free (&self->gtour);
         solution_free (&self->sol);
-        free (self);
+        arena_release (self);
         *self_p = NULL;
     }
 }
@@ -356,41 +376,121 @@ static int s_cwsaving_compare (const s_cwsaving_t *s1, const s_cwsaving_t *s2) {
         return -1;
     if (s1->saving < s2->saving)
         return 1;
+    // Ties in order of pairs, which are reordered by previous sorts
+    if (s1->c1 != s2->c1)
+        return (s1->c1 < s2->c1) ? -1 : 1;
+    if (s1->c2 != s2->c2)
+        return (s1->c2 < s2->c2) ? -1 : 1;
     return 0;
 }
 
 
+// Set customer pairs of CW savings: all ordered pairs, or for a large
+// model with coordinates, pairs of each customer and its nearest customers
+// found by spatial index, in both directions.
+// Return number of pairs, and savings array allocated in arena.
+static size_t cvrp_cw_pairs (cvrp_t *self, s_cwsaving_t **savings_p) {
+    size_t N = self->num_customers;
+    bool use_neighbors = N > CW_MAX_FULL_SAVINGS_CUSTOMERS &&
+                         vrp_coord_sys (self->vrp) != CS_NONE;
+    for (size_t i = 1; use_neighbors && i <= N; i++)
+        use_neighbors =
+            !coord2d_is_none (vrp_node_coord (self->vrp, self->nodes[i].id));
+
+    if (!use_neighbors) {
+        s_cwsaving_t *savings =
+            (s_cwsaving_t *) arena_alloc (self->arena,
+                                          sizeof (s_cwsaving_t) * N * (N -1));
+        assert (savings);
+        size_t cnt = 0;
+        for (size_t i = 1; i <= N; i++) {
+            for (size_t j = 1; j <= N; j++) {
+                if (j == i)
+                    continue;
+                savings[cnt].c1 = i;
+                savings[cnt].c2 = j;
+                cnt++;
+            }
+        }
+        *savings_p = savings;
+        return cnt;
+    }
+
+    // Neighbours of customer i: neighbors[(i - 1) * K, i * K), including i
+    size_t K = CW_NUM_NEIGHBORS + 1;
+    spatialindex_t *index = spatialindex_new (vrp_coord_sys (self->vrp));
+    for (size_t i = 1; i <= N; i++)
+        spatialindex_insert (index, i,
+                             vrp_node_coord (self->vrp, self->nodes[i].id));
+    size_t *neighbors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * N * K);
+    assert (neighbors);
+    size_t *num_neighbors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * (N + 1));
+    assert (num_neighbors);
+    for (size_t i = 1; i <= N; i++)
+        num_neighbors[i] =
+            spatialindex_nearest (index,
+                                  vrp_node_coord (self->vrp, self->nodes[i].id),
+                                  K, &neighbors[(i - 1) * K], NULL);
+    spatialindex_free (&index);
+
+    // Pair of mutual neighbours is added once, from smaller customer
+    s_cwsaving_t *savings =
+        (s_cwsaving_t *) arena_alloc (self->arena,
+                                      sizeof (s_cwsaving_t) * 2 * N * K);
+    assert (savings);
+    size_t cnt = 0;
+    for (size_t i = 1; i <= N; i++) {
+        for (size_t k = 0; k < num_neighbors[i]; k++) {
+            size_t j = neighbors[(i - 1) * K + k];
+            if (j == i)
+                continue;
+            bool is_mutual = false;
+            for (size_t l = 0; l < num_neighbors[j] && !is_mutual; l++)
+                is_mutual = (neighbors[(j - 1) * K + l] == i);
+            if (is_mutual && j < i)
+                continue;
+            savings[cnt].c1 = i;
+            savings[cnt].c2 = j;
+            savings[cnt + 1].c1 = j;
+            savings[cnt + 1].c2 = i;
+            cnt += 2;
+        }
+    }
+    arena_release (neighbors);
+    arena_release (num_neighbors);
+    print_info ("CW savings of %zu neighbour pairs.\n", cnt);
+    *savings_p = savings;
+    return cnt;
+}
+
+
 // Return solution in which nodes are with generic IDs
 static solution_t *cvrp_clark_wright_parallel (cvrp_t *self,
                                                size_t *predecessors,
                                                size_t *successors,
                                                double *route_demands,
                                                s_cwsaving_t *savings,
+                                               size_t num_savings,
                                                double lambda) {
     size_t N = self->num_customers;
 
     // Initialize auxilary variables
-    size_t cnt = 0;
     for (size_t i = 1; i <= N; i++) {
         predecessors[i] = 0;
         successors[i] = 0;
         route_demands[i] = self->nodes[i].demand;
-        for (size_t j = 1; j <= N; j++) {
-            if (j == i)
-                continue;
-            savings[cnt].c1 = i;
-            savings[cnt].c2 = j;
-            savings[cnt].saving =
-                cvrp_arc_distance_by_idx (self, i, 0) +
-                cvrp_arc_distance_by_idx (self, 0, j) -
-                cvrp_arc_distance_by_idx (self, i, j) * lambda;
-            cnt++;
-        }
+    }
+    for (size_t cnt = 0; cnt < num_savings; cnt++) {
+        size_t i = savings[cnt].c1, j = savings[cnt].c2;
+        savings[cnt].saving =
+            cvrp_arc_distance_by_idx (self, i, 0) +
+            cvrp_arc_distance_by_idx (self, 0, j) -
+            cvrp_arc_distance_by_idx (self, i, j) * lambda;
     }
 
     // Sort savings in descending order
-    size_t num_savings = N * (N -1);
-    assert (cnt == num_savings);
     qsort (savings, num_savings, sizeof (s_cwsaving_t),
            (comparator_t) s_cwsaving_compare);
 
@@ -429,10 +529,11 @@ static solution_t *cvrp_clark_wright_parallel (cvrp_t *self,
     }
 
     // Construct solution from predecessors and successors
-    solution_t *sol = solution_new (self->vrp);
+    solution_t *sol = solution_new_in_arena (self->arena);
     for (size_t idx = 1; idx <= N; idx++) {
         if (predecessors[idx] == 0) { // idx is a first customer of route
-            route_t *route = route_new (3); // at least 3 nodes in route
+            // at least 3 nodes in route
+            route_t *route = route_new_in_arena (self->arena, 3);
             route_append_node (route, self->nodes[0].id); // depot
             size_t successor = idx;
             while (successor != 0) {
@@ -458,15 +559,17 @@ static listx_t *cvrp_clark_wright (cvrp_t *self, size_t num_expected) {
     listx_t *genomes = listx_new ();
     listu_t *hashes = listu_new (7);
 
-    size_t *predecessors = (size_t *) malloc (sizeof (size_t) * (N + 1));
+    size_t *predecessors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * (N + 1));
     assert (predecessors);
-    size_t *successors = (size_t *) malloc (sizeof (size_t) * (N + 1));
+    size_t *successors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * (N + 1));
     assert (successors);
-    double *route_demands = (double *) malloc (sizeof (double) * (N + 1));
+    double *route_demands =
+        (double *) arena_alloc (self->arena, sizeof (double) * (N + 1));
     assert (route_demands);
-    s_cwsaving_t *savings =
-        (s_cwsaving_t *) malloc (sizeof (s_cwsaving_t) * N * (N -1));
-    assert (savings);
+    s_cwsaving_t *savings = NULL;
+    size_t num_savings = cvrp_cw_pairs (self, &savings);
 
     for (double lambda = 0.4; lambda <= 1.0; lambda += 0.1) {
         solution_t *sol = cvrp_clark_wright_parallel (self,
@@ -474,6 +577,7 @@ static listx_t *cvrp_clark_wright (cvrp_t *self, size_t num_expected) {
                                                       successors,
                                                       route_demands,
                                                       savings,
+                                                      num_savings,
                                                       lambda);
 
         route_t *gtour = cvrp_giant_tour_from_solution (self, sol);
@@ -496,10 +600,10 @@ static listx_t *cvrp_clark_wright (cvrp_t *self, size_t num_expected) {
 
     print_info ("generated: %zu\n", listx_size (genomes));
     listu_free (&hashes);
-    free (predecessors);
-    free (successors);
-    free (route_demands);
-    free (savings);
+    arena_release (predecessors);
+    arena_release (successors);
+    arena_release (route_demands);
+    arena_release (savings);
     return genomes;
 }
 
@@ -520,27 +624,33 @@ static listx_t *cvrp_sweep_giant_tours (cvrp_t *self, size_t num_expected) {
         return genomes;
     }
 
-    // Create giant tour template: nodes permutated in angle ascending order
-    coord2d_t *polars = (coord2d_t *) malloc (sizeof (coord2d_t) * N);
-    assert (polars);
-    for (size_t idx = 0; idx < N; idx++) {
-        if (coord2d_is_none (self->nodes[idx+1].coord)) {
-            print_info ("Coordinates of nodes are not available.\n");
-            free (polars);
-            return genomes;
+    // Create giant tour template: nodes permutated in angle ascending order.
+    // Order is sorted on first call and cached.
+    if (self->sweep_order == NULL) {
+        const coord2d_t **coords =
+            (const coord2d_t **) arena_alloc (self->arena,
+                                              sizeof (coord2d_t *) * N);
+        assert (coords);
+        for (size_t idx = 0; idx < N; idx++) {
+            if (coord2d_is_none (self->nodes[idx+1].coord)) {
+                print_info ("Coordinates of nodes are not available.\n");
+                arena_release (coords);
+                return genomes;
+            }
+            coords[idx] = self->nodes[idx+1].coord;
         }
-        polars[idx] = coord2d_to_polar (self->nodes[idx+1].coord,
-                                        self->nodes[0].coord,
-                                        vrp_coord_sys (self->vrp));
-        // Overwrite v1 with customer node ID
-        polars[idx].v1 = (double) (self->nodes[idx+1].id);
+        self->sweep_order =
+            (size_t *) arena_alloc (self->arena, sizeof (size_t) * N);
+        assert (self->sweep_order);
+        coord2d_sort_by_polar_angle (coords, N, self->nodes[0].coord,
+                                     vrp_coord_sys (self->vrp),
+                                     self->sweep_order);
+        arena_release (coords);
     }
-    qsort (polars, N, sizeof (coord2d_t),
-           (comparator_t) coord2d_compare_polar_angle);
 
-    route_t *gtour_template = route_new (N);
+    route_t *gtour_template = route_new_in_arena (self->arena, N);
     for (size_t idx = 0; idx < N; idx++)
-        route_append_node (gtour_template, (size_t) polars[idx].v1);
+        route_append_node (gtour_template, self->nodes[self->sweep_order[idx] + 1].id);
 
     // Random rotation of template tour
     size_t random_num = rng_random_int (self->rng, 0, N);
@@ -569,7 +679,6 @@ static listx_t *cvrp_sweep_giant_tours (cvrp_t *self, size_t num_expected) {
     }
 
     print_info ("generated: %zu\n", listx_size (genomes));
-    free (polars);
     listu_free (&hashes);
     route_free (&gtour_template);
     return genomes;
@@ -586,7 +695,8 @@ static listx_t *cvrp_random_giant_tours (cvrp_t *self, size_t num_expected) {
     if (num_expected > max_expected)
         num_expected = max_expected;
 
-    route_t *gtour_template = route_new (self->num_customers);
+    route_t *gtour_template =
+        route_new_in_arena (self->arena, self->num_customers);
     for (size_t idx = 1; idx <= self->num_customers; idx++)
         route_append_node (gtour_template, self->nodes[idx].id);
 
@@ -1045,6 +1155,13 @@ static double cvrp_post_optimize (cvrp_t *self, solution_t *sol) {
         }
     }
 
+    // Integer distances: tracked cost is exact
+    assert (!vrp_integer_distances (self->vrp) ||
+            solution_total_distance (sol) ==
+            solution_cal_total_distance (sol,
+                                         self->vrp,
+                                         (vrp_arc_distance_t) vrp_arc_distance));
+
     print_info ("cal cost after post optimization: %.2f\n",
                 solution_cal_total_distance (sol,
                                              self->vrp,
@@ -1118,6 +1235,223 @@ static solution_t *cvrp_solve_small_model (cvrp_t *self) {
 }
 
 
+// ----------------------------------------------------------------------------
+// Warm start
+
+// Insert customer node at cheapest position which keeps capacity, or in a new
+// route if there is no such position.
+// Return increase of total distance.
+static double cvrp_insert_cheapest (cvrp_t *self, solution_t *sol,
+                                    size_t node_id) {
+    double demand = cvrp_node_demand (self, node_id);
+    route_t *best_route = NULL;
+    size_t best_idx = 0;
+    double best_dcost = DOUBLE_MAX;
+
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        route_t *route = solution_route (sol, idx_r);
+        if (cvrp_route_demand (self, route) + demand > self->capacity)
+            continue;
+        for (size_t idx = 1; idx < route_size (route); idx++) {
+            double dcost =
+                route_insert_node_delta_distance (route, idx, node_id,
+                                                  self->vrp,
+                                                  (vrp_arc_distance_t) vrp_arc_distance);
+            if (dcost < best_dcost) {
+                best_dcost = dcost;
+                best_route = route;
+                best_idx = idx;
+            }
+        }
+    }
+
+    if (best_route != NULL) {
+        route_insert_node (best_route, best_idx, node_id);
+        return best_dcost;
+    }
+
+    size_t depot = self->nodes[0].id;
+    route_t *route = route_new (3);
+    route_append_node (route, depot);
+    route_append_node (route, node_id);
+    route_append_node (route, depot);
+    solution_append_route (sol, route);
+    return cvrp_route_distance (self, route);
+}
+
+
+// Repair previous solution for current customers: cancelled customers are
+// removed, and new ones are inserted by cheapest insertion. Route of vehicle
+// with fixed prefix starts at its anchor, and keeps only customers after it.
+static solution_t *cvrp_repair_solution (cvrp_t *self,
+                                         const solution_t *previous) {
+    size_t depot = self->nodes[0].id;
+    size_t num_nodes = self->num_customers + self->num_anchors + 1;
+    bool *planned =
+        (bool *) arena_alloc (self->arena, num_nodes * sizeof (bool));
+    assert (planned);
+    for (size_t idx = 1; idx < num_nodes; idx++)
+        planned[idx] = false;
+
+    // Solution is returned to user, so it is not in arena
+    solution_t *sol = solution_new ();
+    assert (sol);
+    for (size_t idx_r = 0; idx_r < solution_num_routes (previous); idx_r++) {
+        const route_t *prev_route = solution_route (previous, idx_r);
+        route_t *route = route_new (route_size (prev_route) + 2);
+        route_append_node (route, depot);
+        for (size_t idx = 0; idx < route_size (prev_route); idx++) {
+            size_t node = route_at (prev_route, idx);
+            size_t k = cvrp_node_idx (self, node);
+            if (k == SIZE_NONE || k == 0 || planned[k])
+                continue;
+            if (k > self->num_customers) {
+                // Anchor: stops before it are executed or left to insertion
+                for (size_t n = 1; n < route_size (route); n++)
+                    planned[cvrp_node_idx (self, route_at (route, n))] = false;
+                route_free (&route);
+                route = route_new (route_size (prev_route) + 1);
+            }
+            route_append_node (route, node);
+            planned[k] = true;
+        }
+        route_append_node (route, depot);
+
+        // Previous route may exceed capacity if quantities are changed
+        bool anchored = (route_at (route, 0) != depot);
+        if ((route_size (route) > 2 || anchored) &&
+            cvrp_route_demand (self, route) <= self->capacity)
+            solution_append_route (sol, route);
+        else {
+            for (size_t idx = 0; idx + 1 < route_size (route); idx++) {
+                if (route_at (route, idx) != depot)
+                    planned[cvrp_node_idx (self, route_at (route, idx))] =
+                        false;
+            }
+            route_free (&route);
+        }
+    }
+
+    // Vehicles with fixed prefix not found in previous solution
+    for (size_t idx = self->num_customers + 1; idx < num_nodes; idx++) {
+        if (!planned[idx]) {
+            route_t *route = route_new (2);
+            route_append_node (route, self->nodes[idx].id);
+            route_append_node (route, depot);
+            solution_append_route (sol, route);
+        }
+    }
+
+    for (size_t idx = 1; idx <= self->num_customers; idx++) {
+        if (!planned[idx])
+            cvrp_insert_cheapest (self, sol, self->nodes[idx].id);
+    }
+    arena_release (planned);
+
+    solution_cal_set_total_distance (sol,
+                                     self->vrp,
+                                     (vrp_arc_distance_t) vrp_arc_distance);
+    return sol;
+}
+
+
+// Local search which keeps route starts (depot or anchor): move each customer
+// to its cheapest position until no move improves.
+// Return saving.
+static double cvrp_relocate_nodes (cvrp_t *self, solution_t *sol) {
+    size_t depot = self->nodes[0].id;
+    double saving = 0;
+    bool improved = true;
+
+    while (improved) {
+        improved = false;
+        for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+            route_t *route = solution_route (sol, idx_r);
+            for (size_t idx = 1; idx + 1 < route_size (route); idx++) {
+                size_t node = route_at (route, idx);
+                double dcost_remove =
+                    route_remove_node_delta_distance (
+                                    route, idx,
+                                    self->vrp,
+                                    (vrp_arc_distance_t) vrp_arc_distance);
+                route_remove_node (route, idx);
+
+                // Original position is a candidate, so node is moved only if
+                // it is cheaper elsewhere
+                double dcost = dcost_remove +
+                               cvrp_insert_cheapest (self, sol, node);
+                saving -= dcost;
+                if (dcost < -1e-9)
+                    improved = true;
+
+                if (route_size (route) == 2 && route_at (route, 0) == depot) {
+                    solution_remove_route (sol, idx_r--);
+                    break;
+                }
+            }
+        }
+    }
+
+    solution_increase_total_distance (sol, -saving);
+    return saving;
+}
+
+
+// Restore depot and the fixed prefix before anchor at start of routes
+static void cvrp_restore_fixed_prefixes (cvrp_t *self, solution_t *sol) {
+    size_t depot = self->nodes[0].id;
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        route_t *route = solution_route (sol, idx_r);
+        size_t first = route_at (route, 0);
+        if (first == depot)
+            continue;
+        const s_node_t *anchor = &self->nodes[cvrp_node_idx (self, first)];
+        assert (anchor->fixed_node_ids != NULL);
+        route_insert_node (route, 0, depot);
+        for (size_t k = 0; k + 1 < listu_size (anchor->fixed_node_ids); k++)
+            route_insert_node (route, k + 1,
+                               listu_get (anchor->fixed_node_ids, k));
+    }
+    solution_cal_set_total_distance (sol,
+                                     self->vrp,
+                                     (vrp_arc_distance_t) vrp_arc_distance);
+}
+
+
+// Perturbation of solution: remove a few random customers and insert them
+// back by cheapest insertion
+static solution_t *cvrp_perturb_solution (cvrp_t *self,
+                                          const solution_t *sol) {
+    solution_t *perturbed = solution_dup (sol);
+    size_t num_removed = max2 (2, self->num_customers / 10);
+    listu_t *removed = listu_new (num_removed);
+
+    for (size_t cnt = 0; cnt < num_removed; cnt++) {
+        if (solution_num_routes (perturbed) == 0)
+            break;
+        size_t idx_r = rng_random_int (self->rng, 0,
+                                       solution_num_routes (perturbed));
+        route_t *route = solution_route (perturbed, idx_r);
+        if (route_size (route) == 2) // anchor route without customers
+            continue;
+        size_t idx = rng_random_int (self->rng, 1, route_size (route) - 1);
+        listu_append (removed, route_at (route, idx));
+        route_remove_node (route, idx);
+        if (route_size (route) == 2 && route_at (route, 0) == self->nodes[0].id)
+            solution_remove_route (perturbed, idx_r);
+    }
+
+    for (size_t idx = 0; idx < listu_size (removed); idx++)
+        cvrp_insert_cheapest (self, perturbed, listu_get (removed, idx));
+    listu_free (&removed);
+
+    solution_cal_set_total_distance (perturbed,
+                                     self->vrp,
+                                     (vrp_arc_distance_t) vrp_arc_distance);
+    return perturbed;
+}
+
+
 // ----------------------------------------------------------------------------
 
 cvrp_t *cvrp_new_from_generic (vrp_t *vrp) {
@@ -1127,18 +1461,23 @@ cvrp_t *cvrp_new_from_generic (vrp_t *vrp) {
     assert (self);
 
     self->vrp = vrp;
+    self->arena = vrp_new_arena (vrp);
 
     self->num_vehicles = vrp_num_vehicles (vrp);
 
     size_t one_vehicle = listu_get (vrp_vehicles (vrp), 0);
     self->capacity = vrp_vehicle_capacity (vrp, one_vehicle);
 
-    const listu_t *requests = vrp_pending_request_ids (vrp);
+    // Customers: pending requests merged by vrp_solve ()
+    const listu_t *requests = vrp_customer_request_ids (vrp);
     size_t num_requests = listu_size (requests);
     assert (num_requests > 0);
 
     self->nodes =
-        (s_node_t *) malloc (sizeof (s_node_t) * (vrp_num_receivers (vrp) + 1));
+        (s_node_t *) arena_alloc (self->arena,
+                                  sizeof (s_node_t) *
+                                  (num_requests + 1 +
+                                   vrp_num_fixed_vehicles (vrp)));
     assert (self->nodes);
     self->nodes[0].id = ID_NONE;
     self->num_customers = num_requests;
@@ -1156,17 +1495,53 @@ cvrp_t *cvrp_new_from_generic (vrp_t *vrp) {
             // printf ("depot set to: %zu\n", self->nodes[0].id);
             self->nodes[0].demand = 0;
             self->nodes[0].coord = vrp_node_coord (vrp, self->nodes[0].id);
+            self->nodes[0].fixed_node_ids = NULL;
         }
         assert (self->nodes[0].id == vrp_request_sender (vrp, request));
 
         // customer
         self->nodes[idx+1].id = vrp_request_receiver (vrp, request);
-        self->nodes[idx+1].demand = vrp_request_quantity (vrp, request);
+        self->nodes[idx+1].demand = vrp_customer_quantity (vrp, request);
         self->nodes[idx+1].coord =
             vrp_node_coord (vrp, self->nodes[idx+1].id);
+        self->nodes[idx+1].fixed_node_ids = NULL;
         // printf ("customer added: %zu\n", self->nodes[idx+1].id);
     }
 
+    // anchors of vehicles with fixed route prefix
+    self->num_anchors = 0;
+    const listu_t *vehicles = vrp_vehicles (vrp);
+    for (size_t idx = 0; idx < listu_size (vehicles); idx++) {
+        size_t vehicle = listu_get (vehicles, idx);
+        const listu_t *prefix = vrp_vehicle_fixed_node_ids (vrp, vehicle);
+        if (prefix == NULL)
+            continue;
+        s_node_t *anchor =
+            &self->nodes[self->num_customers + 1 + self->num_anchors++];
+        anchor->id = listu_last (prefix);
+        anchor->demand = vrp_vehicle_fixed_quantity (vrp, vehicle);
+        anchor->coord = vrp_node_coord (vrp, anchor->id);
+        anchor->fixed_node_ids = prefix;
+    }
+
+    // Node ID to index. Stop of a fixed prefix has no pending request left
+    // (see vrp_fix_route_prefix ()), so anchors never share ID with customers.
+    size_t num_nodes = self->num_customers + self->num_anchors + 1;
+    self->max_node_id = 0;
+    for (size_t idx = 0; idx < num_nodes; idx++)
+        self->max_node_id = max2 (self->max_node_id, self->nodes[idx].id);
+    self->node_idx =
+        (size_t *) arena_alloc (self->arena,
+                                (self->max_node_id + 1) * sizeof (size_t));
+    assert (self->node_idx);
+    for (size_t id = 0; id <= self->max_node_id; id++)
+        self->node_idx[id] = SIZE_NONE;
+    for (size_t idx = 0; idx < num_nodes; idx++) {
+        assert (self->node_idx[self->nodes[idx].id] == SIZE_NONE);
+        self->node_idx[self->nodes[idx].id] = idx;
+    }
+
+    self->sweep_order = NULL;
     self->rng = rng_new ();
     return self;
 }
@@ -1177,8 +1552,8 @@ void cvrp_free (cvrp_t **self_p) {
     if (*self_p) {
         cvrp_t *self = *self_p;
 
-        free (self->nodes);
         rng_free (&self->rng);
+        arena_free (&self->arena); // nodes and all other objects in arena
 
         free (self);
         *self_p = NULL;
@@ -1233,15 +1608,66 @@ solution_t *cvrp_solve (cvrp_t *self) {
 }
 
 
+solution_t *cvrp_resolve (cvrp_t *self, const solution_t *previous) {
+    assert (self);
+    assert (previous);
+
+    solution_t *sol = cvrp_repair_solution (self, previous);
+    assert (cvrp_solution_is_feasible (self, sol));
+
+    // Post optimization may move anything, so routes from anchors are only
+    // improved by relocation
+    if (self->num_anchors == 0)
+        cvrp_post_optimize (self, sol);
+    else
+        cvrp_relocate_nodes (self, sol);
+
+    // Local search from perturbations of repaired plan
+    for (size_t cnt = 0; cnt < NUM_WARM_START_PERTURBATIONS; cnt++) {
+        solution_t *candidate = cvrp_perturb_solution (self, sol);
+        if (self->num_anchors == 0)
+            cvrp_post_optimize (self, candidate);
+        else
+            cvrp_relocate_nodes (self, candidate);
+        if (solution_total_distance (candidate) < solution_total_distance (sol)) {
+            solution_free (&sol);
+            sol = candidate;
+        }
+        else
+            solution_free (&candidate);
+    }
+
+    cvrp_print_solution (self, sol);
+    if (self->num_anchors > 0)
+        cvrp_restore_fixed_prefixes (self, sol);
+    return sol;
+}
+
+
 void cvrp_test (bool verbose) {
     print_info ("* cvrp: \n");
 
-    char filename[] =
-        "benchmark/cvrp/A-n32-k5.vrp";
-        // "benchmark/tsplib/tsp/berlin52.tsp";
-        // "benchmark/tsplib/tsp/a280.tsp";
+    // Small instance in TSPLIB format, with 2 vehicles ("k2" of filename)
+    const char *filename = "cvrp-test-k2.vrp";
+    FILE *file = fopen (filename, "w");
+    assert (file);
+    fputs ("NAME : cvrp-test-k2\n"
+           "TYPE : CVRP\n"
+           "DIMENSION : 9\n"
+           "EDGE_WEIGHT_TYPE : EUC_2D\n"
+           "CAPACITY : 30\n"
+           "NODE_COORD_SECTION\n"
+           " 1 50 50\n 2 20 20\n 3 80 20\n 4 20 80\n 5 80 80\n"
+           " 6 50 90\n 7 10 50\n 8 90 50\n 9 50 10\n"
+           "DEMAND_SECTION\n"
+           "1 0\n2 5\n3 7\n4 6\n5 8\n6 4\n7 5\n8 6\n9 7\n"
+           "DEPOT_SECTION\n"
+           " 1\n -1\n"
+           "EOF\n", file);
+    fclose (file);
 
     vrp_t *vrp = vrp_new_from_file (filename);
+    remove (filename);
     assert (vrp);
 
     printf ("#nodes: %zu\n", vrp_num_nodes (vrp));
@@ -21,6 +21,10 @@ void cvrp_free (cvrp_t **self_p);
 // Solve
 solution_t *cvrp_solve (cvrp_t *self);
 
+// Solve starting from previous solution (with generic node IDs) of model
+// before requests were added or cancelled
+solution_t *cvrp_resolve (cvrp_t *self, const solution_t *previous);
+
 // Self test
 void cvrp_test (bool verbose);
 
@@ -0,0 +1,499 @@
+/*  =========================================================================
+    roadnet - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+#include <pthread.h>
+
+
+#define ROADNET_SOURCES_PER_TASK 4 // sources taken by a worker at a time
+#define ROADNET_MIN_SOURCES_PER_THREAD 16 // below this, fewer threads
+
+
+struct _roadnet_t {
+    size_t num_vertices;
+    size_t num_edges;
+    size_t *offsets; // out-edges of vertex v: [offsets[v], offsets[v+1])
+    size_t *heads; // head vertex of edge
+    double *lengths; // length of edge
+    double *travel_times; // travel time of edge, or NULL
+};
+
+
+roadnet_t *roadnet_new (size_t num_vertices,
+                        const size_t *tails,
+                        const size_t *heads,
+                        const double *lengths,
+                        const double *travel_times,
+                        size_t num_edges) {
+    assert (tails);
+    assert (heads);
+    assert (lengths);
+
+    roadnet_t *self = (roadnet_t *) malloc (sizeof (roadnet_t));
+    assert (self);
+    self->num_vertices = num_vertices;
+    self->num_edges = num_edges;
+    self->offsets = (size_t *) calloc (num_vertices + 1, sizeof (size_t));
+    self->heads = (size_t *) malloc ((num_edges + 1) * sizeof (size_t));
+    self->lengths = (double *) malloc ((num_edges + 1) * sizeof (double));
+    assert (self->offsets && self->heads && self->lengths);
+    self->travel_times = NULL;
+    if (travel_times != NULL) {
+        self->travel_times =
+            (double *) malloc ((num_edges + 1) * sizeof (double));
+        assert (self->travel_times);
+    }
+
+    // Counting sort of edges by tail
+    for (size_t k = 0; k < num_edges; k++) {
+        assert (tails[k] < num_vertices && heads[k] < num_vertices);
+        assert (lengths[k] >= 0);
+        self->offsets[tails[k] + 1]++;
+    }
+    for (size_t v = 0; v < num_vertices; v++)
+        self->offsets[v + 1] += self->offsets[v];
+
+    size_t *cursors = (size_t *) malloc ((num_vertices + 1) * sizeof (size_t));
+    assert (cursors);
+    memcpy (cursors, self->offsets, num_vertices * sizeof (size_t));
+    for (size_t k = 0; k < num_edges; k++) {
+        size_t pos = cursors[tails[k]]++;
+        self->heads[pos] = heads[k];
+        self->lengths[pos] = lengths[k];
+        if (travel_times != NULL)
+            self->travel_times[pos] = travel_times[k];
+    }
+    free (cursors);
+
+    return self;
+}
+
+
+void roadnet_free (roadnet_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        roadnet_t *self = *self_p;
+        free (self->offsets);
+        free (self->heads);
+        free (self->lengths);
+        free (self->travel_times);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+size_t roadnet_num_vertices (const roadnet_t *self) {
+    assert (self);
+    return self->num_vertices;
+}
+
+
+size_t roadnet_num_edges (const roadnet_t *self) {
+    assert (self);
+    return self->num_edges;
+}
+
+
+bool roadnet_has_travel_times (const roadnet_t *self) {
+    assert (self);
+    return self->travel_times != NULL;
+}
+
+
+// ---------------------------------------------------------------------------
+// Many-to-many search
+
+typedef struct {
+    double length;
+    size_t vertex;
+} s_heap_item_t;
+
+
+// Search state of one thread. Labels are valid only if their stamp is the
+// stamp of current search, so nothing is cleared between searches.
+typedef struct {
+    double *lengths;
+    double *times;
+    size_t *stamps; // stamp of search which reached vertex
+    bool *settled;
+    size_t stamp;
+
+    s_heap_item_t *heap; // binary min-heap, with stale items
+    size_t heap_size;
+    size_t heap_alloc_size;
+} s_search_t;
+
+
+typedef struct {
+    const roadnet_t *net;
+    arcmatrix_t *distances;
+    arcmatrix_t *durations;
+    const size_t *vertices;
+    const size_t *ids;
+    size_t num_points;
+
+    size_t *target_counts; // number of points at each vertex
+    size_t num_target_vertices; // number of distinct vertices of points
+
+    pthread_mutex_t mutex;
+    size_t next_source; // next source point to be taken
+} s_job_t;
+
+
+static void s_heap_push (s_search_t *search, double length, size_t vertex) {
+    if (search->heap_size == search->heap_alloc_size) {
+        search->heap_alloc_size *= 2;
+        search->heap = (s_heap_item_t *)
+            realloc (search->heap,
+                     search->heap_alloc_size * sizeof (s_heap_item_t));
+        assert (search->heap);
+    }
+    s_heap_item_t *heap = search->heap;
+    size_t idx = search->heap_size++;
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (heap[parent].length <= length)
+            break;
+        heap[idx] = heap[parent];
+        idx = parent;
+    }
+    heap[idx].length = length;
+    heap[idx].vertex = vertex;
+}
+
+
+static s_heap_item_t s_heap_pop (s_search_t *search) {
+    s_heap_item_t *heap = search->heap;
+    s_heap_item_t top = heap[0];
+    s_heap_item_t last = heap[--search->heap_size];
+    size_t size = search->heap_size;
+    size_t idx = 0;
+    while (true) {
+        size_t child = 2 * idx + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && heap[child + 1].length < heap[child].length)
+            child++;
+        if (last.length <= heap[child].length)
+            break;
+        heap[idx] = heap[child];
+        idx = child;
+    }
+    if (size > 0)
+        heap[idx] = last;
+    return top;
+}
+
+
+// Dijkstra search on length from source vertex, until all target vertices
+// are settled
+static void s_search (const s_job_t *job, s_search_t *search, size_t source) {
+    const roadnet_t *net = job->net;
+    size_t stamp = ++search->stamp;
+    search->heap_size = 0;
+
+    search->lengths[source] = 0;
+    search->times[source] = 0;
+    search->stamps[source] = stamp;
+    search->settled[source] = false;
+    s_heap_push (search, 0, source);
+
+    size_t num_targets_left = job->num_target_vertices;
+    while (search->heap_size > 0 && num_targets_left > 0) {
+        s_heap_item_t item = s_heap_pop (search);
+        size_t v = item.vertex;
+        if (search->settled[v] || item.length > search->lengths[v])
+            continue; // stale
+        search->settled[v] = true;
+        if (job->target_counts[v] > 0)
+            num_targets_left--;
+
+        for (size_t e = net->offsets[v]; e < net->offsets[v + 1]; e++) {
+            size_t w = net->heads[e];
+            double length = item.length + net->lengths[e];
+            if (search->stamps[w] != stamp) {
+                search->stamps[w] = stamp;
+                search->settled[w] = false;
+            }
+            else if (search->settled[w] || length >= search->lengths[w])
+                continue;
+            search->lengths[w] = length;
+            search->times[w] = search->times[v] +
+                (net->travel_times != NULL ? net->travel_times[e] : 0);
+            s_heap_push (search, length, w);
+        }
+    }
+}
+
+
+static void *s_worker (void *args) {
+    s_job_t *job = (s_job_t *) args;
+    size_t num_vertices = job->net->num_vertices;
+    bool symmetric = arcmatrix_is_symmetric (job->distances);
+
+    s_search_t search;
+    search.lengths = (double *) malloc ((num_vertices + 1) * sizeof (double));
+    search.times = (double *) malloc ((num_vertices + 1) * sizeof (double));
+    search.stamps = (size_t *) calloc (num_vertices + 1, sizeof (size_t));
+    search.settled = (bool *) malloc ((num_vertices + 1) * sizeof (bool));
+    search.stamp = 0;
+    search.heap_alloc_size = 64;
+    search.heap_size = 0;
+    search.heap =
+        (s_heap_item_t *) malloc (search.heap_alloc_size * sizeof (s_heap_item_t));
+    assert (search.lengths && search.times && search.stamps &&
+            search.settled && search.heap);
+
+    // Row buffers: reached targets only
+    size_t *cols = (size_t *) malloc ((job->num_points + 1) * sizeof (size_t));
+    double *lengths = (double *) malloc ((job->num_points + 1) * sizeof (double));
+    double *times = (double *) malloc ((job->num_points + 1) * sizeof (double));
+    assert (cols && lengths && times);
+
+    while (true) {
+        pthread_mutex_lock (&job->mutex);
+        size_t begin = job->next_source;
+        size_t end = min2 (begin + ROADNET_SOURCES_PER_TASK, job->num_points);
+        job->next_source = end;
+        pthread_mutex_unlock (&job->mutex);
+        if (begin >= end)
+            break;
+
+        for (size_t i = begin; i < end; i++) {
+            s_search (job, &search, job->vertices[i]);
+
+            // Symmetric matrix: lower triangle only, each pair set once
+            size_t row_size = symmetric ? i + 1 : job->num_points;
+            size_t num_reached = 0;
+            for (size_t j = 0; j < row_size; j++) {
+                size_t w = job->vertices[j];
+                if (search.stamps[w] != search.stamp || !search.settled[w])
+                    continue;
+                cols[num_reached] = job->ids[j];
+                lengths[num_reached] = (i != j) ? search.lengths[w] : 0;
+                times[num_reached] = (i != j) ? search.times[w] : 0;
+                num_reached++;
+            }
+            arcmatrix_set_row (job->distances, job->ids[i],
+                               cols, lengths, num_reached);
+            if (job->durations != NULL)
+                arcmatrix_set_row (job->durations, job->ids[i],
+                                   cols, times, num_reached);
+        }
+    }
+
+    free (cols);
+    free (lengths);
+    free (times);
+    free (search.lengths);
+    free (search.times);
+    free (search.stamps);
+    free (search.settled);
+    free (search.heap);
+    return NULL;
+}
+
+
+void roadnet_fill_matrices (const roadnet_t *self,
+                            arcmatrix_t *distances,
+                            arcmatrix_t *durations,
+                            const size_t *vertices,
+                            const size_t *ids,
+                            size_t num_points,
+                            size_t num_threads) {
+    assert (self);
+    assert (distances);
+    assert (vertices);
+    assert (ids);
+    assert (durations == NULL ||
+            arcmatrix_is_symmetric (durations) ==
+            arcmatrix_is_symmetric (distances));
+    if (num_points == 0)
+        return;
+
+    s_job_t job;
+    job.net = self;
+    job.distances = distances;
+    job.durations = durations;
+    job.vertices = vertices;
+    job.ids = ids;
+    job.num_points = num_points;
+    job.next_source = 0;
+    pthread_mutex_init (&job.mutex, NULL);
+
+    job.target_counts =
+        (size_t *) calloc (self->num_vertices + 1, sizeof (size_t));
+    assert (job.target_counts);
+    job.num_target_vertices = 0;
+    for (size_t k = 0; k < num_points; k++) {
+        assert (vertices[k] < self->num_vertices);
+        if (job.target_counts[vertices[k]]++ == 0)
+            job.num_target_vertices++;
+    }
+
+    // Threads. Automatic number is limited for few sources.
+    if (num_threads == 0)
+        num_threads = max2 (min2 (num_online_processors (),
+                                  num_points / ROADNET_MIN_SOURCES_PER_THREAD),
+                            1);
+
+    pthread_t *threads =
+        (pthread_t *) malloc (num_threads * sizeof (pthread_t));
+    assert (threads);
+    size_t num_started = 0;
+    for (size_t idx = 1; idx < num_threads; idx++) {
+        if (pthread_create (&threads[num_started], NULL, s_worker, &job) == 0)
+            num_started++;
+    }
+    s_worker (&job); // calling thread works too
+    for (size_t idx = 0; idx < num_started; idx++)
+        pthread_join (threads[idx], NULL);
+
+    free (threads);
+    free (job.target_counts);
+    pthread_mutex_destroy (&job.mutex);
+}
+
+
+// All-pairs shortest path lengths by Floyd-Warshall, for test.
+// Unreachable pairs are DOUBLE_MAX.
+static double *s_all_pairs (size_t n,
+                            const size_t *tails,
+                            const size_t *heads,
+                            const double *lengths,
+                            size_t num_edges) {
+    double *ref = (double *) malloc (n * n * sizeof (double));
+    assert (ref);
+    for (size_t i = 0; i < n * n; i++)
+        ref[i] = DOUBLE_MAX;
+    for (size_t i = 0; i < n; i++)
+        ref[i * n + i] = 0;
+    for (size_t k = 0; k < num_edges; k++)
+        ref[tails[k] * n + heads[k]] =
+            min2 (ref[tails[k] * n + heads[k]], lengths[k]);
+    for (size_t k = 0; k < n; k++)
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                if (ref[i * n + k] + ref[k * n + j] < ref[i * n + j])
+                    ref[i * n + j] = ref[i * n + k] + ref[k * n + j];
+    return ref;
+}
+
+
+void roadnet_test (bool verbose) {
+    print_info (" * roadnet: \n");
+
+    // Grid of side x side vertices, with random edge lengths one way and
+    // travel time 2 per edge. Last vertex is isolated.
+    size_t side = 12;
+    size_t num_vertices = side * side + 1;
+    size_t max_edges = 4 * side * side;
+    size_t *tails = (size_t *) malloc (max_edges * sizeof (size_t));
+    size_t *heads = (size_t *) malloc (max_edges * sizeof (size_t));
+    double *lengths = (double *) malloc (max_edges * sizeof (double));
+    double *times = (double *) malloc (max_edges * sizeof (double));
+    assert (tails && heads && lengths && times);
+
+    rng_t *rng = rng_new ();
+    size_t num_edges = 0;
+    for (size_t r = 0; r < side; r++) {
+        for (size_t c = 0; c < side; c++) {
+            size_t v = r * side + c;
+            size_t neighbors[4] = {
+                (c + 1 < side) ? v + 1 : ID_NONE,
+                (c > 0) ? v - 1 : ID_NONE,
+                (r + 1 < side) ? v + side : ID_NONE,
+                (r > 0) ? v - side : ID_NONE
+            };
+            for (size_t k = 0; k < 4; k++) {
+                if (neighbors[k] == ID_NONE)
+                    continue;
+                tails[num_edges] = v;
+                heads[num_edges] = neighbors[k];
+                lengths[num_edges] = (double) rng_random_int (rng, 1, 10);
+                times[num_edges] = 2;
+                num_edges++;
+            }
+        }
+    }
+
+    roadnet_t *net =
+        roadnet_new (num_vertices, tails, heads, lengths, times, num_edges);
+    assert (roadnet_num_vertices (net) == num_vertices);
+    assert (roadnet_num_edges (net) == num_edges);
+    assert (roadnet_has_travel_times (net));
+
+    size_t n = num_vertices;
+    double *ref = s_all_pairs (n, tails, heads, lengths, num_edges);
+
+    // Points: every third vertex, and the isolated one
+    size_t num_points = 0;
+    size_t *vertices = (size_t *) malloc (n * sizeof (size_t));
+    size_t *ids = (size_t *) malloc (n * sizeof (size_t));
+    assert (vertices && ids);
+    for (size_t v = 0; v + 1 < n; v += 3) {
+        vertices[num_points] = v;
+        ids[num_points] = 2 * num_points + 1;
+        num_points++;
+    }
+    vertices[num_points] = n - 1;
+    ids[num_points] = 2 * num_points + 1;
+    num_points++;
+    size_t order = 2 * num_points + 2;
+
+    for (size_t num_threads = 1; num_threads <= 4; num_threads += 3) {
+        arcmatrix_t *distances = arcmatrix_new (AM_FLOAT64, false, order);
+        arcmatrix_t *durations = arcmatrix_new (AM_SIZE, false, order);
+        roadnet_fill_matrices (net, distances, durations,
+                               vertices, ids, num_points, num_threads);
+        for (size_t i = 0; i < num_points; i++) {
+            for (size_t j = 0; j < num_points; j++) {
+                double expected = ref[vertices[i] * n + vertices[j]];
+                if (expected == DOUBLE_MAX) {
+                    assert (!arcmatrix_is_set (distances, ids[i], ids[j]));
+                    continue;
+                }
+                assert (arcmatrix_get (distances, ids[i], ids[j]) == expected);
+                // Travel time is along a shortest path, 2 per edge
+                size_t duration = arcmatrix_get_size (durations, ids[i], ids[j]);
+                assert (duration % 2 == 0);
+                assert ((double) duration <= 2 * expected);
+            }
+        }
+        arcmatrix_free (&distances);
+        arcmatrix_free (&durations);
+    }
+
+    // Symmetric network with symmetric storage
+    for (size_t k = 0; k < num_edges; k++)
+        lengths[k] = (double) (tails[k] + heads[k]);
+    roadnet_free (&net);
+    net = roadnet_new (num_vertices, tails, heads, lengths, NULL, num_edges);
+    assert (!roadnet_has_travel_times (net));
+    free (ref);
+    ref = s_all_pairs (n, tails, heads, lengths, num_edges);
+    arcmatrix_t *distances = arcmatrix_new (AM_INT32, true, order);
+    roadnet_fill_matrices (net, distances, NULL, vertices, ids, num_points, 0);
+    for (size_t i = 0; i + 1 < num_points; i++)
+        for (size_t j = 0; j + 1 < num_points; j++)
+            assert (arcmatrix_get (distances, ids[i], ids[j]) ==
+                    ref[vertices[i] * n + vertices[j]]);
+    arcmatrix_free (&distances);
+
+    free (ref);
+    free (vertices);
+    free (ids);
+    free (tails);
+    free (heads);
+    free (lengths);
+    free (times);
+    roadnet_free (&net);
+    rng_free (&rng);
+    assert (net == NULL);
+    print_info ("OK\n");
+}
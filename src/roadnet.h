@@ -0,0 +1,64 @@
+/*  =========================================================================
+    roadnet - road network and many-to-many shortest paths
+
+    Directed road network in compressed sparse row form: out-edges of each
+    vertex are stored contiguously, with length and travel time. Arc
+    matrices between points on the network are computed by one Dijkstra
+    search (on length) per source point, shared out among threads. Each
+    search stops once all target vertices are settled.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __ROADNET_H_INCLUDED__
+#define __ROADNET_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor.
+// Edge k goes from vertex tails[k] to vertex heads[k], with lengths[k] and
+// travel_times[k] (travel_times could be NULL).
+roadnet_t *roadnet_new (size_t num_vertices,
+                        const size_t *tails,
+                        const size_t *heads,
+                        const double *lengths,
+                        const double *travel_times,
+                        size_t num_edges);
+
+// Destructor
+void roadnet_free (roadnet_t **self_p);
+
+// Number of vertices
+size_t roadnet_num_vertices (const roadnet_t *self);
+
+// Number of edges
+size_t roadnet_num_edges (const roadnet_t *self);
+
+// Check if edges have travel times
+bool roadnet_has_travel_times (const roadnet_t *self);
+
+// Compute shortest paths between points on network, and set their lengths
+// in distances and their travel times in durations (could be NULL).
+// vertices[k] is the vertex of point k, ids[k] its matrix index. Matrices
+// should already be large enough. For symmetric matrices network is taken
+// as symmetric, and each pair is set once. Unreachable arcs are not set.
+// num_threads: number of worker threads, 0 for number of online processors.
+void roadnet_fill_matrices (const roadnet_t *self,
+                            arcmatrix_t *distances,
+                            arcmatrix_t *durations,
+                            const size_t *vertices,
+                            const size_t *ids,
+                            size_t num_points,
+                            size_t num_threads);
+
+// Self test
+void roadnet_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
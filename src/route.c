@@ -8,42 +8,146 @@
 #include "classes.h"
 
 
+struct _route_t {
+    size_t size; // number of nodes
+    size_t alloc_size; // capacity of nodes
+    size_t *nodes; // node array: inline_nodes or heap buffer
+    size_t inline_nodes[ROUTE_INLINE_SIZE]; // inline storage for short route
+    arena_t *arena; // arena which route is allocated from, NULL for heap
+};
+
+
+// Make sure that route could hold at least capacity nodes
+static void route_reserve (route_t *self, size_t capacity) {
+    if (capacity <= self->alloc_size)
+        return;
+
+    size_t new_alloc_size = self->alloc_size * 2;
+    if (new_alloc_size < capacity)
+        new_alloc_size = capacity;
+
+    if (self->nodes == self->inline_nodes) {
+        self->nodes = (self->arena != NULL) ?
+            (size_t *) arena_alloc (self->arena,
+                                    sizeof (size_t) * new_alloc_size) :
+            (size_t *) malloc (sizeof (size_t) * new_alloc_size);
+        assert (self->nodes);
+        memcpy (self->nodes, self->inline_nodes, sizeof (size_t) * self->size);
+    }
+    else {
+        self->nodes = (self->arena != NULL) ?
+            (size_t *) arena_realloc (self->arena, self->nodes,
+                                      sizeof (size_t) * new_alloc_size) :
+            (size_t *) realloc (self->nodes, sizeof (size_t) * new_alloc_size);
+        assert (self->nodes);
+    }
+    self->alloc_size = new_alloc_size;
+}
+
+
+// Reverse array in place
+static void s_reverse_array (size_t *array, size_t len) {
+    if (len < 2)
+        return;
+    for (size_t i = 0, j = len - 1; i < j; i++, j--) {
+        size_t tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+
 route_t *route_new (size_t alloc_size) {
-    return listu_new (alloc_size);
+    return route_new_in_arena (NULL, alloc_size);
+}
+
+
+route_t *route_new_in_arena (arena_t *arena, size_t alloc_size) {
+    route_t *self = (arena != NULL) ?
+                    (route_t *) arena_alloc (arena, sizeof (route_t)) :
+                    (route_t *) malloc (sizeof (route_t));
+    assert (self);
+
+    self->arena = arena;
+    self->size = 0;
+    self->nodes = self->inline_nodes;
+    self->alloc_size = ROUTE_INLINE_SIZE;
+    route_reserve (self, alloc_size);
+    return self;
 }
 
 
 route_t *route_new_from_array (const size_t *node_ids, size_t num_nodes) {
-    return listu_new_from_array (node_ids, num_nodes);
+    return route_new_from_array_in_arena (NULL, node_ids, num_nodes);
+}
+
+
+route_t *route_new_from_array_in_arena (arena_t *arena,
+                                        const size_t *node_ids,
+                                        size_t num_nodes) {
+    route_t *self = route_new_in_arena (arena, num_nodes);
+    if (num_nodes > 0) {
+        assert (node_ids);
+        memcpy (self->nodes, node_ids, sizeof (size_t) * num_nodes);
+    }
+    self->size = num_nodes;
+    return self;
 }
 
 
 route_t *route_new_from_list (const listu_t *node_ids) {
-    return listu_dup (node_ids);
+    assert (node_ids);
+    return route_new_from_array (listu_array (node_ids), listu_size (node_ids));
 }
 
 
 route_t *route_new_range (size_t start, size_t stop, int step) {
-    return listu_new_range (start, stop, step);
+    assert (step != 0);
+    route_t *self = route_new (0);
+    if (step > 0) {
+        for (size_t v = start; v < stop; v += (size_t) step)
+            route_append_node (self, v);
+    }
+    else {
+        for (size_t v = start; v > stop; v -= (size_t) (-step))
+            route_append_node (self, v);
+    }
+    return self;
 }
 
 
 void route_free (route_t **self_p) {
     assert (self_p);
-    listu_free (self_p);
+    if (*self_p) {
+        route_t *self = *self_p;
+        if (self->arena != NULL) {
+            if (self->nodes != self->inline_nodes)
+                arena_release (self->nodes);
+            arena_release (self);
+        }
+        else {
+            if (self->nodes != self->inline_nodes)
+                free (self->nodes);
+            free (self);
+        }
+        *self_p = NULL;
+    }
 }
 
 
 route_t *route_dup (const route_t *self) {
     assert (self);
-    return listu_dup (self);
+    return route_new_from_array_in_arena (self->arena, self->nodes, self->size);
 }
 
 
 bool route_equal (const route_t *self, const route_t *route) {
     assert (self);
     assert (route);
-    return listu_equal (self, route);
+    return self->size == route->size &&
+           (self->size == 0 ||
+            memcmp (self->nodes, route->nodes,
+                    sizeof (size_t) * self->size) == 0);
 }
 
 
@@ -58,45 +162,53 @@ void route_print (const route_t *self) {
 
 size_t route_size (const route_t *self) {
     assert (self);
-    return listu_size (self);
+    return self->size;
 }
 
 
 void route_set_at (route_t *self, size_t idx, size_t node_id) {
     assert (self);
     assert (idx < route_size (self));
-    listu_set (self, idx, node_id);
+    self->nodes[idx] = node_id;
 }
 
 
 size_t route_at (const route_t *self, size_t idx) {
     assert (self);
     assert (idx < route_size (self));
-    return listu_get (self, idx);
+    return self->nodes[idx];
 }
 
 
 const size_t *route_node_array (const route_t *self) {
     assert (self);
-    return listu_array (self);
+    return self->nodes;
 }
 
 
 void route_append_node (route_t *self, size_t node_id) {
     assert (self);
-    listu_append (self, node_id);
+    route_reserve (self, self->size + 1);
+    self->nodes[self->size++] = node_id;
 }
 
 
 size_t route_find (const route_t *self, size_t node_id) {
     assert (self);
-    return listu_find (self, node_id);
+    for (size_t idx = 0; idx < self->size; idx++)
+        if (self->nodes[idx] == node_id)
+            return idx;
+    return SIZE_NONE;
 }
 
 
 void route_swap_nodes (route_t *self, size_t idx1, size_t idx2) {
     assert (self);
-    listu_swap (self, idx1, idx2);
+    assert (idx1 < self->size);
+    assert (idx2 < self->size);
+    size_t tmp = self->nodes[idx1];
+    self->nodes[idx1] = self->nodes[idx2];
+    self->nodes[idx2] = tmp;
 }
 
 
@@ -117,13 +229,38 @@ double route_total_distance (const route_t *self,
 void route_shuffle (route_t *self,
                     size_t idx_begin, size_t idx_end, rng_t *rng) {
     assert (self);
-    listu_shuffle_slice (self, idx_begin, idx_end, rng);
+    assert (idx_begin <= idx_end);
+    assert (idx_end < self->size);
+
+    bool own_rng = false;
+    if (rng == NULL) {
+        rng = rng_new ();
+        own_rng = true;
+    }
+
+    // Fisher-Yates shuffle on slice
+    for (size_t idx = idx_end; idx > idx_begin; idx--)
+        route_swap_nodes (self, idx,
+                          (size_t) rng_random_int (rng, idx_begin, idx + 1));
+
+    if (own_rng)
+        rng_free (&rng);
 }
 
 
 void route_rotate (route_t *self, int num) {
     assert (self);
-    listu_rotate (self, num);
+    if (self->size < 2)
+        return;
+
+    // Right rotation by shift is done by three reversals
+    long len = (long) self->size;
+    size_t shift = (size_t) (((num % len) + len) % len);
+    if (shift == 0)
+        return;
+    s_reverse_array (self->nodes, self->size);
+    s_reverse_array (self->nodes, shift);
+    s_reverse_array (self->nodes + shift, self->size - shift);
 }
 
 
@@ -164,7 +301,9 @@ double route_reverse_delta_distance (const route_t *self,
 
 void route_reverse (route_t *self, size_t i, size_t j) {
     assert (self);
-    listu_reverse_slice (self, i, j);
+    assert (i <= j);
+    assert (j < self->size);
+    s_reverse_array (self->nodes + i, j - i + 1);
 }
 
 
@@ -220,7 +359,17 @@ double route_swap_slices_delata_distance (const route_t *self,
 
 void route_swap_slices (route_t *self, size_t i, size_t j, size_t u, size_t v) {
     assert (self);
-    listu_swap_slices (self, i, j, u, v);
+    assert (i <= j);
+    assert (j < u);
+    assert (u <= v);
+    assert (v < self->size);
+
+    // Reverse the whole range, then reverse each block back
+    size_t len_iv = v - i + 1, len_ij = j - i + 1, len_uv = v - u + 1;
+    s_reverse_array (self->nodes + i, len_iv);
+    s_reverse_array (self->nodes + i, len_uv);
+    s_reverse_array (self->nodes + i + len_uv, len_iv - len_uv - len_ij);
+    s_reverse_array (self->nodes + i + len_iv - len_ij, len_ij);
 }
 
 
@@ -252,7 +401,9 @@ double route_remove_node_delta_distance (route_t *self,
 void route_remove_node (route_t *self, size_t idx) {
     assert (self);
     assert (idx < route_size (self));
-    listu_remove_at (self, idx);
+    memmove (self->nodes + idx, self->nodes + idx + 1,
+             sizeof (size_t) * (self->size - idx - 1));
+    self->size--;
 }
 
 
@@ -284,7 +435,9 @@ double route_remove_link_delta_distance (route_t *self,
 void route_remove_link (route_t *self, size_t idx) {
     assert (self);
     assert (idx + 1 < route_size (self));
-    listu_remove_slice (self, idx, idx + 1);
+    memmove (self->nodes + idx, self->nodes + idx + 2,
+             sizeof (size_t) * (self->size - idx - 2));
+    self->size -= 2;
 }
 
 
@@ -312,7 +465,11 @@ double route_insert_node_delta_distance (const route_t *self,
 void route_insert_node (route_t *self, size_t idx, size_t node_id) {
     assert (self);
     assert (idx <= route_size (self));
-    listu_insert_at (self, idx, node_id);
+    route_reserve (self, self->size + 1);
+    memmove (self->nodes + idx + 1, self->nodes + idx,
+             sizeof (size_t) * (self->size - idx));
+    self->nodes[idx] = node_id;
+    self->size++;
 }
 
 
@@ -449,14 +606,20 @@ void route_exchange_tails (route_t *self, route_t *route,
 
     // Deal with remaining tail
     if (idx1 < size1 - 1) {
-        const size_t *array = route_node_array (self);
-        listu_extend_array (route, array + idx1 + 1, size1 - idx1 - 1);
-        listu_remove_slice (self, idx1 + 1, size1 - 1);
+        size_t len = size1 - idx1 - 1;
+        route_reserve (route, size2 + len);
+        memcpy (route->nodes + size2, self->nodes + idx1 + 1,
+                sizeof (size_t) * len);
+        route->size += len;
+        self->size -= len;
     }
     else if (idx2 < size2 - 1) {
-        const size_t *array = route_node_array (route);
-        listu_extend_array (self, array + idx2 + 1, size2 - idx2 - 1);
-        listu_remove_slice (route, idx2 + 1, size2 - 1);
+        size_t len = size2 - idx2 - 1;
+        route_reserve (self, size1 + len);
+        memcpy (self->nodes + size1, route->nodes + idx2 + 1,
+                sizeof (size_t) * len);
+        self->size += len;
+        route->size -= len;
     }
 }
 
@@ -507,14 +670,14 @@ void route_ox (route_t *route1, route_t *route2,
         tmp = P1[k];
         if (pos_c1 != i && !arrayu_includes (P1+i, len_fix, P2[k])) {
             // P1[pos_c1++] = P2[k];
-            listu_set (route1, start + pos_c1, P2[k]);
+            route_set_at (route1, start + pos_c1, P2[k]);
             pos_c1++;
             if (pos_c1 == n)
                 pos_c1 = 0;
         }
         if (pos_c2 != i && !arrayu_includes (P2+i, len_fix, tmp)) {
             // P2[pos_c2++] = tmp;
-            listu_set (route2, start + pos_c2, tmp);
+            route_set_at (route2, start + pos_c2, tmp);
             pos_c2++;
             if (pos_c2 == n)
                 pos_c2 = 0;
@@ -569,8 +732,55 @@ void route_ox (route_t *route1, route_t *route2,
 
 void route_test (bool verbose) {
     print_info (" * route: \n");
-    // roadnet_t *roadnet = roadnet_new ();
-    // // ...
-    // roadnet_free (&roadnet);
+
+    // Short route stays in inline storage, long route grows onto heap
+    route_t *r1 = route_new (0);
+    route_t *r2 = route_new_range (0, 3 * ROUTE_INLINE_SIZE, 1);
+    for (size_t idx = 0; idx < ROUTE_INLINE_SIZE; idx++)
+        route_append_node (r1, idx);
+    assert (route_size (r1) == ROUTE_INLINE_SIZE);
+    assert (route_size (r2) == 3 * ROUTE_INLINE_SIZE);
+    assert (route_at (r2, 3 * ROUTE_INLINE_SIZE - 1) ==
+            3 * ROUTE_INLINE_SIZE - 1);
+
+    route_insert_node (r1, 0, 100);
+    assert (route_at (r1, 0) == 100);
+    assert (route_find (r1, 100) == 0);
+    route_remove_node (r1, 0);
+    assert (route_find (r1, 100) == SIZE_NONE);
+
+    route_rotate (r1, 1);
+    assert (route_at (r1, 0) == ROUTE_INLINE_SIZE - 1);
+    route_rotate (r1, -1);
+    assert (route_at (r1, 0) == 0);
+
+    route_reverse (r1, 1, 3);
+    assert (route_at (r1, 1) == 3 && route_at (r1, 3) == 1);
+    route_reverse (r1, 1, 3);
+
+    // (0, 1, 2, 3, 4, 5, ...) => (0, 4, 5, 3, 1, 2, ...)
+    route_swap_slices (r1, 1, 2, 4, 5);
+    assert (route_at (r1, 1) == 4 && route_at (r1, 2) == 5);
+    assert (route_at (r1, 3) == 3);
+    assert (route_at (r1, 4) == 1 && route_at (r1, 5) == 2);
+    route_swap_slices (r1, 1, 2, 4, 5);
+    for (size_t idx = 0; idx < ROUTE_INLINE_SIZE; idx++)
+        assert (route_at (r1, idx) == idx);
+
+    route_t *r3 = route_dup (r2);
+    assert (route_equal (r2, r3));
+    route_shuffle (r3, 1, route_size (r3) - 2, NULL);
+    assert (route_at (r3, 0) == 0);
+    assert (route_size (r3) == route_size (r2));
+
+    size_t size1 = route_size (r1), size2 = route_size (r2);
+    route_exchange_tails (r1, r2, 1, 2);
+    assert (route_size (r1) + route_size (r2) == size1 + size2);
+    assert (route_size (r1) == 2 + size2 - 3);
+
+    route_free (&r1);
+    route_free (&r2);
+    route_free (&r3);
+    assert (r1 == NULL);
     print_info ("OK\n");
 }
@@ -0,0 +1,178 @@
+/*  =========================================================================
+    rowcache - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+#include <pthread.h>
+
+
+// Slots of one thread
+typedef struct _s_slots_t {
+    size_t *row_ids; // row in each slot, or SIZE_NONE
+    double **rows; // values of each slot, DOUBLE_NONE if not cached
+    size_t *row_sizes; // number of allocated values of each slot
+    struct _s_slots_t *next; // all slots are linked to be freed together
+} s_slots_t;
+
+
+struct _rowcache_t {
+    size_t num_rows;
+    pthread_key_t key; // slots of calling thread
+    pthread_mutex_t mutex; // guards slot list
+    s_slots_t *slots; // slots of all threads
+};
+
+
+static s_slots_t *s_slots_new (size_t num_rows) {
+    s_slots_t *self = (s_slots_t *) malloc (sizeof (s_slots_t));
+    assert (self);
+    self->row_ids = (size_t *) malloc (num_rows * sizeof (size_t));
+    self->rows = (double **) calloc (num_rows, sizeof (double *));
+    self->row_sizes = (size_t *) calloc (num_rows, sizeof (size_t));
+    assert (self->row_ids && self->rows && self->row_sizes);
+    for (size_t slot = 0; slot < num_rows; slot++)
+        self->row_ids[slot] = SIZE_NONE;
+    self->next = NULL;
+    return self;
+}
+
+
+static void s_slots_free (s_slots_t **self_p, size_t num_rows) {
+    if (*self_p) {
+        s_slots_t *self = *self_p;
+        for (size_t slot = 0; slot < num_rows; slot++)
+            free (self->rows[slot]);
+        free (self->rows);
+        free (self->row_ids);
+        free (self->row_sizes);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+// Fill values with DOUBLE_NONE
+static void s_fill_none (double *values, size_t num_values) {
+    for (size_t idx = 0; idx < num_values; idx++)
+        values[idx] = DOUBLE_NONE;
+}
+
+
+// Slots of calling thread. Created at first access.
+static s_slots_t *rowcache_slots (rowcache_t *self) {
+    s_slots_t *slots = (s_slots_t *) pthread_getspecific (self->key);
+    if (slots == NULL) {
+        slots = s_slots_new (self->num_rows);
+        pthread_setspecific (self->key, slots);
+        pthread_mutex_lock (&self->mutex);
+        slots->next = self->slots;
+        self->slots = slots;
+        pthread_mutex_unlock (&self->mutex);
+    }
+    return slots;
+}
+
+
+rowcache_t *rowcache_new (size_t num_rows) {
+    assert (num_rows > 0);
+    rowcache_t *self = (rowcache_t *) malloc (sizeof (rowcache_t));
+    assert (self);
+    self->num_rows = num_rows;
+    int rc = pthread_key_create (&self->key, NULL);
+    assert (rc == 0);
+    pthread_mutex_init (&self->mutex, NULL);
+    self->slots = NULL;
+    return self;
+}
+
+
+void rowcache_free (rowcache_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        rowcache_t *self = *self_p;
+        while (self->slots != NULL) {
+            s_slots_t *next = self->slots->next;
+            s_slots_free (&self->slots, self->num_rows);
+            self->slots = next;
+        }
+        pthread_key_delete (self->key);
+        pthread_mutex_destroy (&self->mutex);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+double rowcache_get (rowcache_t *self, size_t i, size_t j) {
+    assert (self);
+    s_slots_t *slots = rowcache_slots (self);
+    size_t slot = i % self->num_rows;
+    if (slots->row_ids[slot] != i || j >= slots->row_sizes[slot])
+        return DOUBLE_NONE;
+    return slots->rows[slot][j];
+}
+
+
+void rowcache_set (rowcache_t *self, size_t i, size_t j, double value) {
+    assert (self);
+    s_slots_t *slots = rowcache_slots (self);
+    size_t slot = i % self->num_rows;
+
+    if (slots->row_ids[slot] != i) {
+        s_fill_none (slots->rows[slot], slots->row_sizes[slot]);
+        slots->row_ids[slot] = i;
+    }
+
+    if (j >= slots->row_sizes[slot]) {
+        size_t size = max2 (j + 1, slots->row_sizes[slot] * 2);
+        slots->rows[slot] =
+            (double *) realloc (slots->rows[slot], size * sizeof (double));
+        assert (slots->rows[slot]);
+        s_fill_none (slots->rows[slot] + slots->row_sizes[slot],
+                     size - slots->row_sizes[slot]);
+        slots->row_sizes[slot] = size;
+    }
+
+    slots->rows[slot][j] = value;
+}
+
+
+void rowcache_clear (rowcache_t *self) {
+    assert (self);
+    pthread_mutex_lock (&self->mutex);
+    for (s_slots_t *slots = self->slots; slots != NULL; slots = slots->next) {
+        for (size_t slot = 0; slot < self->num_rows; slot++)
+            slots->row_ids[slot] = SIZE_NONE;
+    }
+    pthread_mutex_unlock (&self->mutex);
+}
+
+
+void rowcache_test (bool verbose) {
+    print_info (" * rowcache: \n");
+
+    rowcache_t *cache = rowcache_new (4);
+    assert (double_is_none (rowcache_get (cache, 1, 2)));
+
+    rowcache_set (cache, 1, 2, 12);
+    rowcache_set (cache, 1, 100, 1100);
+    assert (rowcache_get (cache, 1, 2) == 12);
+    assert (rowcache_get (cache, 1, 100) == 1100);
+    assert (double_is_none (rowcache_get (cache, 1, 3)));
+
+    // Row 5 takes slot of row 1
+    rowcache_set (cache, 5, 3, 53);
+    assert (rowcache_get (cache, 5, 3) == 53);
+    assert (double_is_none (rowcache_get (cache, 1, 2)));
+    assert (double_is_none (rowcache_get (cache, 5, 2)));
+
+    rowcache_clear (cache);
+    assert (double_is_none (rowcache_get (cache, 5, 3)));
+
+    rowcache_free (&cache);
+    assert (cache == NULL);
+    print_info ("OK\n");
+}
@@ -0,0 +1,45 @@
+/*  =========================================================================
+    rowcache - bounded cache of matrix rows, filled on demand
+
+    Direct-mapped cache of a fixed number of rows: row i lives in slot
+    i % num_rows, and a row is evicted when another one takes its slot.
+    Cells of a cached row are filled one by one as they are computed.
+
+    Each thread gets its own set of slots, so no locking is needed on
+    access. Memory: num_rows * row size * sizeof (double) per thread.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __ROWCACHE_H_INCLUDED__
+#define __ROWCACHE_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor
+rowcache_t *rowcache_new (size_t num_rows);
+
+// Destructor. Slots of all threads are freed.
+void rowcache_free (rowcache_t **self_p);
+
+// Get cached value of cell (i, j), or DOUBLE_NONE if it is not cached
+double rowcache_get (rowcache_t *self, size_t i, size_t j);
+
+// Cache value of cell (i, j). Row i evicts the row in its slot.
+void rowcache_set (rowcache_t *self, size_t i, size_t j, double value);
+
+// Drop all cached rows of all threads.
+// Must not be called while other threads access the cache.
+void rowcache_clear (rowcache_t *self);
+
+// Self test
+void rowcache_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
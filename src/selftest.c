@@ -14,14 +14,23 @@ typedef struct {
 
 static test_item_t
 all_tests [] = {
+    { "arena", arena_test },
+    { "strindex", strindex_test },
+    { "spatialindex", spatialindex_test },
+    { "arcmatrix", arcmatrix_test },
+    { "rowcache", rowcache_test },
+    { "sparsearcs", sparsearcs_test },
+    { "tdarcs", tdarcs_test },
+    { "beeline", beeline_test },
+    { "roadnet", roadnet_test },
 // #ifdef WITH_DRAFTS
-    // { "route", route_test },
+    { "route", route_test },
     // { "solution", solution_test },
     // { "tspi", tspi_test },
     { "tsp", tsp_test },
-    // { "cvrp", cvrp_test },
-    // { "vrptw", vrptw_test },
-    // { "vrp", vrp_test },
+    { "cvrp", cvrp_test },
+    { "vrptw", vrptw_test },
+    { "vrp", vrp_test },
 // #endif // WITH_DRAFTS
     {0, 0}          //  Sentinel
 };
@@ -16,13 +16,23 @@ struct _solution_t {
     // Auxiliaries
     bool feasible;
     double total_distance;
+
+    arena_t *arena; // arena which solution is allocated from, NULL for heap
 };
 
 
 // Create a new solution object
 solution_t *solution_new () {
-    solution_t *self = (solution_t *) malloc (sizeof (solution_t));
+    return solution_new_in_arena (NULL);
+}
+
+
+solution_t *solution_new_in_arena (arena_t *arena) {
+    solution_t *self = (arena != NULL) ?
+                       (solution_t *) arena_alloc (arena, sizeof (solution_t)) :
+                       (solution_t *) malloc (sizeof (solution_t));
     assert (self);
+    self->arena = arena;
 
     // self->vrp = vrp;
 
@@ -31,6 +41,7 @@ solution_t *solution_new () {
     listx_set_destructor (self->routes, (destructor_t) route_free);
 
     self->vehicles = NULL;
+    self->feasible = false;
     self->total_distance = DOUBLE_NONE;
     return self;
 }
@@ -43,7 +54,10 @@ void solution_free (solution_t **self_p) {
         solution_t *self = *self_p;
         listx_free (&self->routes);
         listu_free (&self->vehicles);
-        free (self);
+        if (self->arena != NULL)
+            arena_release (self);
+        else
+            free (self);
         *self_p = NULL;
     }
 }
@@ -68,7 +82,9 @@ void solution_prepend_route_from_array (solution_t *self,
                                         size_t num_nodes) {
     assert (self);
     assert (node_ids);
-    listx_prepend (self->routes, route_new_from_array (node_ids, num_nodes));
+    listx_prepend (self->routes,
+                   route_new_from_array_in_arena (self->arena,
+                                                  node_ids, num_nodes));
 }
 
 
@@ -77,7 +93,9 @@ void solution_append_route_from_array (solution_t *self,
                                        size_t num_nodes) {
     assert (self);
     assert (node_ids);
-    listx_append (self->routes, route_new_from_array (node_ids, num_nodes));
+    listx_append (self->routes,
+                  route_new_from_array_in_arena (self->arena,
+                                                 node_ids, num_nodes));
 }
 
 
@@ -151,9 +169,12 @@ solution_t *solution_dup (const solution_t *self) {
     assert (self);
     // solution_t *copy = solution_new (self->vrp);
     solution_t *copy = solution_new ();
-    for (size_t idx = 0; idx < solution_num_routes (self); idx++)
+    for (size_t idx = 0; idx < solution_num_routes (self); idx++) {
+        const route_t *route = listx_item_at (self->routes, idx);
         solution_append_route (copy,
-                               route_dup (listx_item_at (self->routes, idx)));
+                               route_new_from_array (route_node_array (route),
+                                                     route_size (route)));
+    }
 
     copy->vehicles = listu_dup (self->vehicles);
     copy->feasible = self->feasible;
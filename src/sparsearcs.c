@@ -0,0 +1,259 @@
+/*  =========================================================================
+    sparsearcs - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+
+
+typedef struct {
+    size_t target;
+    double distance; // DOUBLE_NONE if not set
+    size_t duration; // SIZE_NONE if not set
+} s_arc_t;
+
+
+// Arcs from one node, sorted by target
+typedef struct {
+    s_arc_t *arcs;
+    size_t size;
+    size_t alloc_size;
+} s_row_t;
+
+
+struct _sparsearcs_t {
+    s_row_t *rows;
+    size_t num_rows;
+    size_t num_arcs;
+};
+
+
+sparsearcs_t *sparsearcs_new (void) {
+    sparsearcs_t *self = (sparsearcs_t *) malloc (sizeof (sparsearcs_t));
+    assert (self);
+    self->rows = NULL;
+    self->num_rows = 0;
+    self->num_arcs = 0;
+    return self;
+}
+
+
+void sparsearcs_free (sparsearcs_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        sparsearcs_t *self = *self_p;
+        for (size_t i = 0; i < self->num_rows; i++)
+            free (self->rows[i].arcs);
+        free (self->rows);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+// Index of first arc in row with target >= j
+static size_t s_row_lower_bound (const s_row_t *row, size_t j) {
+    size_t low = 0, high = row->size;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (row->arcs[mid].target < j)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+
+// Find arc (i, j), or NULL
+static const s_arc_t *sparsearcs_find (const sparsearcs_t *self,
+                                       size_t i, size_t j) {
+    if (i >= self->num_rows)
+        return NULL;
+    const s_row_t *row = &self->rows[i];
+    size_t idx = s_row_lower_bound (row, j);
+    return (idx < row->size && row->arcs[idx].target == j) ?
+           &row->arcs[idx] : NULL;
+}
+
+
+// Get arc (i, j), added if it does not exist
+static s_arc_t *sparsearcs_arc (sparsearcs_t *self, size_t i, size_t j) {
+    if (i >= self->num_rows) {
+        size_t num_rows = max2 (i + 1, self->num_rows * 2);
+        self->rows =
+            (s_row_t *) realloc (self->rows, num_rows * sizeof (s_row_t));
+        assert (self->rows);
+        memset (self->rows + self->num_rows, 0,
+                (num_rows - self->num_rows) * sizeof (s_row_t));
+        self->num_rows = num_rows;
+    }
+
+    s_row_t *row = &self->rows[i];
+    size_t idx = s_row_lower_bound (row, j);
+    if (idx < row->size && row->arcs[idx].target == j)
+        return &row->arcs[idx];
+
+    if (row->size == row->alloc_size) {
+        row->alloc_size = max2 (4, row->alloc_size * 2);
+        row->arcs = (s_arc_t *) realloc (row->arcs,
+                                         row->alloc_size * sizeof (s_arc_t));
+        assert (row->arcs);
+    }
+    memmove (row->arcs + idx + 1, row->arcs + idx,
+             (row->size - idx) * sizeof (s_arc_t));
+    row->size++;
+    self->num_arcs++;
+
+    s_arc_t *arc = &row->arcs[idx];
+    arc->target = j;
+    arc->distance = DOUBLE_NONE;
+    arc->duration = SIZE_NONE;
+    return arc;
+}
+
+
+void sparsearcs_set_distance (sparsearcs_t *self,
+                              size_t i, size_t j, double distance) {
+    assert (self);
+    sparsearcs_arc (self, i, j)->distance = distance;
+}
+
+
+void sparsearcs_set_duration (sparsearcs_t *self,
+                              size_t i, size_t j, size_t duration) {
+    assert (self);
+    sparsearcs_arc (self, i, j)->duration = duration;
+}
+
+
+double sparsearcs_distance (const sparsearcs_t *self, size_t i, size_t j) {
+    assert (self);
+    const s_arc_t *arc = sparsearcs_find (self, i, j);
+    return (arc != NULL) ? arc->distance : DOUBLE_NONE;
+}
+
+
+size_t sparsearcs_duration (const sparsearcs_t *self, size_t i, size_t j) {
+    assert (self);
+    const s_arc_t *arc = sparsearcs_find (self, i, j);
+    return (arc != NULL) ? arc->duration : SIZE_NONE;
+}
+
+
+static int s_arc_compare (const void *a, const void *b) {
+    size_t ta = ((const s_arc_t *) a)->target;
+    size_t tb = ((const s_arc_t *) b)->target;
+    return (ta < tb) ? -1 : (ta > tb);
+}
+
+
+void sparsearcs_remap (sparsearcs_t *self,
+                       const size_t *id_map,
+                       size_t map_size) {
+    assert (self);
+    assert (id_map || map_size == 0);
+
+    size_t num_rows = 0;
+    for (size_t i = 0; i < min2 (self->num_rows, map_size); i++) {
+        if (id_map[i] != ID_NONE)
+            num_rows = max2 (num_rows, id_map[i] + 1);
+    }
+    s_row_t *rows = (s_row_t *) calloc (max2 (num_rows, 1), sizeof (s_row_t));
+    assert (rows);
+
+    self->num_arcs = 0;
+    for (size_t i = 0; i < self->num_rows; i++) {
+        s_row_t *row = &self->rows[i];
+        if (i >= map_size || id_map[i] == ID_NONE) {
+            free (row->arcs);
+            continue;
+        }
+
+        // Arcs are kept in place, then sorted by new targets
+        size_t size = 0;
+        for (size_t idx = 0; idx < row->size; idx++) {
+            size_t target = row->arcs[idx].target;
+            if (target >= map_size || id_map[target] == ID_NONE)
+                continue;
+            row->arcs[size] = row->arcs[idx];
+            row->arcs[size++].target = id_map[target];
+        }
+        row->size = size;
+        if (size > 1)
+            qsort (row->arcs, size, sizeof (s_arc_t), s_arc_compare);
+        self->num_arcs += size;
+        rows[id_map[i]] = *row;
+    }
+
+    free (self->rows);
+    self->rows = rows;
+    self->num_rows = num_rows;
+}
+
+
+size_t sparsearcs_num_arcs (const sparsearcs_t *self) {
+    assert (self);
+    return self->num_arcs;
+}
+
+
+size_t sparsearcs_memory_size (const sparsearcs_t *self) {
+    assert (self);
+    size_t size = self->num_rows * sizeof (s_row_t);
+    for (size_t i = 0; i < self->num_rows; i++)
+        size += self->rows[i].alloc_size * sizeof (s_arc_t);
+    return size;
+}
+
+
+void sparsearcs_test (bool verbose) {
+    print_info (" * sparsearcs: \n");
+
+    sparsearcs_t *arcs = sparsearcs_new ();
+    assert (double_is_none (sparsearcs_distance (arcs, 3, 4)));
+    assert (sparsearcs_duration (arcs, 3, 4) == SIZE_NONE);
+
+    // Targets set in reverse order are kept sorted
+    for (size_t j = 100; j > 0; j--)
+        sparsearcs_set_distance (arcs, 5, j * 3, (double) j);
+    sparsearcs_set_duration (arcs, 5, 30, 7);
+    sparsearcs_set_duration (arcs, 5, 31, 8);
+    assert (sparsearcs_num_arcs (arcs) == 101);
+
+    for (size_t j = 1; j <= 100; j++)
+        assert (sparsearcs_distance (arcs, 5, j * 3) == (double) j);
+    assert (double_is_none (sparsearcs_distance (arcs, 5, 31)));
+    assert (sparsearcs_duration (arcs, 5, 30) == 7);
+    assert (sparsearcs_duration (arcs, 5, 31) == 8);
+    assert (sparsearcs_duration (arcs, 5, 33) == SIZE_NONE);
+    assert (double_is_none (sparsearcs_distance (arcs, 30, 5)));
+    assert (sparsearcs_memory_size (arcs) > 0);
+
+    // Remap: drop node 6 (target 6) and node 30, swap nodes 5 and 3
+    size_t id_map[301];
+    for (size_t i = 0; i < 301; i++)
+        id_map[i] = i;
+    id_map[5] = 3;
+    id_map[3] = 5;
+    id_map[6] = ID_NONE;
+    id_map[30] = ID_NONE;
+    sparsearcs_set_distance (arcs, 30, 5, 1);
+    sparsearcs_remap (arcs, id_map, 301);
+    assert (sparsearcs_num_arcs (arcs) == 99);
+    assert (sparsearcs_distance (arcs, 3, 9) == 3);
+    assert (sparsearcs_distance (arcs, 3, 5) == 1);
+    assert (double_is_none (sparsearcs_distance (arcs, 5, 9)));
+    assert (double_is_none (sparsearcs_distance (arcs, 3, 6)));
+    assert (sparsearcs_duration (arcs, 3, 31) == 8);
+    for (size_t j = 4; j <= 100; j++) {
+        if (j != 10)
+            assert (sparsearcs_distance (arcs, 3, j * 3) == (double) j);
+    }
+
+    sparsearcs_free (&arcs);
+    assert (arcs == NULL);
+    print_info ("OK\n");
+}
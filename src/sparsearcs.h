@@ -0,0 +1,59 @@
+/*  =========================================================================
+    sparsearcs - sparse storage of arc distances and durations
+
+    Only arcs set explicitly are stored, e.g. arcs to the k nearest
+    neighbours of each node plus rows of depots. Each row keeps its arcs
+    sorted by target, so an arc is found by binary search.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __SPARSEARCS_H_INCLUDED__
+#define __SPARSEARCS_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor
+sparsearcs_t *sparsearcs_new (void);
+
+// Destructor
+void sparsearcs_free (sparsearcs_t **self_p);
+
+// Set distance of arc (i, j)
+void sparsearcs_set_distance (sparsearcs_t *self,
+                              size_t i, size_t j, double distance);
+
+// Set duration of arc (i, j)
+void sparsearcs_set_duration (sparsearcs_t *self,
+                              size_t i, size_t j, size_t duration);
+
+// Get distance of arc (i, j), or DOUBLE_NONE if it is not stored
+double sparsearcs_distance (const sparsearcs_t *self, size_t i, size_t j);
+
+// Get duration of arc (i, j), or SIZE_NONE if it is not stored
+size_t sparsearcs_duration (const sparsearcs_t *self, size_t i, size_t j);
+
+// Renumber rows and targets: node i becomes id_map[i], and its arcs are
+// dropped if id_map[i] is ID_NONE. id_map holds map_size entries; arcs
+// beyond it are dropped.
+void sparsearcs_remap (sparsearcs_t *self,
+                       const size_t *id_map,
+                       size_t map_size);
+
+// Number of stored arcs
+size_t sparsearcs_num_arcs (const sparsearcs_t *self);
+
+// Number of bytes of storage
+size_t sparsearcs_memory_size (const sparsearcs_t *self);
+
+// Self test
+void sparsearcs_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
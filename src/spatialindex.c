@@ -0,0 +1,607 @@
+/*  =========================================================================
+    spatialindex - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+
+
+#define SPATIALINDEX_MIN_CAPACITY 16 // slots of cell table
+#define SPATIALINDEX_POINTS_PER_CELL 2.0 // density grid is sized for
+#define SPATIALINDEX_MIN_SIZING 16 // number of points grid is first sized at
+#define SPATIALINDEX_MAX_CELL ((int64_t) 1 << 40) // bound of cell indices
+
+
+typedef struct {
+    int64_t x;
+    int64_t y;
+    size_t head; // first point in cell, or ID_NONE
+    bool used; // slot holds a cell (which may have become empty)
+} s_cell_t;
+
+
+struct _spatialindex_t {
+    coord2d_sys_t coord_sys; // system distances are computed in
+    double cell_size; // side of cell in units of coordinates, or 0 if all
+                      // points are in one cell
+    size_t size; // number of points
+    size_t size_at_sizing; // number of points when grid was sized
+
+    // Points by ID
+    coord2d_t *coords; // none if ID is not in index
+    size_t *next; // next point in the same cell, or ID_NONE
+    size_t ids_size; // number of IDs arrays could hold
+
+    // Bounding boxes of points and of occupied cells, which only grow
+    // until grid is sized again
+    double min_v1, max_v1, min_v2, max_v2;
+    int64_t min_x, max_x, min_y, max_y;
+
+    // Occupied cells: open addressing table, linear probing
+    s_cell_t *cells;
+    size_t capacity; // number of slots, power of 2
+    size_t num_cells;
+};
+
+
+// Query state shared by cells visited
+typedef struct {
+    const coord2d_t *coord;
+    size_t k; // nearest: max number of points
+    size_t *ids; // nearest: max-heap of points found, by distance
+    double *distances;
+    size_t num_found;
+    double radius; // within: max distance
+    listu_t *within; // within: points found, or NULL for nearest query
+} s_query_t;
+
+
+static uint64_t s_cell_hash (int64_t x, int64_t y) {
+    uint64_t h = ((uint64_t) x * 0x9e3779b97f4a7c15ULL) ^
+                 ((uint64_t) y * 0xc2b2ae3d27d4eb4fULL);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+// Cell index of coordinate value
+static int64_t spatialindex_cell_index (const spatialindex_t *self,
+                                        double value) {
+    if (self->cell_size == 0)
+        return 0;
+    double index = floor (value / self->cell_size);
+    if (index > SPATIALINDEX_MAX_CELL)
+        return SPATIALINDEX_MAX_CELL;
+    if (index < -SPATIALINDEX_MAX_CELL)
+        return -SPATIALINDEX_MAX_CELL;
+    return (int64_t) index;
+}
+
+
+// Slot of cell (x, y), or empty slot where it would be
+static size_t spatialindex_find_cell (const spatialindex_t *self,
+                                      int64_t x, int64_t y) {
+    size_t mask = self->capacity - 1;
+    size_t idx = (size_t) s_cell_hash (x, y) & mask;
+    while (self->cells[idx].used &&
+           (self->cells[idx].x != x || self->cells[idx].y != y))
+        idx = (idx + 1) & mask;
+    return idx;
+}
+
+
+// Allocate empty cell table
+static void spatialindex_reset_cells (spatialindex_t *self, size_t capacity) {
+    free (self->cells);
+    self->cells = (s_cell_t *) malloc (capacity * sizeof (s_cell_t));
+    assert (self->cells);
+    for (size_t idx = 0; idx < capacity; idx++)
+        self->cells[idx].used = false;
+    self->capacity = capacity;
+    self->num_cells = 0;
+    self->min_x = self->min_y = INT64_MAX;
+    self->max_x = self->max_y = INT64_MIN;
+}
+
+
+// Add point to its cell
+static void spatialindex_link (spatialindex_t *self, size_t id) {
+    int64_t x = spatialindex_cell_index (self, self->coords[id].v1);
+    int64_t y = spatialindex_cell_index (self, self->coords[id].v2);
+    size_t idx = spatialindex_find_cell (self, x, y);
+
+    if (!self->cells[idx].used) {
+        // Keep load factor at most 1/2; cells left empty are dropped
+        if (2 * (self->num_cells + 1) > self->capacity) {
+            s_cell_t *old_cells = self->cells;
+            size_t old_capacity = self->capacity;
+            self->cells = NULL;
+            spatialindex_reset_cells (self, old_capacity * 2);
+            for (size_t k = 0; k < old_capacity; k++) {
+                if (!old_cells[k].used || old_cells[k].head == ID_NONE)
+                    continue;
+                size_t slot = spatialindex_find_cell (self, old_cells[k].x,
+                                                      old_cells[k].y);
+                self->cells[slot] = old_cells[k];
+                self->num_cells++;
+                self->min_x = min2 (self->min_x, old_cells[k].x);
+                self->max_x = max2 (self->max_x, old_cells[k].x);
+                self->min_y = min2 (self->min_y, old_cells[k].y);
+                self->max_y = max2 (self->max_y, old_cells[k].y);
+            }
+            free (old_cells);
+            idx = spatialindex_find_cell (self, x, y);
+        }
+        self->cells[idx].used = true;
+        self->cells[idx].x = x;
+        self->cells[idx].y = y;
+        self->cells[idx].head = ID_NONE;
+        self->num_cells++;
+    }
+
+    self->next[id] = self->cells[idx].head;
+    self->cells[idx].head = id;
+    self->min_x = min2 (self->min_x, x);
+    self->max_x = max2 (self->max_x, x);
+    self->min_y = min2 (self->min_y, y);
+    self->max_y = max2 (self->max_y, y);
+}
+
+
+// Size cells by density of points, and put points in cells again
+static void spatialindex_size_grid (spatialindex_t *self) {
+    double width = self->max_v1 - self->min_v1;
+    double height = self->max_v2 - self->min_v2;
+    double area_per_point =
+        SPATIALINDEX_POINTS_PER_CELL / (double) self->size;
+    self->cell_size = (width > 0 && height > 0) ?
+                      sqrt (width * height * area_per_point) :
+                      max2 (width, height) * area_per_point;
+
+    spatialindex_reset_cells (self, self->capacity);
+    for (size_t id = 0; id < self->ids_size; id++) {
+        if (!coord2d_is_none (&self->coords[id]))
+            spatialindex_link (self, id);
+    }
+    self->size_at_sizing = self->size;
+}
+
+
+// Lower bound of distance from query point to points which differ from it
+// by more than delta in one coordinate. max_lat is max absolute latitude of
+// query point and indexed points.
+static double spatialindex_bound (const spatialindex_t *self,
+                                  double delta, double max_lat) {
+    if (self->coord_sys == CS_CARTESIAN2D)
+        return delta;
+
+    // Meridian arc for latitude. For longitude, points are closest at
+    // highest latitude, as haversine a >= cos^2 (lat) * sin^2 (dlng / 2).
+    double by_lat = COORD2D_EARTH_RADIUS * min2 (delta, 180) * PI / 180;
+    double dlng = min2 (delta * PI / 180, PI);
+    double by_lng =
+        2 * COORD2D_EARTH_RADIUS *
+        asin (min2 (1.0, cos (max_lat * PI / 180) * sin (dlng / 2)));
+    return min2 (by_lat, by_lng);
+}
+
+
+// Max absolute latitude of query point and indexed points
+static double spatialindex_max_lat (const spatialindex_t *self,
+                                    const coord2d_t *coord) {
+    double max_lat = max2 (fabs (self->min_v1), fabs (self->max_v1));
+    return min2 (max2 (max_lat, fabs (coord->v1)), 90.0);
+}
+
+
+static void s_heap_swap (s_query_t *query, size_t i, size_t j) {
+    size_t id = query->ids[i];
+    query->ids[i] = query->ids[j];
+    query->ids[j] = id;
+    double distance = query->distances[i];
+    query->distances[i] = query->distances[j];
+    query->distances[j] = distance;
+}
+
+
+// Restore max-heap of first size points below idx
+static void s_heap_sift_down (s_query_t *query, size_t idx, size_t size) {
+    while (true) {
+        size_t largest = idx;
+        size_t left = 2 * idx + 1, right = 2 * idx + 2;
+        if (left < size &&
+            query->distances[left] > query->distances[largest])
+            largest = left;
+        if (right < size &&
+            query->distances[right] > query->distances[largest])
+            largest = right;
+        if (largest == idx)
+            return;
+        s_heap_swap (query, idx, largest);
+        idx = largest;
+    }
+}
+
+
+// Check points of cell (x, y) against query
+static void spatialindex_visit_cell (const spatialindex_t *self,
+                                     int64_t x, int64_t y,
+                                     s_query_t *query) {
+    const s_cell_t *cell = &self->cells[spatialindex_find_cell (self, x, y)];
+    if (!cell->used)
+        return;
+
+    for (size_t id = cell->head; id != ID_NONE; id = self->next[id]) {
+        double distance = coord2d_distance (query->coord, &self->coords[id],
+                                            self->coord_sys);
+        if (query->within != NULL) {
+            if (distance <= query->radius)
+                listu_append (query->within, id);
+        }
+        else if (query->num_found < query->k) {
+            // Push and sift up
+            size_t idx = query->num_found++;
+            query->ids[idx] = id;
+            query->distances[idx] = distance;
+            while (idx > 0 &&
+                   query->distances[(idx - 1) / 2] < query->distances[idx]) {
+                s_heap_swap (query, idx, (idx - 1) / 2);
+                idx = (idx - 1) / 2;
+            }
+        }
+        else if (distance < query->distances[0]) {
+            query->ids[0] = id;
+            query->distances[0] = distance;
+            s_heap_sift_down (query, 0, query->num_found);
+        }
+    }
+}
+
+
+// Check cells at Chebyshev distance r from cell (cx, cy), among occupied
+// cells
+static void spatialindex_visit_ring (const spatialindex_t *self,
+                                     int64_t cx, int64_t cy, int64_t r,
+                                     s_query_t *query) {
+    int64_t x_from = max2 (cx - r, self->min_x);
+    int64_t x_to = min2 (cx + r, self->max_x);
+    for (int64_t x = x_from; x <= x_to; x++) {
+        if (cy - r >= self->min_y && cy - r <= self->max_y)
+            spatialindex_visit_cell (self, x, cy - r, query);
+        if (r > 0 && cy + r >= self->min_y && cy + r <= self->max_y)
+            spatialindex_visit_cell (self, x, cy + r, query);
+    }
+
+    int64_t y_from = max2 (cy - r + 1, self->min_y);
+    int64_t y_to = min2 (cy + r - 1, self->max_y);
+    for (int64_t y = y_from; y <= y_to; y++) {
+        if (cx - r >= self->min_x && cx - r <= self->max_x)
+            spatialindex_visit_cell (self, cx - r, y, query);
+        if (r > 0 && cx + r >= self->min_x && cx + r <= self->max_x)
+            spatialindex_visit_cell (self, cx + r, y, query);
+    }
+}
+
+
+spatialindex_t *spatialindex_new (coord2d_sys_t coord_sys) {
+    assert (coord_sys == CS_CARTESIAN2D ||
+            coord_sys == CS_WGS84 ||
+            coord_sys == CS_GCJ02);
+
+    spatialindex_t *self = (spatialindex_t *) malloc (sizeof (spatialindex_t));
+    assert (self);
+
+    // GCJ-02 is close enough to WGS84 for distances
+    self->coord_sys = (coord_sys == CS_CARTESIAN2D) ? CS_CARTESIAN2D : CS_WGS84;
+    self->coords = NULL;
+    self->next = NULL;
+    self->ids_size = 0;
+    self->cells = NULL;
+    self->capacity = SPATIALINDEX_MIN_CAPACITY;
+    spatialindex_clear (self);
+    return self;
+}
+
+
+void spatialindex_free (spatialindex_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        spatialindex_t *self = *self_p;
+        free (self->coords);
+        free (self->next);
+        free (self->cells);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+size_t spatialindex_size (const spatialindex_t *self) {
+    assert (self);
+    return self->size;
+}
+
+
+void spatialindex_insert (spatialindex_t *self,
+                          size_t id, const coord2d_t *coord) {
+    assert (self);
+    assert (coord);
+    assert (!coord2d_is_none (coord));
+
+    if (id >= self->ids_size) {
+        size_t size = max2 (id + 1, self->ids_size * 2);
+        self->coords =
+            (coord2d_t *) realloc (self->coords, size * sizeof (coord2d_t));
+        self->next = (size_t *) realloc (self->next, size * sizeof (size_t));
+        assert (self->coords && self->next);
+        for (size_t idx = self->ids_size; idx < size; idx++)
+            coord2d_set_none (&self->coords[idx]);
+        self->ids_size = size;
+    }
+    assert (coord2d_is_none (&self->coords[id]));
+
+    self->coords[id] = *coord;
+    self->size++;
+    self->min_v1 = min2 (self->min_v1, coord->v1);
+    self->max_v1 = max2 (self->max_v1, coord->v1);
+    self->min_v2 = min2 (self->min_v2, coord->v2);
+    self->max_v2 = max2 (self->max_v2, coord->v2);
+
+    // Grid is sized again each time number of points doubles
+    if (self->size >= SPATIALINDEX_MIN_SIZING &&
+        self->size >= 2 * self->size_at_sizing)
+        spatialindex_size_grid (self);
+    else
+        spatialindex_link (self, id);
+}
+
+
+int spatialindex_remove (spatialindex_t *self, size_t id) {
+    assert (self);
+    if (id >= self->ids_size || coord2d_is_none (&self->coords[id]))
+        return -1;
+
+    int64_t x = spatialindex_cell_index (self, self->coords[id].v1);
+    int64_t y = spatialindex_cell_index (self, self->coords[id].v2);
+    s_cell_t *cell = &self->cells[spatialindex_find_cell (self, x, y)];
+    assert (cell->used);
+    size_t *link = &cell->head;
+    while (*link != id) {
+        assert (*link != ID_NONE);
+        link = &self->next[*link];
+    }
+    *link = self->next[id];
+
+    coord2d_set_none (&self->coords[id]);
+    self->size--;
+    return 0;
+}
+
+
+size_t spatialindex_nearest (const spatialindex_t *self,
+                             const coord2d_t *coord,
+                             size_t k,
+                             size_t *ids,
+                             double *distances) {
+    assert (self);
+    assert (coord);
+    assert (!coord2d_is_none (coord));
+    assert (ids);
+    if (k == 0 || self->size == 0)
+        return 0;
+
+    s_query_t query;
+    query.coord = coord;
+    query.k = k;
+    query.ids = ids;
+    query.distances =
+        (distances != NULL) ? distances : (double *) malloc (k * sizeof (double));
+    assert (query.distances);
+    query.num_found = 0;
+    query.within = NULL;
+
+    // Rings of cells outward, until no point outside could be nearer than
+    // the k-th found: outside ring r, points differ by more than r cells.
+    double max_lat = spatialindex_max_lat (self, coord);
+    int64_t cx = spatialindex_cell_index (self, coord->v1);
+    int64_t cy = spatialindex_cell_index (self, coord->v2);
+    for (int64_t r = 0; ; r++) {
+        spatialindex_visit_ring (self, cx, cy, r, &query);
+        if (cx - r <= self->min_x && cx + r >= self->max_x &&
+            cy - r <= self->min_y && cy + r >= self->max_y)
+            break;
+        if (query.num_found == k &&
+            spatialindex_bound (self, (double) r * self->cell_size, max_lat) >=
+            query.distances[0])
+            break;
+    }
+
+    // Heap sort: nearest first
+    for (size_t size = query.num_found; size > 1; size--) {
+        s_heap_swap (&query, 0, size - 1);
+        s_heap_sift_down (&query, 0, size - 1);
+    }
+
+    if (distances == NULL)
+        free (query.distances);
+    return query.num_found;
+}
+
+
+size_t spatialindex_within (const spatialindex_t *self,
+                            const coord2d_t *coord,
+                            double radius,
+                            listu_t *ids) {
+    assert (self);
+    assert (coord);
+    assert (!coord2d_is_none (coord));
+    assert (ids);
+    assert (radius >= 0);
+    listu_purge (ids);
+    if (self->size == 0)
+        return 0;
+
+    // Extents of query in both coordinates, which bound cells to check
+    double delta_v1 = radius, delta_v2 = radius;
+    if (self->coord_sys == CS_WGS84) {
+        double angle = radius / (2 * COORD2D_EARTH_RADIUS);
+        double cos_lat = cos (spatialindex_max_lat (self, coord) * PI / 180);
+        delta_v1 = 2 * angle * 180 / PI;
+        delta_v2 = (angle < PI / 2 && sin (angle) < cos_lat) ?
+                   2 * asin (sin (angle) / cos_lat) * 180 / PI :
+                   360;
+    }
+    int64_t x_from = max2 (spatialindex_cell_index (self, coord->v1 - delta_v1),
+                           self->min_x);
+    int64_t x_to = min2 (spatialindex_cell_index (self, coord->v1 + delta_v1),
+                         self->max_x);
+    int64_t y_from = max2 (spatialindex_cell_index (self, coord->v2 - delta_v2),
+                           self->min_y);
+    int64_t y_to = min2 (spatialindex_cell_index (self, coord->v2 + delta_v2),
+                         self->max_y);
+    if (x_from > x_to || y_from > y_to)
+        return 0;
+
+    s_query_t query;
+    query.coord = coord;
+    query.radius = radius;
+    query.within = ids;
+
+    // Scan occupied cells rather than a range which holds more cells
+    if ((double) (x_to - x_from + 1) * (double) (y_to - y_from + 1) >
+        (double) self->capacity) {
+        for (size_t idx = 0; idx < self->capacity; idx++) {
+            const s_cell_t *cell = &self->cells[idx];
+            if (cell->used &&
+                cell->x >= x_from && cell->x <= x_to &&
+                cell->y >= y_from && cell->y <= y_to)
+                spatialindex_visit_cell (self, cell->x, cell->y, &query);
+        }
+    }
+    else {
+        for (int64_t x = x_from; x <= x_to; x++)
+            for (int64_t y = y_from; y <= y_to; y++)
+                spatialindex_visit_cell (self, x, y, &query);
+    }
+    return listu_size (ids);
+}
+
+
+void spatialindex_clear (spatialindex_t *self) {
+    assert (self);
+    for (size_t id = 0; id < self->ids_size; id++)
+        coord2d_set_none (&self->coords[id]);
+    self->size = 0;
+    self->size_at_sizing = 0;
+    self->cell_size = 0;
+    self->min_v1 = self->min_v2 = DOUBLE_MAX;
+    self->max_v1 = self->max_v2 = -DOUBLE_MAX;
+    spatialindex_reset_cells (self, SPATIALINDEX_MIN_CAPACITY);
+}
+
+
+static int s_double_compare (const double *a, const double *b) {
+    return (*a < *b) ? -1 : ((*a > *b) ? 1 : 0);
+}
+
+
+// Compare queries of index with brute force over points
+static void s_check_queries (spatialindex_t *index,
+                             const coord2d_t *points, size_t num_points,
+                             const bool *removed,
+                             coord2d_sys_t coord_sys, double radius,
+                             rng_t *rng) {
+    size_t k = 8;
+    size_t ids[8];
+    double distances[8];
+    double *all = (double *) malloc (num_points * sizeof (double));
+    assert (all);
+    listu_t *within = listu_new (0);
+
+    for (size_t cnt = 0; cnt < 30; cnt++) {
+        // Query points inside and around bounding box of points
+        coord2d_t q = points[rng_random_int (rng, 0, num_points)];
+        q.v1 += rng_random_double (rng, -2 * radius, 2 * radius) *
+                (coord_sys == CS_WGS84 ? 0.01 : 1);
+        q.v2 += rng_random_double (rng, -2 * radius, 2 * radius) *
+                (coord_sys == CS_WGS84 ? 0.01 : 1);
+
+        size_t num_all = 0, num_within = 0;
+        for (size_t id = 0; id < num_points; id++) {
+            if (removed[id])
+                continue;
+            double d = coord2d_distance (&q, &points[id], coord_sys);
+            all[num_all++] = d;
+            num_within += (d <= radius);
+        }
+        qsort (all, num_all, sizeof (double),
+               (comparator_t) s_double_compare);
+
+        size_t num_found = spatialindex_nearest (index, &q, k, ids, distances);
+        assert (num_found == min2 (k, num_all));
+        for (size_t idx = 0; idx < num_found; idx++) {
+            assert (fabs (distances[idx] - all[idx]) < 1e-9);
+            assert (!removed[ids[idx]]);
+        }
+
+        assert (spatialindex_within (index, &q, radius, within) == num_within);
+        for (size_t idx = 0; idx < listu_size (within); idx++)
+            assert (coord2d_distance (&q, &points[listu_get (within, idx)],
+                                      coord_sys) <= radius);
+    }
+    listu_free (&within);
+    free (all);
+}
+
+
+void spatialindex_test (bool verbose) {
+    print_info (" * spatialindex: \n");
+    rng_t *rng = rng_new ();
+    size_t num_points = 1000;
+    bool *removed = (bool *) malloc (num_points * sizeof (bool));
+    assert (removed);
+
+    // Cartesian points, and WGS84 points around a city
+    coord2d_sys_t systems[2] = {CS_CARTESIAN2D, CS_WGS84};
+    double radii[2] = {5, 3};
+    for (size_t s = 0; s < 2; s++) {
+        coord2d_t *points =
+            (systems[s] == CS_CARTESIAN2D) ?
+            coord2d_random_cartesian_range (0, 100, 0, 100, num_points, rng) :
+            coord2d_random_cartesian_range (31.0, 31.5, 121.2, 121.8,
+                                            num_points, rng);
+        spatialindex_t *index = spatialindex_new (systems[s]);
+        for (size_t id = 0; id < num_points; id++) {
+            spatialindex_insert (index, id, &points[id]);
+            removed[id] = false;
+        }
+        assert (spatialindex_size (index) == num_points);
+        s_check_queries (index, points, num_points, removed,
+                         systems[s], radii[s], rng);
+
+        // Removed points are not found
+        for (size_t id = 0; id < num_points; id += 3) {
+            assert (spatialindex_remove (index, id) == 0);
+            assert (spatialindex_remove (index, id) == -1);
+            removed[id] = true;
+        }
+        s_check_queries (index, points, num_points, removed,
+                         systems[s], radii[s], rng);
+
+        spatialindex_clear (index);
+        assert (spatialindex_size (index) == 0);
+        size_t id;
+        assert (spatialindex_nearest (index, &points[0], 1, &id, NULL) == 0);
+        spatialindex_free (&index);
+        assert (index == NULL);
+        free (points);
+    }
+
+    free (removed);
+    rng_free (&rng);
+    print_info ("OK\n");
+}
@@ -0,0 +1,70 @@
+/*  =========================================================================
+    spatialindex - grid index of points, e.g. node coordinates
+
+    Points are kept by ID in cells of a uniform grid, and occupied cells are
+    found in a hash table, so the grid needs no bounds and stays valid as
+    points are added anywhere. Cell size follows density of points: the grid
+    is rebuilt when the number of points doubles.
+
+    Queries search rings of cells around query point, and stop when no point
+    outside could be nearer, so results are exact. Coordinate systems
+    CS_CARTESIAN2D and CS_WGS84 (or CS_GCJ02) are supported. For geodetic
+    coordinates distance is haversine, and longitudes are not wrapped around
+    the antimeridian.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __SPATIALINDEX_H_INCLUDED__
+#define __SPATIALINDEX_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor
+spatialindex_t *spatialindex_new (coord2d_sys_t coord_sys);
+
+// Destructor
+void spatialindex_free (spatialindex_t **self_p);
+
+// Number of points
+size_t spatialindex_size (const spatialindex_t *self);
+
+// Insert point with ID. ID should not be in index.
+void spatialindex_insert (spatialindex_t *self,
+                          size_t id, const coord2d_t *coord);
+
+// Remove point of ID.
+// Return 0 if succeeded, -1 if ID is not in index.
+int spatialindex_remove (spatialindex_t *self, size_t id);
+
+// Get up to k points nearest to coord into ids, nearest first, and their
+// distances into distances if it is not NULL.
+// Return number of points found.
+size_t spatialindex_nearest (const spatialindex_t *self,
+                             const coord2d_t *coord,
+                             size_t k,
+                             size_t *ids,
+                             double *distances);
+
+// Get points within distance radius of coord into ids (cleared first), in
+// no particular order.
+// Return number of points found.
+size_t spatialindex_within (const spatialindex_t *self,
+                            const coord2d_t *coord,
+                            double radius,
+                            listu_t *ids);
+
+// Remove all points
+void spatialindex_clear (spatialindex_t *self);
+
+// Self test
+void spatialindex_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,305 @@
+/*  =========================================================================
+    strindex - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+
+
+#define STRINDEX_MIN_CAPACITY 16
+#define STRINDEX_BATCH_SIZE 32 // keys hashed and prefetched at once
+
+#if defined (__GNUC__)
+#define s_prefetch(addr) __builtin_prefetch (addr)
+#else
+#define s_prefetch(addr) ((void) (addr))
+#endif
+
+
+typedef struct {
+    uint64_t hash; // 0 if slot is empty
+    size_t key; // offset of key in pool
+    size_t value;
+} s_slot_t;
+
+
+struct _strindex_t {
+    s_slot_t *slots;
+    size_t capacity; // number of slots, power of 2
+    size_t size; // number of keys
+
+    char *pool; // interned keys, each terminated by '\0'
+    size_t pool_size; // bytes in use, including removed keys
+    size_t pool_alloc_size;
+    size_t pool_garbage; // bytes of removed keys
+};
+
+
+// FNV-1a with a final mix, so that low bits used for slots depend on all
+// characters. Never 0, which marks an empty slot.
+static uint64_t s_hash (const char *key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *) key; *c; c++)
+        h = (h ^ *c) * 1099511628211ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (h != 0) ? h : 1;
+}
+
+
+// Slot holding key, or empty slot where key would be inserted
+static size_t strindex_find (const strindex_t *self,
+                             const char *key, uint64_t hash) {
+    size_t mask = self->capacity - 1;
+    size_t idx = (size_t) hash & mask;
+    while (self->slots[idx].hash != 0 &&
+           (self->slots[idx].hash != hash ||
+            strcmp (self->pool + self->slots[idx].key, key) != 0))
+        idx = (idx + 1) & mask;
+    return idx;
+}
+
+
+// Copy key into pool. Return its offset.
+static size_t strindex_intern (strindex_t *self, const char *key) {
+    size_t len = strlen (key) + 1;
+    if (self->pool_size + len > self->pool_alloc_size) {
+        self->pool_alloc_size = max2 (self->pool_size + len,
+                                      self->pool_alloc_size * 2);
+        self->pool = (char *) realloc (self->pool, self->pool_alloc_size);
+        assert (self->pool);
+    }
+    size_t offset = self->pool_size;
+    memcpy (self->pool + offset, key, len);
+    self->pool_size += len;
+    return offset;
+}
+
+
+// Rebuild table with capacity, and drop removed keys from pool
+static void strindex_rebuild (strindex_t *self, size_t capacity) {
+    s_slot_t *old_slots = self->slots;
+    size_t old_capacity = self->capacity;
+    char *old_pool = self->pool;
+
+    self->slots = (s_slot_t *) malloc (capacity * sizeof (s_slot_t));
+    assert (self->slots);
+    for (size_t idx = 0; idx < capacity; idx++)
+        self->slots[idx].hash = 0;
+    self->capacity = capacity;
+
+    self->pool_alloc_size =
+        max2 (self->pool_size - self->pool_garbage, capacity * 8);
+    self->pool = (char *) malloc (self->pool_alloc_size);
+    assert (self->pool);
+    self->pool_size = 0;
+    self->pool_garbage = 0;
+
+    size_t mask = capacity - 1;
+    for (size_t k = 0; k < old_capacity; k++) {
+        const s_slot_t *old = &old_slots[k];
+        if (old->hash == 0)
+            continue;
+        size_t idx = (size_t) old->hash & mask;
+        while (self->slots[idx].hash != 0)
+            idx = (idx + 1) & mask;
+        self->slots[idx].hash = old->hash;
+        self->slots[idx].key = strindex_intern (self, old_pool + old->key);
+        self->slots[idx].value = old->value;
+    }
+    free (old_slots);
+    free (old_pool);
+}
+
+
+strindex_t *strindex_new (size_t alloc_size) {
+    strindex_t *self = (strindex_t *) malloc (sizeof (strindex_t));
+    assert (self);
+
+    size_t capacity = STRINDEX_MIN_CAPACITY;
+    while (capacity < alloc_size * 2)
+        capacity *= 2;
+    self->slots = (s_slot_t *) malloc (capacity * sizeof (s_slot_t));
+    assert (self->slots);
+    for (size_t idx = 0; idx < capacity; idx++)
+        self->slots[idx].hash = 0;
+    self->capacity = capacity;
+    self->size = 0;
+
+    self->pool_alloc_size = capacity * 8;
+    self->pool = (char *) malloc (self->pool_alloc_size);
+    assert (self->pool);
+    self->pool_size = 0;
+    self->pool_garbage = 0;
+    return self;
+}
+
+
+void strindex_free (strindex_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        strindex_t *self = *self_p;
+        free (self->slots);
+        free (self->pool);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+size_t strindex_size (const strindex_t *self) {
+    assert (self);
+    return self->size;
+}
+
+
+int strindex_insert (strindex_t *self, const char *key, size_t value) {
+    assert (self);
+    assert (key);
+    uint64_t hash = s_hash (key);
+    size_t idx = strindex_find (self, key, hash);
+    if (self->slots[idx].hash != 0)
+        return -1;
+
+    // Keep load factor at most 1/2
+    if (2 * (self->size + 1) > self->capacity) {
+        strindex_rebuild (self, self->capacity * 2);
+        idx = strindex_find (self, key, hash);
+    }
+
+    self->slots[idx].hash = hash;
+    self->slots[idx].key = strindex_intern (self, key);
+    self->slots[idx].value = value;
+    self->size++;
+    return 0;
+}
+
+
+size_t strindex_query (const strindex_t *self, const char *key) {
+    assert (self);
+    assert (key);
+    const s_slot_t *slot = &self->slots[strindex_find (self, key, s_hash (key))];
+    return (slot->hash != 0) ? slot->value : ID_NONE;
+}
+
+
+size_t strindex_query_batch (const strindex_t *self,
+                             const char **keys,
+                             size_t num_keys,
+                             size_t *values) {
+    assert (self);
+    assert (keys);
+    assert (values);
+
+    uint64_t hashes[STRINDEX_BATCH_SIZE];
+    size_t mask = self->capacity - 1;
+    size_t num_found = 0;
+
+    for (size_t start = 0; start < num_keys; start += STRINDEX_BATCH_SIZE) {
+        size_t end = min2 (start + STRINDEX_BATCH_SIZE, num_keys);
+        for (size_t k = start; k < end; k++) {
+            hashes[k - start] = s_hash (keys[k]);
+            s_prefetch (&self->slots[(size_t) hashes[k - start] & mask]);
+        }
+        for (size_t k = start; k < end; k++) {
+            const s_slot_t *slot =
+                &self->slots[strindex_find (self, keys[k], hashes[k - start])];
+            values[k] = (slot->hash != 0) ? slot->value : ID_NONE;
+            num_found += (slot->hash != 0);
+        }
+    }
+    return num_found;
+}
+
+
+int strindex_remove (strindex_t *self, const char *key) {
+    assert (self);
+    assert (key);
+    size_t hole = strindex_find (self, key, s_hash (key));
+    if (self->slots[hole].hash == 0)
+        return -1;
+    self->pool_garbage += strlen (self->pool + self->slots[hole].key) + 1;
+    self->size--;
+
+    // Shift back following entries which may not stay after the hole
+    size_t mask = self->capacity - 1;
+    size_t idx = hole;
+    while (true) {
+        idx = (idx + 1) & mask;
+        if (self->slots[idx].hash == 0)
+            break;
+        size_t home = (size_t) self->slots[idx].hash & mask;
+        // Entry stays if its home is cyclically in (hole, idx]
+        bool stays = (hole < idx) ? (hole < home && home <= idx) :
+                                    (hole < home || home <= idx);
+        if (!stays) {
+            self->slots[hole] = self->slots[idx];
+            hole = idx;
+        }
+    }
+    self->slots[hole].hash = 0;
+
+    // Drop removed keys from pool once they take half of it
+    if (self->pool_garbage > self->pool_size / 2)
+        strindex_rebuild (self, self->capacity);
+    return 0;
+}
+
+
+void strindex_clear (strindex_t *self) {
+    assert (self);
+    for (size_t idx = 0; idx < self->capacity; idx++)
+        self->slots[idx].hash = 0;
+    self->size = 0;
+    self->pool_size = 0;
+    self->pool_garbage = 0;
+}
+
+
+void strindex_test (bool verbose) {
+    print_info (" * strindex: \n");
+
+    strindex_t *index = strindex_new (0);
+    char key[32];
+    size_t num_keys = 1000;
+    for (size_t k = 0; k < num_keys; k++) {
+        sprintf (key, "key-%04zu", k);
+        assert (strindex_insert (index, key, k) == 0);
+    }
+    assert (strindex_size (index) == num_keys);
+    assert (strindex_insert (index, "key-0007", 0) == -1);
+    assert (strindex_query (index, "key-0007") == 7);
+    assert (strindex_query (index, "key-1000") == ID_NONE);
+    assert (strindex_query (index, "") == ID_NONE);
+
+    // Remove every third key; the others are still found after shifts
+    for (size_t k = 0; k < num_keys; k += 3) {
+        sprintf (key, "key-%04zu", k);
+        assert (strindex_remove (index, key) == 0);
+        assert (strindex_remove (index, key) == -1);
+    }
+    for (size_t k = 0; k < num_keys; k++) {
+        sprintf (key, "key-%04zu", k);
+        assert (strindex_query (index, key) == ((k % 3 == 0) ? ID_NONE : k));
+    }
+
+    // Batch query
+    const char *keys[4] = {"key-0001", "key-0003", "nothing", "key-0998"};
+    size_t values[4];
+    assert (strindex_query_batch (index, keys, 4, values) == 2);
+    assert (values[0] == 1 && values[1] == ID_NONE);
+    assert (values[2] == ID_NONE && values[3] == 998);
+
+    strindex_clear (index);
+    assert (strindex_size (index) == 0);
+    assert (strindex_query (index, "key-0001") == ID_NONE);
+    assert (strindex_insert (index, "key-0001", 5) == 0);
+    assert (strindex_query (index, "key-0001") == 5);
+
+    strindex_free (&index);
+    assert (index == NULL);
+    print_info ("OK\n");
+}
@@ -0,0 +1,60 @@
+/*  =========================================================================
+    strindex - index of interned strings, e.g. external IDs
+
+    Maps strings to values (IDs). Keys are copied (interned) into one pool,
+    and each slot of the open addressing table keeps the 64-bit hash of its
+    key, so a probe compares hashes and touches the pool only on a hash
+    match. Linear probing in a power-of-two table, load factor at most 1/2.
+    Removal shifts following entries back, so there are no tombstones.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __STRINDEX_H_INCLUDED__
+#define __STRINDEX_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor. alloc_size is the expected number of keys.
+strindex_t *strindex_new (size_t alloc_size);
+
+// Destructor
+void strindex_free (strindex_t **self_p);
+
+// Number of keys
+size_t strindex_size (const strindex_t *self);
+
+// Insert key with value.
+// Return 0 if succeeded, -1 if key already exists.
+int strindex_insert (strindex_t *self, const char *key, size_t value);
+
+// Get value of key, or ID_NONE if key does not exist
+size_t strindex_query (const strindex_t *self, const char *key);
+
+// Get values of keys[k] into values[k] (ID_NONE for missing keys).
+// Hashes of a block of keys are computed first and their slots prefetched,
+// so that probes of the block overlap their cache misses.
+// Return number of keys found.
+size_t strindex_query_batch (const strindex_t *self,
+                             const char **keys,
+                             size_t num_keys,
+                             size_t *values);
+
+// Remove key.
+// Return 0 if succeeded, -1 if key does not exist.
+int strindex_remove (strindex_t *self, const char *key);
+
+// Remove all keys
+void strindex_clear (strindex_t *self);
+
+// Self test
+void strindex_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
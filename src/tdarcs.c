@@ -0,0 +1,255 @@
+/*  =========================================================================
+    tdarcs - implementation
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#include "classes.h"
+
+
+#define TDARCS_NONE UINT32_MAX // first value of arc which is not set
+
+
+struct _tdarcs_t {
+    size_t num_slices;
+    size_t slice_duration;
+    size_t order; // number of rows in use
+    size_t capacity; // number of rows allocated (row stride in arcs)
+    uint32_t *data; // values of arc (i, j): [(i * capacity + j) * num_slices]
+};
+
+
+static uint32_t *tdarcs_values (const tdarcs_t *self, size_t i, size_t j) {
+    return self->data + (i * self->capacity + j) * self->num_slices;
+}
+
+
+tdarcs_t *tdarcs_new (size_t num_slices, size_t slice_duration, size_t order) {
+    assert (num_slices > 0);
+    assert (slice_duration > 0);
+
+    tdarcs_t *self = (tdarcs_t *) malloc (sizeof (tdarcs_t));
+    assert (self);
+    self->num_slices = num_slices;
+    self->slice_duration = slice_duration;
+    self->order = 0;
+    self->capacity = 0;
+    self->data = NULL;
+    tdarcs_reserve (self, order);
+    return self;
+}
+
+
+void tdarcs_free (tdarcs_t **self_p) {
+    assert (self_p);
+    if (*self_p) {
+        tdarcs_t *self = *self_p;
+        free (self->data);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+
+size_t tdarcs_num_slices (const tdarcs_t *self) {
+    assert (self);
+    return self->num_slices;
+}
+
+
+size_t tdarcs_slice_duration (const tdarcs_t *self) {
+    assert (self);
+    return self->slice_duration;
+}
+
+
+void tdarcs_reserve (tdarcs_t *self, size_t order) {
+    assert (self);
+    if (order <= self->order)
+        return;
+
+    if (order > self->capacity) {
+        // Row stride changes: copy rows into new storage
+        size_t new_capacity = max2 (order, self->capacity * 2);
+        size_t row_size = new_capacity * self->num_slices;
+        uint32_t *data =
+            (uint32_t *) malloc (new_capacity * row_size * sizeof (uint32_t));
+        assert (data);
+        for (size_t i = 0; i < new_capacity; i++) {
+            uint32_t *row = data + i * row_size;
+            size_t num_copied = 0;
+            if (i < self->order) {
+                num_copied = self->order * self->num_slices;
+                memcpy (row, tdarcs_values (self, i, 0),
+                        num_copied * sizeof (uint32_t));
+            }
+            for (size_t j = num_copied / self->num_slices; j < new_capacity; j++)
+                row[j * self->num_slices] = TDARCS_NONE;
+        }
+        free (self->data);
+        self->data = data;
+        self->capacity = new_capacity;
+    }
+    self->order = order;
+}
+
+
+void tdarcs_set (tdarcs_t *self, size_t i, size_t j, const size_t *durations) {
+    assert (self);
+    assert (durations);
+    tdarcs_reserve (self, max2 (i, j) + 1);
+
+    uint32_t *values = tdarcs_values (self, i, j);
+    for (size_t s = 0; s < self->num_slices; s++) {
+        assert (durations[s] < TDARCS_NONE);
+        values[s] = (uint32_t) durations[s];
+        // FIFO: duration drops by at most the time passed
+        if (s > 0 && values[s - 1] > values[s] + self->slice_duration)
+            values[s] = (uint32_t) (values[s - 1] - self->slice_duration);
+    }
+}
+
+
+bool tdarcs_is_set (const tdarcs_t *self, size_t i, size_t j) {
+    assert (self);
+    if (i >= self->order || j >= self->order)
+        return false;
+    return tdarcs_values (self, i, j)[0] != TDARCS_NONE;
+}
+
+
+size_t tdarcs_duration (const tdarcs_t *self,
+                        size_t i, size_t j, size_t departure_time) {
+    assert (self);
+    assert (i < self->order && j < self->order);
+    const uint32_t *values = tdarcs_values (self, i, j);
+    assert (values[0] != TDARCS_NONE);
+
+    size_t s = departure_time / self->slice_duration;
+    if (s >= self->num_slices - 1)
+        return values[self->num_slices - 1];
+
+    // Interpolation, rounded down. As t + d (t) is nondecreasing, so is its
+    // floor, and integer durations keep FIFO.
+    size_t elapsed = departure_time - s * self->slice_duration;
+    size_t d0 = values[s], d1 = values[s + 1];
+    return (d1 >= d0) ?
+           d0 + (d1 - d0) * elapsed / self->slice_duration :
+           d0 - ((d0 - d1) * elapsed + self->slice_duration - 1) /
+                self->slice_duration;
+}
+
+
+size_t tdarcs_latest_departure (const tdarcs_t *self,
+                                size_t i, size_t j, size_t arrival_time) {
+    assert (self);
+    size_t duration = tdarcs_duration (self, i, j, 0);
+    if (duration > arrival_time)
+        return arrival_time - duration;
+
+    // Arrival time is nondecreasing in departure time: binary search for the
+    // last departure arriving in time
+    size_t low = 0, high = arrival_time;
+    while (low < high) {
+        size_t mid = low + (high - low + 1) / 2;
+        if (mid + tdarcs_duration (self, i, j, mid) <= arrival_time)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+
+tdarcs_t *tdarcs_permute (const tdarcs_t *self,
+                          const size_t *old_rows,
+                          const size_t *new_rows,
+                          size_t num_rows,
+                          size_t order) {
+    assert (self);
+    tdarcs_t *permuted =
+        tdarcs_new (self->num_slices, self->slice_duration, order);
+    size_t arc_size = self->num_slices * sizeof (uint32_t);
+    for (size_t a = 0; a < num_rows; a++) {
+        assert (new_rows[a] < order);
+        for (size_t b = 0; b < num_rows; b++) {
+            // Values are copied as they are: FIFO is already kept
+            if (tdarcs_is_set (self, old_rows[a], old_rows[b]))
+                memcpy (tdarcs_values (permuted, new_rows[a], new_rows[b]),
+                        tdarcs_values (self, old_rows[a], old_rows[b]),
+                        arc_size);
+        }
+    }
+    return permuted;
+}
+
+
+size_t tdarcs_memory_size (const tdarcs_t *self) {
+    assert (self);
+    return self->capacity * self->capacity * self->num_slices *
+           sizeof (uint32_t);
+}
+
+
+void tdarcs_test (bool verbose) {
+    print_info (" * tdarcs: \n");
+
+    tdarcs_t *arcs = tdarcs_new (4, 10, 2);
+    assert (tdarcs_num_slices (arcs) == 4);
+    assert (tdarcs_slice_duration (arcs) == 10);
+    assert (!tdarcs_is_set (arcs, 0, 1));
+
+    // Rush hour in slice 1, set beyond order to grow
+    size_t durations[4] = {20, 40, 30, 25};
+    tdarcs_set (arcs, 0, 5, durations);
+    assert (tdarcs_is_set (arcs, 0, 5));
+    assert (!tdarcs_is_set (arcs, 5, 0));
+    assert (tdarcs_duration (arcs, 0, 5, 0) == 20);
+    assert (tdarcs_duration (arcs, 0, 5, 5) == 30);
+    assert (tdarcs_duration (arcs, 0, 5, 10) == 40);
+    assert (tdarcs_duration (arcs, 0, 5, 15) == 35);
+    assert (tdarcs_duration (arcs, 0, 5, 25) == 27);
+    assert (tdarcs_duration (arcs, 0, 5, 30) == 25);
+    assert (tdarcs_duration (arcs, 0, 5, 1000) == 25);
+
+    // FIFO holds at every departure time
+    for (size_t t = 0; t < 50; t++)
+        assert (t + tdarcs_duration (arcs, 0, 5, t) <=
+                t + 1 + tdarcs_duration (arcs, 0, 5, t + 1));
+
+    // Drop faster than time passes is raised
+    size_t steep[4] = {100, 10, 10, 10};
+    tdarcs_set (arcs, 3, 1, steep);
+    assert (tdarcs_duration (arcs, 3, 1, 10) == 90);
+    for (size_t t = 0; t < 50; t++)
+        assert (t + tdarcs_duration (arcs, 3, 1, t) <=
+                t + 1 + tdarcs_duration (arcs, 3, 1, t + 1));
+
+    // Latest departure is the last one arriving in time
+    for (size_t arrival = 20; arrival < 60; arrival++) {
+        size_t t = tdarcs_latest_departure (arcs, 0, 5, arrival);
+        assert (t + tdarcs_duration (arcs, 0, 5, t) <= arrival);
+        assert (t + 1 + tdarcs_duration (arcs, 0, 5, t + 1) > arrival);
+    }
+
+    // Growth keeps values
+    tdarcs_reserve (arcs, 100);
+    assert (tdarcs_duration (arcs, 0, 5, 10) == 40);
+    assert (!tdarcs_is_set (arcs, 99, 98));
+    assert (tdarcs_memory_size (arcs) > 0);
+
+    // Permutation keeps arcs among moved rows only
+    size_t old_rows[3] = {5, 0, 3};
+    size_t new_rows[3] = {0, 1, 2};
+    tdarcs_t *permuted = tdarcs_permute (arcs, old_rows, new_rows, 3, 3);
+    assert (tdarcs_duration (permuted, 1, 0, 15) == 35);
+    assert (!tdarcs_is_set (permuted, 2, 1)); // arc (3, 0) is not set
+    assert (!tdarcs_is_set (permuted, 0, 1));
+    assert (tdarcs_memory_size (permuted) < tdarcs_memory_size (arcs));
+    tdarcs_free (&permuted);
+
+    tdarcs_free (&arcs);
+    assert (arcs == NULL);
+    print_info ("OK\n");
+}
@@ -0,0 +1,74 @@
+/*  =========================================================================
+    tdarcs - time-dependent arc durations
+
+    Duration of each arc is given at the start of each of num_slices time
+    slices of equal length (e.g. 15 minutes), and interpolated linearly in
+    between; it stays at the last value after the last slice. The values of
+    an arc are contiguous, so a lookup at a departure time reads two
+    adjacent cells.
+
+    Durations respect FIFO: leaving later never arrives earlier. Values which
+    drop faster than time passes are raised when they are set.
+
+    Copyright (c) 2016, Yang LIU <gloolar@gmail.com>
+    =========================================================================
+*/
+
+#ifndef __TDARCS_H_INCLUDED__
+#define __TDARCS_H_INCLUDED__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constructor
+tdarcs_t *tdarcs_new (size_t num_slices, size_t slice_duration, size_t order);
+
+// Destructor
+void tdarcs_free (tdarcs_t **self_p);
+
+// Number of time slices
+size_t tdarcs_num_slices (const tdarcs_t *self);
+
+// Length of time slice
+size_t tdarcs_slice_duration (const tdarcs_t *self);
+
+// Grow to order (number of rows) at least
+void tdarcs_reserve (tdarcs_t *self, size_t order);
+
+// Set durations of arc (i, j) at start of each slice (num_slices values).
+// Storage grows if needed.
+void tdarcs_set (tdarcs_t *self, size_t i, size_t j, const size_t *durations);
+
+// Check if durations of arc (i, j) are set
+bool tdarcs_is_set (const tdarcs_t *self, size_t i, size_t j);
+
+// Duration of arc (i, j) departing at departure_time
+size_t tdarcs_duration (const tdarcs_t *self,
+                        size_t i, size_t j, size_t departure_time);
+
+// Latest departure time on arc (i, j) to arrive no later than arrival_time.
+// If even departing at time 0 arrives later, return arrival_time minus the
+// duration at time 0 (wrapped), like the time-independent case.
+size_t tdarcs_latest_departure (const tdarcs_t *self,
+                                size_t i, size_t j, size_t arrival_time);
+
+// Create copy with rows moved: arc (old_rows[a], old_rows[b]) becomes
+// (new_rows[a], new_rows[b]) for a, b < num_rows. Other arcs are dropped.
+tdarcs_t *tdarcs_permute (const tdarcs_t *self,
+                          const size_t *old_rows,
+                          const size_t *new_rows,
+                          size_t num_rows,
+                          size_t order);
+
+// Number of bytes of storage
+size_t tdarcs_memory_size (const tdarcs_t *self);
+
+// Self test
+void tdarcs_test (bool verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,9 +16,13 @@ struct _tsp_t {
     route_t *template; // route template
     size_t start_node; // first node is fixed if specified
     size_t end_node; // last node is fixed if specified
-    size_t unfixed_begin; // fist index of unfixed route slice
+    size_t unfixed_begin; // fist index of unfixed route slice, after start
+                          // node and fixed route prefix
     size_t unfixed_end; // last index of unfixed route slice
+    size_t *sweep_order; // nodes of unfixed slice in ascending polar angle,
+                         // or NULL until first sweep
     rng_t *rng;
+    arena_t *arena; // storage of template, genomes and temporaries
 };
 
 
@@ -33,8 +37,14 @@ static bool tsp_is_round_trip (tsp_t *self) {
 // Number of different nodes for optimize
 static size_t tsp_num_nodes (tsp_t *self) {
     return tsp_is_round_trip (self) ?
-           listu_size (self->template) - 1 :
-           listu_size (self->template);
+           route_size (self->template) - 1 :
+           route_size (self->template);
+}
+
+
+// Number of nodes of unfixed route slice
+static size_t tsp_num_free_nodes (tsp_t *self) {
+    return self->unfixed_end + 1 - self->unfixed_begin;
 }
 
 
@@ -63,36 +73,44 @@ static listx_t *tsp_sweep (tsp_t *self, size_t max_expected) {
     size_t route_len = route_size (self->template);
     size_t num_nodes_to_sort = self->unfixed_end - self->unfixed_begin + 1;
 
-    // Get polar coordinates of nodes to sort
-    coord2d_t *polars =
-        (coord2d_t *) malloc (sizeof (coord2d_t) * num_nodes_to_sort);
-    assert (polars);
-
-    const coord2d_t *ref = (self->start_node != ID_NONE) ?
-                           vrp_node_coord (self->vrp, self->start_node) :
-                           NULL;
-
-    size_t cnt = 0;
-    for (size_t idx = self->unfixed_begin; idx <= self->unfixed_end; idx++) {
-        size_t node_id = route_at (self->template, idx);
-        polars[cnt] = coord2d_to_polar (vrp_node_coord (self->vrp, node_id),
-                                        ref,
-                                        vrp_coord_sys (self->vrp));
-        polars[cnt].v1 = (double) node_id; // save ID in radius position
-        cnt++;
+    // Sort nodes in ascending order of angle on first call, and cache order
+    if (self->sweep_order == NULL) {
+        const coord2d_t **coords =
+            (const coord2d_t **) arena_alloc (self->arena,
+                                              sizeof (coord2d_t *) *
+                                              num_nodes_to_sort);
+        assert (coords);
+        const size_t *node_ids =
+            route_node_array (self->template) + self->unfixed_begin;
+        for (size_t cnt = 0; cnt < num_nodes_to_sort; cnt++)
+            coords[cnt] = vrp_node_coord (self->vrp, node_ids[cnt]);
+
+        // Angles are around the last fixed node
+        const coord2d_t *ref =
+            (self->unfixed_begin > 0) ?
+            vrp_node_coord (self->vrp,
+                            route_at (self->template,
+                                      self->unfixed_begin - 1)) :
+            NULL;
+        self->sweep_order =
+            (size_t *) arena_alloc (self->arena,
+                                    sizeof (size_t) * num_nodes_to_sort);
+        assert (self->sweep_order);
+        coord2d_sort_by_polar_angle (coords, num_nodes_to_sort, ref,
+                                     vrp_coord_sys (self->vrp),
+                                     self->sweep_order);
+        for (size_t cnt = 0; cnt < num_nodes_to_sort; cnt++)
+            self->sweep_order[cnt] = node_ids[self->sweep_order[cnt]];
+        arena_release (coords);
     }
 
-    // Sort nodes in ascending order of angle
-    qsort (polars, num_nodes_to_sort, sizeof (coord2d_t),
-           (comparator_t) coord2d_compare_polar_angle);
-
     // Make route
-    listu_t *route = route_new (route_len);
+    route_t *route = route_new_in_arena (self->arena, route_len);
     assert (route);
-    if (self->start_node != SIZE_NONE)
-        route_append_node (route, self->start_node);
+    for (size_t idx = 0; idx < self->unfixed_begin; idx++)
+        route_append_node (route, route_at (self->template, idx));
     for (size_t idx = 0; idx < num_nodes_to_sort; idx++)
-        route_append_node (route, (size_t) polars[idx].v1);
+        route_append_node (route, self->sweep_order[idx]);
     if (self->end_node != SIZE_NONE)
         route_append_node (route, self->end_node);
 
@@ -185,18 +203,18 @@ static solution_t *tsp_solve_small_model (tsp_t *self) {
     if (num_nodes == 0)
         return sol; // empty solution
 
-    // Case 2: one node
-    // Case 3: two nodes, and at least one node is fixed
-    if (num_nodes == 1 ||
-          (num_nodes == 2 &&
-          (self->start_node != ID_NONE || self->end_node != ID_NONE)) ) {
-        route_t *route = route_dup (self->template);
+    // Case 2: at most one node is not fixed (by start or end node, or fixed
+    // route prefix)
+    if (tsp_num_free_nodes (self) <= 1) {
+        route_t *route = route_new_from_array (route_node_array (self->template),
+                                               route_size (self->template));
         solution_append_route (sol, route);
         return sol;
     }
 
     // Other small cases: use local search to solve.
-    route_t *route = route_dup (self->template);
+    route_t *route = route_new_from_array (route_node_array (self->template),
+                                           route_size (self->template));
     double route_cost =
         route_total_distance (route,
                               self->vrp,
@@ -224,6 +242,7 @@ tsp_t *tsp_new_from_generic (vrp_t *vrp) {
     assert (self);
 
     self->vrp = vrp;
+    self->arena = vrp_new_arena (vrp);
 
     // Set start and end nodes
     assert (vrp_num_vehicles (vrp) == 1);
@@ -238,10 +257,17 @@ tsp_t *tsp_new_from_generic (vrp_t *vrp) {
     // model is one-way and open ended.
 
     // Do not estimate the size, start with a trivial number.
-    self->template = route_new (3);
+    self->template = route_new_in_arena (self->arena, 3);
 
     if (self->start_node != ID_NONE)
-        listu_append (self->template, self->start_node);
+        route_append_node (self->template, self->start_node);
+
+    // Executed route prefix is fixed (see vrp_fix_route_prefix ()). Its stops
+    // have no pending requests left.
+    const listu_t *prefix = vrp_vehicle_fixed_node_ids (vrp, vehicle_id);
+    for (size_t idx = 0; prefix != NULL && idx < listu_size (prefix); idx++)
+        route_append_node (self->template, listu_get (prefix, idx));
+    self->unfixed_begin = route_size (self->template);
 
     // Add nodes by scanning the pending requests (duplicate nodes removed)
     // For each request, add one of sender and receiver node.
@@ -253,18 +279,19 @@ tsp_t *tsp_new_from_generic (vrp_t *vrp) {
         if (node_id == ID_NONE)
             node_id = vrp_request_receiver (vrp, request_id);
         assert (node_id != ID_NONE);
-        if (!listu_includes (self->template, node_id))
-            listu_append (self->template, node_id);
+        if (node_id != self->end_node &&
+            route_find (self->template, node_id) == SIZE_NONE)
+            route_append_node (self->template, node_id);
     }
 
-    if (self->end_node != ID_NONE &&
-        !listu_includes (self->template, self->end_node))
-        listu_append (self->template, self->end_node);
+    // End node is the last one, also of round trip
+    if (self->end_node != ID_NONE)
+        route_append_node (self->template, self->end_node);
 
-    self->unfixed_begin = (self->start_node != ID_NONE) ? 1 : 0;
+    // Slice is empty (unfixed_end + 1 == unfixed_begin) if all nodes are fixed
     self->unfixed_end = route_size (self->template) -
                         ((self->end_node != ID_NONE) ? 2 : 1);
-    assert (self->unfixed_begin <= self->unfixed_end);
+    assert (tsp_num_free_nodes (self) <= route_size (self->template));
 
     print_info ("tsp derived from generic VRP model.\n");
     print_info ("route template: #nodes: %zu, %s trip, start: %s, end: %s\n",
@@ -274,6 +301,7 @@ tsp_t *tsp_new_from_generic (vrp_t *vrp) {
                 (self->end_node != ID_NONE) ? "set" : "none");
     route_print (self->template);
 
+    self->sweep_order = NULL;
     self->rng = rng_new ();
     return self;
 }
@@ -285,6 +313,7 @@ void tsp_free (tsp_t **self_p) {
         tsp_t *self = *self_p;
         route_free (&self->template);
         rng_free (&self->rng);
+        arena_free (&self->arena);
         free (self);
         *self_p = NULL;
     }
@@ -314,13 +343,10 @@ solution_t *tsp_solve (tsp_t *self) {
                                  false,
                                  1);
 
-    size_t num_free_nodes = route_size (self->template);
-    num_free_nodes -= (self->start_node != ID_NONE) ? 1 : 0;
-    num_free_nodes -= (self->end_node != ID_NONE) ? 1 : 0;
     evol_register_heuristic (evol,
                              (evol_heuristic_t) tsp_random_permutation,
                              true,
-                             factorial (num_free_nodes));
+                             factorial (tsp_num_free_nodes (self)));
 
     evol_register_crossover (evol, (evol_crossover_t) tsp_ox);
     evol_register_educator (evol, (evol_educator_t) tsp_local_search_for_evol);
@@ -329,7 +355,9 @@ solution_t *tsp_solve (tsp_t *self) {
     evol_run (evol);
 
     // Get best genome (route)
-    route_t *route = route_dup ((route_t *) evol_best_genome (evol));
+    const route_t *best = (route_t *) evol_best_genome (evol);
+    route_t *route = route_new_from_array (route_node_array (best),
+                                           route_size (best));
     assert (route);
 
     // Destroy evolution object
@@ -419,12 +447,25 @@ void tsp_test (bool verbose) {
     // 2. benchmark problem, solved top-down (recognized as a TSP sub-model by
     // generic model and then solved)
 
-    char filename[] =
-        "benchmark/tsplib/tsp/berlin52.tsp";
-        // "benchmark/tsplib/tsp/a280.tsp";
+    // First cities of berlin52
+    const char *filename = "tsp-test.tsp";
+    FILE *file = fopen (filename, "w");
+    assert (file);
+    fputs ("NAME : tsp-test\n"
+           "TYPE : TSP\n"
+           "DIMENSION : 10\n"
+           "EDGE_WEIGHT_TYPE : EUC_2D\n"
+           "NODE_COORD_SECTION\n"
+           "1 565.0 575.0\n2 25.0 185.0\n3 345.0 750.0\n4 945.0 685.0\n"
+           "5 845.0 655.0\n6 880.0 660.0\n7 25.0 230.0\n8 525.0 1000.0\n"
+           "9 580.0 1175.0\n10 650.0 1130.0\n"
+           "EOF\n", file);
+    fclose (file);
 
     vrp = vrp_new_from_file (filename);
+    remove (filename);
     assert (vrp);
+    assert (vrp_num_nodes (vrp) == 10);
 
     printf ("#nodes: %zu\n", vrp_num_nodes (vrp));
     printf ("#vehicles: %zu\n", vrp_num_vehicles (vrp));
@@ -12,6 +12,11 @@
 */
 
 #include "classes.h"
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 // ---------------------------------------------------------------------------
@@ -22,7 +27,7 @@ typedef struct {
     char ext_id[UUID_STR_LEN]; // external id connecting to outside
 
     // node_type_t type; // NT_DEPOT or NT_CUSTOMER
-    coord2d_t coord; // 2D coordinates
+    size_t vertex; // vertex in road network, or ID_NONE
 
     listu_t *pending_request_ids; // associated pending requests
     // ... other renferences
@@ -31,17 +36,17 @@ typedef struct {
 
 
 // Create a node
-static s_node_t *s_node_new (const char *ext_id) {
+static s_node_t *s_node_new (arena_t *arena, const char *ext_id) {
     assert (ext_id);
     assert (strlen (ext_id) <= UUID_STR_LEN);
 
-    s_node_t *self = (s_node_t *) malloc (sizeof (s_node_t));
+    s_node_t *self = (s_node_t *) arena_alloc (arena, sizeof (s_node_t));
     assert (self);
 
     self->id = ID_NONE;
 
     strcpy (self->ext_id, ext_id);
-    coord2d_set_none (&self->coord);
+    self->vertex = ID_NONE;
 
     self->pending_request_ids = listu_new (1);
     assert (self->pending_request_ids);
@@ -56,7 +61,7 @@ static void s_node_free (s_node_t **self_p) {
     if (*self_p) {
         s_node_t *self = *self_p;
         listu_free (&self->pending_request_ids);
-        free (self);
+        arena_release (self);
         *self_p = NULL;
     }
 }
@@ -69,9 +74,6 @@ typedef struct {
     size_t id;
     char ext_id[UUID_STR_LEN];
 
-    double max_capacity; // maximal capacity
-    double capacity; // current capacity
-
     // @todo use id or s_node_t?
     size_t start_node_id;
     size_t end_node_id;
@@ -79,24 +81,31 @@ typedef struct {
     // coord2d_t coord; // position track
 
     size_t route_id; // attached route
+
+    // Executed part of route, which solvers keep as it is
+    listu_t *fixed_node_ids; // visited stops after start node, or NULL
+    double fixed_quantity; // quantity delivered to visited stops
+    size_t departure_time; // departure time from last visited stop
 } s_vehicle_t;
 
 
 // Create a vehicle
-static s_vehicle_t *s_vehicle_new (const char *ext_id) {
+static s_vehicle_t *s_vehicle_new (arena_t *arena, const char *ext_id) {
     assert (ext_id);
     assert (strlen (ext_id) <= UUID_STR_LEN);
 
-    s_vehicle_t *self = (s_vehicle_t *) malloc (sizeof (s_vehicle_t));
+    s_vehicle_t *self =
+        (s_vehicle_t *) arena_alloc (arena, sizeof (s_vehicle_t));
     assert (self);
 
     self->id = ID_NONE;
     strcpy (self->ext_id, ext_id);
-    self->max_capacity = DOUBLE_MAX; // no capacity constraint
-    self->capacity = self->max_capacity;
     self->start_node_id = ID_NONE;
     self->end_node_id = ID_NONE;
     self->route_id = ID_NONE;
+    self->fixed_node_ids = NULL;
+    self->fixed_quantity = 0;
+    self->departure_time = SIZE_NONE;
 
     return self;
 }
@@ -109,8 +118,9 @@ static void s_vehicle_free (s_vehicle_t **self_p) {
         s_vehicle_t *self = *self_p;
 
         // free properties
+        listu_free (&self->fixed_node_ids);
 
-        free (self);
+        arena_release (self);
         *self_p = NULL;
     }
 }
@@ -134,6 +144,7 @@ typedef enum {
     RS_BEFORE_VISIT,
     RS_VISITING,
     RS_COMPLETED, // task exeuted
+    RS_CANCELLED // cancelled before it is executed
 } request_state_t;
 
 
@@ -170,22 +181,8 @@ typedef struct {
 
     request_state_t state;
 
-    // Task: pickup at sender, deliver at receiver
-    size_t sender_id;
-    size_t receiver_id;
-    double quantity; // >= 0
-
-    // Note that time windows and service durations are associated with
-    // request rather than node, which is more natural in practice.
-    // Multiple time windows are supported and sorted in ascending order:
-    // (etw1, ltw1, etw2, ltw2, ...)
-    // The value represents number of time units since a common reference point.
-    listu_t *pickup_time_windows;
-    listu_t *delivery_time_windows;
-
-    // Service duration
-    size_t pickup_duration; // service duration for pickup (num of time units)
-    size_t delivery_duration; // service duration for delivery (num of time units)
+    // Task (sender, receiver and quantity), time windows and service
+    // durations are kept by field in vrp_t, see vrp_reserve_request_fields ()
 
     // Solution related
     // vehicle attached to. One request is attached to one vehicle at most.
@@ -194,31 +191,17 @@ typedef struct {
 
 
 // Create a request object
-static s_request_t *s_request_new (const char *ext_id) {
+static s_request_t *s_request_new (arena_t *arena, const char *ext_id) {
     assert (ext_id && strlen (ext_id) <= UUID_STR_LEN);
 
-    s_request_t *self = (s_request_t *) malloc (sizeof (s_request_t));
+    s_request_t *self =
+        (s_request_t *) arena_alloc (arena, sizeof (s_request_t));
     assert (self);
 
     self->id = ID_NONE;
     strcpy (self->ext_id, ext_id);
     self->type = RT_NONE;
     self->state = RS_PENDING;
-
-    self->sender_id = ID_NONE;
-    self->receiver_id = ID_NONE;
-    self->quantity = 0;
-
-    self->pickup_time_windows = listu_new (2);
-    assert (self->pickup_time_windows);
-    listu_sort (self->pickup_time_windows, true);
-    self->delivery_time_windows = listu_new (2);
-    assert (self->delivery_time_windows);
-    listu_sort (self->delivery_time_windows, true);
-
-    self->pickup_duration = 0;
-    self->delivery_duration = 0;
-
     self->vehicle_id = ID_NONE;
     return self;
 }
@@ -228,31 +211,220 @@ static s_request_t *s_request_new (const char *ext_id) {
 static void s_request_free (s_request_t **self_p) {
     assert (self_p);
     if (*self_p) {
-        s_request_t *self = *self_p;
-        listu_free (&self->pickup_time_windows);
-        listu_free (&self->delivery_time_windows);
-        free (self);
+        arena_release (*self_p);
         *self_p = NULL;
     }
 }
 
 
+// ---------------------------------------------------------------------------
+// Bulk ingestion helpers
+
+static int s_size_compare (const size_t *a, const size_t *b) {
+    return (*a < *b) ? -1 : ((*a > *b) ? 1 : 0);
+}
+
+
+// Merge IDs into ascendingly sorted list, and drop duplicates.
+// IDs are sorted once rather than inserted one by one.
+static void s_merge_sorted_ids (listu_t *list, const size_t *ids, size_t num_ids) {
+    if (num_ids == 0)
+        return;
+
+    size_t num_old = listu_size (list);
+    size_t *all = (size_t *) malloc ((num_old + num_ids) * sizeof (size_t));
+    assert (all);
+    if (num_old > 0)
+        memcpy (all, listu_array (list), num_old * sizeof (size_t));
+    memcpy (all + num_old, ids, num_ids * sizeof (size_t));
+    qsort (all, num_old + num_ids, sizeof (size_t),
+           (comparator_t) s_size_compare);
+
+    size_t num_unique = 0;
+    for (size_t idx = 0; idx < num_old + num_ids; idx++) {
+        if (num_unique == 0 || all[idx] != all[num_unique - 1])
+            all[num_unique++] = all[idx];
+    }
+
+    listu_clear (list);
+    listu_extend_array (list, all, num_unique);
+    listu_sort (list, true);
+    free (all);
+}
+
+
+// ---------------------------------------------------------------------------
+// Time windows of request node
+// Note that time windows and service durations are associated with request
+// rather than node, which is more natural in practice. Multiple time windows
+// are supported and sorted in ascending order: (etw1, ltw1, etw2, ltw2, ...).
+// The value represents number of time units since a common reference point.
+// Most nodes have one or two time windows, which are kept inline; more
+// windows are moved to heap.
+
+#define VRP_INLINE_TIME_WINDOWS 2
+
+typedef struct {
+    size_t size; // number of values, two per time window
+    size_t alloc_size; // number of values heap_values could hold
+    size_t inline_values[2 * VRP_INLINE_TIME_WINDOWS];
+    size_t *heap_values; // values if they do not fit inline, or NULL
+} s_time_windows_t;
+
+
+// Spilled values are taken from allocator hook of model
+static void *vrp_resize_field (vrp_t *self,
+                               void *array,
+                               size_t old_size,
+                               size_t size,
+                               size_t elem_size);
+static void vrp_free_field (vrp_t *self, void *array);
+
+
+static void s_time_windows_init (s_time_windows_t *self) {
+    self->size = 0;
+    self->alloc_size = 0;
+    self->heap_values = NULL;
+}
+
+
+static void s_time_windows_release (s_time_windows_t *self, vrp_t *vrp) {
+    vrp_free_field (vrp, self->heap_values);
+    s_time_windows_init (self);
+}
+
+
+static const size_t *s_time_windows_values (const s_time_windows_t *self) {
+    return (self->heap_values != NULL) ?
+           self->heap_values : self->inline_values;
+}
+
+
+// Insert time window [earliest, latest].
+// Return 0 if succeeded, -1 if it overlaps other time windows.
+static int s_time_windows_insert (s_time_windows_t *self,
+                                  vrp_t *vrp,
+                                  size_t earliest,
+                                  size_t latest) {
+    // Number of values not after earliest: even if earliest is out of all
+    // time windows
+    const size_t *values = s_time_windows_values (self);
+    size_t pos = 0;
+    while (pos < self->size && values[pos] <= earliest)
+        pos++;
+    if (pos % 2 != 0 || (pos < self->size && values[pos] <= latest))
+        return -1;
+
+    if (self->size + 2 > 2 * VRP_INLINE_TIME_WINDOWS &&
+        self->size + 2 > self->alloc_size) {
+        size_t alloc_size = max2 (self->size + 2, self->size * 2);
+        size_t *heap_values =
+            (size_t *) vrp_resize_field (vrp, self->heap_values,
+                                         self->alloc_size, alloc_size,
+                                         sizeof (size_t));
+        if (self->heap_values == NULL)
+            memcpy (heap_values, self->inline_values,
+                    self->size * sizeof (size_t));
+        self->heap_values = heap_values;
+        self->alloc_size = alloc_size;
+    }
+
+    size_t *array = (size_t *) s_time_windows_values (self);
+    memmove (array + pos + 2, array + pos,
+             (self->size - pos) * sizeof (size_t));
+    array[pos] = earliest;
+    array[pos + 1] = latest;
+    self->size += 2;
+    return 0;
+}
+
+
+static bool s_time_windows_equal (const s_time_windows_t *a,
+                                  const s_time_windows_t *b) {
+    return a->size == b->size &&
+           (a->size == 0 ||
+            memcmp (s_time_windows_values (a), s_time_windows_values (b),
+                    a->size * sizeof (size_t)) == 0);
+}
+
+
 // ---------------------------------------------------------------------------
 // VRP Model
 
+// Record of arc update
+typedef struct {
+    size_t from_node_id;
+    size_t to_node_id;
+    size_t seq; // order of update
+    double old_distance; // distance before update, or DOUBLE_NONE
+} s_arc_change_t;
+
+
 struct _vrp_t {
 
     // Roadgraph
     arrayset_t *nodes; // vertices of road graph
-    matrixd_t *distances; // arc distance matrix
-    matrixu_t *durations; // arc duration matrix
+    strindex_t *node_index; // node ID by external ID
+    arcmatrix_t *distances; // arc distance matrix
+    arcmatrix_t *durations; // arc duration matrix
+    bool compact_arcs; // float32 distances and uint32 durations
+    bool symmetric_arcs; // one triangle of matrices stored
+    bool integer_distances; // int32 distances
+    size_t *arc_rows; // matrix row of each node ID, or NULL if row is ID
+    size_t arc_rows_size; // number of node IDs arc_rows could hold
+    size_t num_arc_rows; // number of matrix rows assigned in arc_rows
+    bool on_demand_distances; // distances computed from coordinates when
+                              // there is no distance matrix
+    rowcache_t *distance_cache; // cache of on-demand distances, or NULL
+    double detour_factor; // on-demand distances are beeline * detour_factor
+    sparsearcs_t *sparse_arcs; // arcs stored sparsely, others on demand,
+                               // or NULL
+    roadnet_t *road_network; // road network which arcs are computed on, or
+                             // NULL
+    tdarcs_t *td_durations; // time-dependent durations, or NULL
+    s_arc_change_t *arc_changes; // arcs updated since last re-evaluation
+    size_t num_arc_changes;
+    size_t arc_changes_alloc_size;
+    double duration_speed; // speed durations are generated with, or 0.
+                           // Durations are on-demand distances / speed
+                           // when there is no duration matrix.
     coord2d_sys_t coord_sys; // coordinate system
 
+    // Fields which are scanned over many nodes, vehicles or requests are
+    // stored by field in arrays indexed by ID, rather than in objects
+    coord2d_t *node_coords; // 2D coordinates
+    size_t node_fields_size; // number of node IDs arrays could hold
+    spatialindex_t *spatial_index; // node coordinates, built on first
+                                   // spatial query, or NULL
+
     // Fleet
     arrayset_t *vehicles;
+    strindex_t *vehicle_index; // vehicle ID by external ID
+    double *vehicle_max_capacities;
+    double *vehicle_capacities; // current capacities
+    size_t vehicle_fields_size; // number of vehicle IDs arrays could hold
 
     // Transportation requests
     arrayset_t *requests;
+    strindex_t *request_index; // request ID by external ID
+    size_t *request_senders; // pickup node, or ID_NONE
+    size_t *request_receivers; // delivery node, or ID_NONE
+    double *request_quantities; // >= 0
+    s_time_windows_t *pickup_time_windows;
+    s_time_windows_t *delivery_time_windows;
+    size_t *pickup_durations; // service durations (num of time units)
+    size_t *delivery_durations;
+    size_t request_fields_size; // number of request IDs arrays could hold
+
+    // Customers which pending requests are merged into before solving, see
+    // vrp_aggregate_customers ()
+    listu_t *customer_request_ids; // representative requests, or NULL
+    size_t *request_customers; // representative request of pending request
+    size_t *merged_request_ids; // next request merged into same customer,
+                                // or ID_NONE
+    double *customer_quantities; // total quantity, by representative
+    size_t *customer_durations; // total delivery service duration
+    size_t customer_fields_size; // number of request IDs arrays could hold
 
     // Constraints
     double max_route_distance;
@@ -260,6 +432,12 @@ struct _vrp_t {
     // ...
 
 
+    // Memory
+    vrp_alloc_t alloc_fn; // allocator hook, NULL for malloc
+    vrp_free_t free_fn; // deallocator hook, NULL for free
+    void *alloc_context; // user data of allocator hooks
+    arena_t *arena; // storage of nodes, vehicles and requests
+
     // Auxiliaries
 
     rng_t *rng;
@@ -272,6 +450,27 @@ struct _vrp_t {
                            // request, sorted ascendingly
     listu_t *pending_request_ids; // IDs of requests which state is pending,
                                   // sorted ascendingly
+
+    // Counters kept as model changes, so that validation and submodel
+    // detection do not scan the model at each solve
+    size_t num_nodes_without_coord;
+    size_t num_distances_set; // set arcs between nodes in distance matrix
+    size_t num_durations_set; // set arcs between nodes in duration matrix
+    size_t num_td_durations_set; // set arcs between nodes in time-dependent
+                                 // durations
+    bool roadgraph_counts_stale; // roadgraph counters are recounted on next
+                                 // validation, e.g. after a matrix is loaded
+    size_t num_pending_pd; // pending pickup-and-delivery requests
+    size_t num_pending_plain_visits; // pending visits without goods
+    size_t num_pending_with_sender;
+    size_t num_pending_with_receiver;
+    size_t num_pending_with_time_windows;
+    double fleet_capacity; // max capacity of first vehicle
+    size_t fleet_start_node_id; // start node of first vehicle which has one
+    size_t fleet_end_node_id; // end node of first vehicle which has one
+    bool vehicles_have_same_capacity;
+    bool vehicles_start_at_same_node;
+    bool vehicles_end_at_same_node;
 };
 
 
@@ -280,42 +479,223 @@ struct _vrp_t {
 // ---------------------------------------------------------------------------
 
 
+// Set of objects (nodes, vehicles or requests). Their external IDs are
+// indexed apart, see s_add_indexed ().
+static arrayset_t *s_arrayset_new (size_t alloc_size, destructor_t destructor) {
+    arrayset_t *set = arrayset_new (alloc_size);
+    assert (set);
+    arrayset_set_data_destructor (set, destructor);
+    return set;
+}
+
+
+// Add object to set and its external ID to index.
+// Return ID of object, or ID_NONE if external ID already exists.
+static size_t s_add_indexed (arrayset_t *set,
+                             strindex_t *index,
+                             void *data,
+                             const char *ext_id) {
+    if (strindex_query (index, ext_id) != ID_NONE)
+        return ID_NONE;
+    size_t id = arrayset_add (set, data, NULL);
+    assert (id != ID_NONE);
+    strindex_insert (index, ext_id, id);
+    return id;
+}
+
+
+// Resize per-field array from old_size to size elements. Memory is taken from
+// allocator hook of model if it is set.
+static void *vrp_resize_field (vrp_t *self,
+                               void *array,
+                               size_t old_size,
+                               size_t size,
+                               size_t elem_size) {
+    if (self->alloc_fn == NULL) {
+        void *resized = realloc (array, size * elem_size);
+        assert (resized);
+        return resized;
+    }
+
+    assert (old_size <= size);
+    void *resized = self->alloc_fn (self->alloc_context, size * elem_size);
+    assert (resized);
+    if (array != NULL) {
+        memcpy (resized, array, old_size * elem_size);
+        self->free_fn (self->alloc_context, array);
+    }
+    return resized;
+}
+
+
+// Free per-field array
+static void vrp_free_field (vrp_t *self, void *array) {
+    if (array == NULL)
+        return;
+    if (self->free_fn == NULL)
+        free (array);
+    else
+        self->free_fn (self->alloc_context, array);
+}
+
+
+// Make per-field arrays of nodes hold node ID, and clear its fields
+static void vrp_reserve_node_fields (vrp_t *self, size_t node_id) {
+    if (node_id >= self->node_fields_size) {
+        size_t old_size = self->node_fields_size;
+        size_t size = max3 (node_id + 1, old_size * 2, 16);
+        self->node_coords =
+            vrp_resize_field (self, self->node_coords, old_size, size,
+                              sizeof (coord2d_t));
+        self->node_fields_size = size;
+    }
+    coord2d_set_none (&self->node_coords[node_id]);
+}
+
+
+// Make per-field arrays of vehicles hold vehicle ID, and clear its fields
+static void vrp_reserve_vehicle_fields (vrp_t *self, size_t vehicle_id) {
+    if (vehicle_id >= self->vehicle_fields_size) {
+        size_t old_size = self->vehicle_fields_size;
+        size_t size = max3 (vehicle_id + 1, old_size * 2, 4);
+        self->vehicle_max_capacities =
+            vrp_resize_field (self, self->vehicle_max_capacities,
+                              old_size, size, sizeof (double));
+        self->vehicle_capacities =
+            vrp_resize_field (self, self->vehicle_capacities, old_size, size,
+                              sizeof (double));
+        self->vehicle_fields_size = size;
+    }
+    self->vehicle_max_capacities[vehicle_id] = DOUBLE_MAX; // no constraint
+    self->vehicle_capacities[vehicle_id] = DOUBLE_MAX;
+}
+
+
+// Make per-field arrays of requests hold request ID, and clear its fields
+static void vrp_reserve_request_fields (vrp_t *self, size_t request_id) {
+    if (request_id >= self->request_fields_size) {
+        size_t old_size = self->request_fields_size;
+        size_t size = max3 (request_id + 1, old_size * 2, 16);
+        self->request_senders =
+            vrp_resize_field (self, self->request_senders, old_size, size,
+                              sizeof (size_t));
+        self->request_receivers =
+            vrp_resize_field (self, self->request_receivers, old_size, size,
+                              sizeof (size_t));
+        self->request_quantities =
+            vrp_resize_field (self, self->request_quantities, old_size, size,
+                              sizeof (double));
+        self->pickup_time_windows =
+            vrp_resize_field (self, self->pickup_time_windows, old_size, size,
+                              sizeof (s_time_windows_t));
+        self->delivery_time_windows =
+            vrp_resize_field (self, self->delivery_time_windows, old_size, size,
+                              sizeof (s_time_windows_t));
+        self->pickup_durations =
+            vrp_resize_field (self, self->pickup_durations, old_size, size,
+                              sizeof (size_t));
+        self->delivery_durations =
+            vrp_resize_field (self, self->delivery_durations, old_size, size,
+                              sizeof (size_t));
+        self->request_fields_size = size;
+    }
+    self->request_senders[request_id] = ID_NONE;
+    self->request_receivers[request_id] = ID_NONE;
+    self->request_quantities[request_id] = 0;
+    s_time_windows_init (&self->pickup_time_windows[request_id]);
+    s_time_windows_init (&self->delivery_time_windows[request_id]);
+    self->pickup_durations[request_id] = 0;
+    self->delivery_durations[request_id] = 0;
+}
+
+
+// Coordinates of node
+static coord2d_t *vrp_coord (const vrp_t *self, size_t node_id) {
+    assert (node_id < self->node_fields_size);
+    return &self->node_coords[node_id];
+}
+
+
+// Time windows of request in node role
+static s_time_windows_t *vrp_request_time_windows (const vrp_t *self,
+                                                   size_t request_id,
+                                                   node_role_t node_role) {
+    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
+    assert (request_id < self->request_fields_size);
+    return (node_role == NR_SENDER) ?
+           &self->pickup_time_windows[request_id] :
+           &self->delivery_time_windows[request_id];
+}
+
+
 vrp_t *vrp_new (void) {
     vrp_t *self = (vrp_t *) malloc (sizeof (vrp_t));
     assert (self);
 
     // Roadgraph
-    self->nodes = arrayset_new (0);
-    arrayset_set_data_destructor (self->nodes, (destructor_t) s_node_free);
-    arrayset_set_hash (self->nodes,
-                       (hashfunc_t) string_hash,
-                       (matcher_t) string_equal,
-                       NULL);
+    self->nodes = s_arrayset_new (0, (destructor_t) s_node_free);
+    self->node_index = strindex_new (0);
 
     self->distances = NULL; // lazy creation
     self->durations = NULL; // lazy creation
+    self->compact_arcs = false;
+    self->symmetric_arcs = false;
+    self->integer_distances = false;
+    self->arc_rows = NULL;
+    self->arc_rows_size = 0;
+    self->num_arc_rows = 0;
+    self->on_demand_distances = false;
+    self->distance_cache = NULL;
+    self->detour_factor = 1;
+    self->sparse_arcs = NULL;
+    self->road_network = NULL;
+    self->td_durations = NULL;
+    self->arc_changes = NULL;
+    self->num_arc_changes = 0;
+    self->arc_changes_alloc_size = 0;
+    self->duration_speed = 0;
     self->coord_sys = CS_NONE;
+    self->node_coords = NULL;
+    self->node_fields_size = 0;
+    self->spatial_index = NULL;
 
     // Fleet
-    self->vehicles = arrayset_new (1);
-    arrayset_set_data_destructor (self->vehicles, (destructor_t) s_vehicle_free);
-    arrayset_set_hash (self->vehicles,
-                       (hashfunc_t) string_hash,
-                       (matcher_t) string_equal,
-                       NULL);
+    self->vehicles =
+        s_arrayset_new (1, (destructor_t) s_vehicle_free);
+    self->vehicle_index = strindex_new (0);
+    self->vehicle_max_capacities = NULL;
+    self->vehicle_capacities = NULL;
+    self->vehicle_fields_size = 0;
 
     // Requests
-    self->requests = arrayset_new (1);
-    arrayset_set_data_destructor (self->requests, (destructor_t) s_request_free);
-    arrayset_set_hash (self->requests,
-                       (hashfunc_t) string_hash,
-                       (matcher_t) string_equal,
-                       NULL);
+    self->requests =
+        s_arrayset_new (1, (destructor_t) s_request_free);
+    self->request_index = strindex_new (0);
+    self->request_senders = NULL;
+    self->request_receivers = NULL;
+    self->request_quantities = NULL;
+    self->pickup_time_windows = NULL;
+    self->delivery_time_windows = NULL;
+    self->pickup_durations = NULL;
+    self->delivery_durations = NULL;
+    self->request_fields_size = 0;
+    self->customer_request_ids = NULL;
+    self->request_customers = NULL;
+    self->merged_request_ids = NULL;
+    self->customer_quantities = NULL;
+    self->customer_durations = NULL;
+    self->customer_fields_size = 0;
 
     // Constraints
     self->max_route_distance = DOUBLE_MAX; // no constraint
     self->max_route_duration = SIZE_MAX; // no constraint
 
+    // Memory
+    self->alloc_fn = NULL;
+    self->free_fn = NULL;
+    self->alloc_context = NULL;
+    self->arena = arena_new (NULL, NULL, NULL);
+
     // Auxiliaries
     self->rng = rng_new ();
     self->node_ids = listu_new (0);
@@ -329,6 +709,24 @@ vrp_t *vrp_new (void) {
     self->pending_request_ids = listu_new (0);
     listu_sort (self->pending_request_ids, true);
 
+    // Counters
+    self->num_nodes_without_coord = 0;
+    self->num_distances_set = 0;
+    self->num_durations_set = 0;
+    self->num_td_durations_set = 0;
+    self->roadgraph_counts_stale = false;
+    self->num_pending_pd = 0;
+    self->num_pending_plain_visits = 0;
+    self->num_pending_with_sender = 0;
+    self->num_pending_with_receiver = 0;
+    self->num_pending_with_time_windows = 0;
+    self->fleet_capacity = DOUBLE_NONE;
+    self->fleet_start_node_id = ID_NONE;
+    self->fleet_end_node_id = ID_NONE;
+    self->vehicles_have_same_capacity = true;
+    self->vehicles_start_at_same_node = true;
+    self->vehicles_end_at_same_node = true;
+
     print_info ("vrp created.\n");
     return self;
 }
@@ -340,10 +738,46 @@ void vrp_free (vrp_t **self_p) {
         vrp_t *self = *self_p;
 
         arrayset_free (&self->nodes);
-        matrixd_free (&self->distances);
-        matrixu_free (&self->durations);
+        strindex_free (&self->node_index);
+        arcmatrix_free (&self->distances);
+        arcmatrix_free (&self->durations);
+        free (self->arc_rows);
+        rowcache_free (&self->distance_cache);
+        sparsearcs_free (&self->sparse_arcs);
+        roadnet_free (&self->road_network);
+        tdarcs_free (&self->td_durations);
+        free (self->arc_changes);
+        vrp_free_field (self, self->node_coords);
+        spatialindex_free (&self->spatial_index);
         arrayset_free (&self->vehicles);
+        strindex_free (&self->vehicle_index);
+        vrp_free_field (self, self->vehicle_max_capacities);
+        vrp_free_field (self, self->vehicle_capacities);
+
+        for (s_request_t *request =
+                 (s_request_t *) arrayset_first (self->requests);
+             request != NULL;
+             request = (s_request_t *) arrayset_next (self->requests)) {
+            s_time_windows_release (&self->pickup_time_windows[request->id],
+                                    self);
+            s_time_windows_release (&self->delivery_time_windows[request->id],
+                                    self);
+        }
         arrayset_free (&self->requests);
+        strindex_free (&self->request_index);
+        vrp_free_field (self, self->request_senders);
+        vrp_free_field (self, self->request_receivers);
+        vrp_free_field (self, self->request_quantities);
+        vrp_free_field (self, self->pickup_time_windows);
+        vrp_free_field (self, self->delivery_time_windows);
+        vrp_free_field (self, self->pickup_durations);
+        vrp_free_field (self, self->delivery_durations);
+        listu_free (&self->customer_request_ids);
+        vrp_free_field (self, self->request_customers);
+        vrp_free_field (self, self->merged_request_ids);
+        vrp_free_field (self, self->customer_quantities);
+        vrp_free_field (self, self->customer_durations);
+        arena_free (&self->arena);
 
         // auxiliaries
         rng_free (&self->rng);
@@ -360,313 +794,838 @@ void vrp_free (vrp_t **self_p) {
 }
 
 
-vrp_t *vrp_new_from_file (const char *filename) {
-    assert (filename);
+void vrp_set_allocator (vrp_t *self,
+                        vrp_alloc_t alloc_fn,
+                        vrp_free_t free_fn,
+                        void *context) {
+    assert (self);
+    assert ((alloc_fn == NULL) == (free_fn == NULL));
+    // Objects already allocated can not be moved to the new allocator
+    assert (arrayset_size (self->nodes) == 0);
+    assert (arrayset_size (self->vehicles) == 0);
+    assert (arrayset_size (self->requests) == 0);
+
+    self->alloc_fn = alloc_fn;
+    self->free_fn = free_fn;
+    self->alloc_context = context;
+
+    arena_free (&self->arena);
+    self->arena = arena_new (alloc_fn, free_fn, context);
+}
 
-    enum {
-        DATA_SECTION_NONE,
-        EDGE_WEIGHT_SECTION,
-        NODE_COORD_SECTION,
-        DEMAND_SECTION,
-        DEPOT_SECTION
-    } data_section = DATA_SECTION_NONE;
-
-    enum {
-        EDGE_WEIGHT_TYPE_NONE,
-        EUC_2D,
-        EXPLICIT
-    } edge_weight_type = EDGE_WEIGHT_TYPE_NONE;
-
-    enum {
-        EDGE_WEIGHT_FORMAT_NONE,
-        LOWROW
-    } edge_weight_format = EDGE_WEIGHT_FORMAT_NONE;
 
-    vrp_t *self = NULL;
-    size_t num_vehicles = 1;
-    size_t num_nodes;
-    double capacity = DOUBLE_MAX;
-    double *demands = NULL;
-    matrixd_t *costs = NULL;
-    coord2d_t *coords = NULL;
+arena_t *vrp_new_arena (const vrp_t *self) {
+    assert (self);
+    return arena_new (self->alloc_fn, self->free_fn, self->alloc_context);
+}
 
-    const int LINE_LEN = 128;
-    char line[LINE_LEN];
-    const char *p = NULL;
 
-    int ind1 = 0, ind2 = 0;
-    int value1, value2; // double?
-    double value_d;
-    int value_i;
+// ---------------------------------------------------------------------------
+// TSPLIB / CVRPLIB file loader
+//
+// File is mapped and scanned once by a tokenizer working on the mapped bytes
+// directly, so lines of any length are accepted. Values are written straight
+// into node coordinates and the arc distance matrix of model.
 
-    FILE *vrpfile;
-    int error_flag = 0;
+static void vrp_create_distances (vrp_t *self, size_t order);
+static void vrp_create_durations (vrp_t *self, size_t order);
+static s_node_t *vrp_node (const vrp_t *self, size_t node_id);
+static void vrp_recount_roadgraph (vrp_t *self);
 
-    // Open file
-    vrpfile = fopen (filename, "r");
-    if (vrpfile == NULL) {
-        print_error ("Open VRP file %s failed.\n", filename);
-        return NULL;
-    }
 
-    // Recognize file format and try to read vehicle number K from filename
-    p = strrchr (filename, '.');
-    // VRP
-    if (p != NULL && (strcmp (p + 1, "vrp") == 0 || strcmp (p + 1, "VRP") == 0)) {
-        // try to get K from filename
-        p = strrchr (filename, 'k');
-        if (p == NULL)
-            p = strrchr (filename, 'K');
-        if (p != NULL)
-            num_vehicles = (size_t) strtol (p + 1, NULL, 10);
-        else
-            print_warning ("No vehicle number specified in filename.\n");
+// Scanner over mapped file content [cursor, end)
+typedef struct {
+    const char *cursor;
+    const char *end;
+} s_scanner_t;
+
+
+// Skip spaces (including line breaks)
+static void s_scanner_skip_space (s_scanner_t *self) {
+    while (self->cursor < self->end && isspace ((unsigned char) *self->cursor))
+        self->cursor++;
+}
+
+
+// Skip spaces in current line
+static void s_scanner_skip_blank (s_scanner_t *self) {
+    while (self->cursor < self->end &&
+           (*self->cursor == ' ' || *self->cursor == '\t' ||
+            *self->cursor == '\r'))
+        self->cursor++;
+}
+
+
+// Skip the rest of current line
+static void s_scanner_skip_line (s_scanner_t *self) {
+    while (self->cursor < self->end && *self->cursor != '\n')
+        self->cursor++;
+}
+
+
+// Read a word of letters, digits and underscores after spaces.
+// Return length of word (0 if no word).
+static size_t s_scanner_read_word (s_scanner_t *self, const char **word) {
+    s_scanner_skip_space (self);
+    *word = self->cursor;
+    while (self->cursor < self->end &&
+           (isalnum ((unsigned char) *self->cursor) || *self->cursor == '_'))
+        self->cursor++;
+    return (size_t) (self->cursor - *word);
+}
+
+
+// Check if a number follows after spaces
+static bool s_scanner_has_number (s_scanner_t *self) {
+    s_scanner_skip_space (self);
+    if (self->cursor >= self->end)
+        return false;
+    char c = *self->cursor;
+    return isdigit ((unsigned char) c) || c == '-' || c == '+' || c == '.';
+}
+
+
+// Read a decimal number after spaces, e.g. "-12", "3.5", "1.2e+03".
+// Return false if there is no number.
+static bool s_scanner_read_number (s_scanner_t *self, double *value) {
+    if (!s_scanner_has_number (self))
+        return false;
+
+    const char *p = self->cursor;
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+
+    double mantissa = 0;
+    int exponent = 0;
+    bool has_digits = false;
+    for (; p < self->end && isdigit ((unsigned char) *p); p++) {
+        mantissa = mantissa * 10 + (*p - '0');
+        has_digits = true;
     }
-    // TSP
-    else if (p != NULL &&
-             (strcmp (p + 1, "tsp") == 0 ||
-              strcmp (p + 1, "TSP") == 0 ||
-              strcmp (p + 1, "atsp") == 0 ||
-              strcmp (p + 1, "ATSP") == 0)) {
-        num_vehicles = 1;
+    if (p < self->end && *p == '.') {
+        for (p++; p < self->end && isdigit ((unsigned char) *p); p++) {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+            has_digits = true;
+        }
     }
-    else {
-        print_error ("Unsupported input file.\n");
-        return NULL;
+    if (!has_digits)
+        return false;
+
+    if (p < self->end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool exp_negative = false;
+        if (q < self->end && (*q == '-' || *q == '+'))
+            exp_negative = (*q++ == '-');
+        if (q < self->end && isdigit ((unsigned char) *q)) {
+            int exp = 0;
+            for (; q < self->end && isdigit ((unsigned char) *q); q++)
+                exp = exp * 10 + (*q - '0');
+            exponent += exp_negative ? -exp : exp;
+            p = q;
+        }
     }
 
-    // Read file content
-    while (error_flag == 0 && fgets (line, LINE_LEN, vrpfile) != NULL) {
+    if (exponent != 0)
+        mantissa = (exponent > 0) ? mantissa * pow (10, exponent) :
+                                    mantissa / pow (10, -exponent);
+    *value = negative ? -mantissa : mantissa;
+    self->cursor = p;
+    return true;
+}
 
-        p = strchr (line, ':');
 
-        if (p != NULL) { // specification part
+static bool s_word_is (const char *word, size_t len, const char *keyword) {
+    return len == strlen (keyword) && strncmp (word, keyword, len) == 0;
+}
 
-            data_section = DATA_SECTION_NONE;
 
-            if (strncmp (line, "DIMENSION", strlen ("DIMENSION")) == 0) {
-                num_nodes = strtol (p + 1, NULL, 10); // number of all nodes
-                costs = matrixd_new (num_nodes, num_nodes);
-                assert (costs);
-            }
+typedef enum {
+    EWT_NONE,
+    EWT_EUC_2D,
+    EWT_CEIL_2D,
+    EWT_ATT,
+    EWT_GEO,
+    EWT_EXPLICIT
+} s_edge_weight_type_t;
 
-            else if (strncmp (line, "CAPACITY", strlen ("CAPACITY")) == 0)
-                capacity = strtod (p + 1, NULL);
 
-            else if (strncmp (line, "EDGE_WEIGHT_TYPE",
-                              strlen ("EDGE_WEIGHT_TYPE")) == 0) {
-                if (strstr (p + 1, "EUC_2D") != NULL)
-                    edge_weight_type = EUC_2D;
-                else if (strstr (p + 1, "EXPLICIT") != NULL)
-                    edge_weight_type = EXPLICIT;
-                else {
-                    print_error ("unsupported EDGE_WEIGHT_TYPE: %s.\n", p + 1);
-                    error_flag = 1;
-                }
+typedef enum {
+    EWF_NONE,
+    EWF_FULL_MATRIX,
+    EWF_LOWER_ROW,
+    EWF_LOWER_DIAG_ROW,
+    EWF_UPPER_ROW,
+    EWF_UPPER_DIAG_ROW
+} s_edge_weight_format_t;
+
+
+// Distance of nodes by coordinates, see TSPLIB specification
+static double s_tsplib_distance (s_edge_weight_type_t type,
+                                 const coord2d_t *c1,
+                                 const coord2d_t *c2) {
+    double xd = c1->v1 - c2->v1;
+    double yd = c1->v2 - c2->v2;
+
+    switch (type) {
+        case EWT_EUC_2D:
+            return (double) (int) (sqrt (xd * xd + yd * yd) + 0.5);
+
+        case EWT_CEIL_2D:
+            return ceil (sqrt (xd * xd + yd * yd));
+
+        case EWT_ATT: { // pseudo-Euclidean
+            double r = sqrt ((xd * xd + yd * yd) / 10.0);
+            double t = (double) (int) (r + 0.5);
+            return (t < r) ? t + 1 : t;
+        }
+
+        case EWT_GEO: { // coordinates are converted to degrees already
+            const double pi = 3.141592; // value used by TSPLIB
+            const double rrr = 6378.388;
+            double lat1 = pi * c1->v1 / 180.0, lng1 = pi * c1->v2 / 180.0;
+            double lat2 = pi * c2->v1 / 180.0, lng2 = pi * c2->v2 / 180.0;
+            double q1 = cos (lng1 - lng2);
+            double q2 = cos (lat1 - lat2);
+            double q3 = cos (lat1 + lat2);
+            return (double) (int) (rrr * acos (0.5 * ((1.0 + q1) * q2 -
+                                                     (1.0 - q1) * q3)) + 1.0);
+        }
+
+        default:
+            assert (false);
+            return DOUBLE_NONE;
+    }
+}
+
+
+// TSPLIB GEO coordinate DDD.MM to degrees
+static double s_tsplib_geo_degrees (double value) {
+    double deg = (double) (int) value;
+    return deg + 5.0 * (value - deg) / 3.0;
+}
+
+
+// Position of next explicit edge weight in matrix of order n.
+// Return false if matrix is complete.
+static bool s_next_edge_weight_position (s_edge_weight_format_t format,
+                                         size_t n,
+                                         size_t *i,
+                                         size_t *j) {
+    switch (format) {
+        case EWF_FULL_MATRIX:
+            if (++(*j) == n) {
+                (*i)++;
+                *j = 0;
             }
+            return *i < n;
 
-            else if (strncmp (line, "EDGE_WEIGHT_FORMAT",
-                              strlen ("EDGE_WEIGHT_FORMAT")) == 0) {
-                if (strstr (p + 1, "LOWROW") != NULL)
-                    edge_weight_format = LOWROW;
-                else {
-                    print_error ("unsupported EDGE_WEIGHT_FORMAT: %s.\n", p + 1);
-                    error_flag = 1;
-                }
+        case EWF_LOWER_ROW: // j < i
+            if (++(*j) == *i) {
+                (*i)++;
+                *j = 0;
             }
-        }
+            return *i < n;
 
-        // Start of data part
-        else if (strstr (line, "SECTION") != NULL) {
-            if (strncmp (line, "NODE_COORD_SECTION",
-                         strlen ("NODE_COORD_SECTION")) == 0) {
-                data_section = NODE_COORD_SECTION;
-                coords = (coord2d_t *) malloc (num_nodes * sizeof (coord2d_t));
-                assert (coords);
+        case EWF_LOWER_DIAG_ROW: // j <= i
+            if (++(*j) > *i) {
+                (*i)++;
+                *j = 0;
             }
-            else if (strncmp (line, "DEMAND_SECTION",
-                              strlen ("DEMAND_SECTION")) == 0) {
-                data_section = DEMAND_SECTION;
-                demands = (double *) malloc (num_nodes * sizeof (double));
-                assert (demands);
+            return *i < n;
+
+        case EWF_UPPER_ROW: // j > i
+            if (++(*j) == n) {
+                (*i)++;
+                *j = *i + 1;
             }
-            else if (strncmp (line, "EDGE_WEIGHT_SECTION",
-                              strlen ("EDGE_WEIGHT_SECTION")) == 0) {
-                data_section = EDGE_WEIGHT_SECTION;
+            return *i + 1 < n;
+
+        case EWF_UPPER_DIAG_ROW: // j >= i
+            if (++(*j) == n) {
+                (*i)++;
+                *j = *i;
             }
-            else
-                data_section = DATA_SECTION_NONE;
-        }
+            return *i < n;
 
-        // Data
-        else {
-            switch (data_section) {
-                case NODE_COORD_SECTION:
-                    sscanf (line, "%d %d %d", &ind1, &value1, &value2);
-                    coords[ind1-1].v1 = (double) value1;
-                    coords[ind1-1].v2 = (double) value2;
-                    break;
+        default:
+            return false;
+    }
+}
 
-                case DEMAND_SECTION:
-                    sscanf (line, "%d %d", &ind1, &value1);
-                    demands[ind1-1] = (double) value1;
-                    break;
 
-                case EDGE_WEIGHT_SECTION:
-                    if (edge_weight_type == EXPLICIT) {
-                        switch (edge_weight_format) {
-                            case LOWROW:
-
-                                if (ind1 == 0 && ind2 == 0) {
-                                    // c[0] = 0;
-                                    matrixd_set (costs, 0, 0, 0);
-                                    ind1 = 1; // start at position (1, 0)
-                                }
-
-                                // PRINT("Splitting string \"%s\" into tokens:\n", line);
-                                p = strtok (line, " ");
-                                while (p != NULL) {
-                                    // c[(N+1)*ind1+ind2] = strtod (p, NULL);
-                                    // c[(N+1)*ind2+ind1] = c [(N+1)*ind1+ind2];
-                                    value_d = strtod (p, NULL);
-                                    matrixd_set (costs, ind1, ind2, value_d);
-                                    matrixd_set (costs, ind2, ind1, value_d);
-
-                                    ind2 += 1;
-                                    if (ind2 == ind1) {
-                                        // c[(N+1)*ind1+ind2] = 0; // asign 0 to diagonal
-                                        matrixd_set (costs, ind1, ind2, 0);
-                                        ind1 += 1; // new line
-                                        ind2 = 0;
-                                    }
-
-                                    p = strtok (NULL, " ");
-                                }
-                                break;
-
-                            default:
-                                break;
-                        }
-                    }
-                    break;
+// First position of explicit edge weights
+static void s_first_edge_weight_position (s_edge_weight_format_t format,
+                                          size_t *i,
+                                          size_t *j) {
+    switch (format) {
+        case EWF_LOWER_ROW:
+            *i = 1;
+            *j = 0;
+            break;
+        case EWF_UPPER_ROW:
+            *i = 0;
+            *j = 1;
+            break;
+        default:
+            *i = 0;
+            *j = 0;
+    }
+}
 
-                case DEPOT_SECTION:
-                    break;
 
-                default:
-                    print_warning ("unprocessed data section in file.\n");
+// Create model from TSPLIB (.tsp, .atsp) or CVRPLIB (.vrp) file content
+static vrp_t *vrp_new_from_tsplib (const char *filename,
+                                   s_scanner_t scanner,
+                                   bool is_cvrp,
+                                   size_t num_vehicles) {
+    s_edge_weight_type_t edge_weight_type = EWT_NONE;
+    s_edge_weight_format_t edge_weight_format = EWF_NONE;
+    size_t num_nodes = 0;
+    double capacity = DOUBLE_MAX;
+    double *demands = NULL;
+    size_t depot_id = 0;
+    bool has_coords = false;
+
+    vrp_t *self = NULL;
+    const char *error = NULL;
+    const char *word;
+    size_t len;
+    double value;
+
+    while (error == NULL && (len = s_scanner_read_word (&scanner, &word)) > 0) {
+
+        // Specification part: "KEYWORD : value"
+        s_scanner_skip_blank (&scanner);
+        if (scanner.cursor < scanner.end && *scanner.cursor == ':') {
+            scanner.cursor++;
+            if (s_word_is (word, len, "DIMENSION")) {
+                if (s_scanner_read_number (&scanner, &value) && value >= 1)
+                    num_nodes = (size_t) value;
+                else
+                    error = "invalid DIMENSION";
             }
-        }
-    } // end of while
-
-    fclose (vrpfile);
-
-    // No error while reading file
-    if (error_flag == 0) {
-        // compute cost as Euclidian distance
-        if (edge_weight_type == EUC_2D) {
-            for (ind1 = 0; ind1 < num_nodes; ind1++) {
-                matrixd_set (costs, ind1, ind1, 0);
-                for (ind2 = ind1 + 1; ind2 < num_nodes; ind2++) {
-                    // @note: rounding the distance by
-                    // nint(sqrt(xd*xd+yd*yd)). see TSPLIB spec.
-                    // for nint see
-                    // https://www.iwr.uni-heidelberg.de/groups/comopt/software/TSPLIB95/TSPFAQ.html
-                    value_i = (int)(
-                      coord2d_distance (&coords[ind1], &coords[ind2],
-                                        CS_CARTESIAN2D)
-                      + 0.5);
-                    matrixd_set (costs, ind1, ind2, (double) value_i);
-                    matrixd_set (costs, ind2, ind1, (double) value_i);
-                }
+            else if (s_word_is (word, len, "CAPACITY")) {
+                if (!s_scanner_read_number (&scanner, &capacity))
+                    error = "invalid CAPACITY";
+            }
+            else if (s_word_is (word, len, "VEHICLES")) {
+                if (s_scanner_read_number (&scanner, &value) && value >= 1)
+                    num_vehicles = (size_t) value;
+                else
+                    error = "invalid VEHICLES";
             }
+            else if (s_word_is (word, len, "EDGE_WEIGHT_TYPE")) {
+                len = s_scanner_read_word (&scanner, &word);
+                if (s_word_is (word, len, "EUC_2D"))
+                    edge_weight_type = EWT_EUC_2D;
+                else if (s_word_is (word, len, "CEIL_2D"))
+                    edge_weight_type = EWT_CEIL_2D;
+                else if (s_word_is (word, len, "ATT"))
+                    edge_weight_type = EWT_ATT;
+                else if (s_word_is (word, len, "GEO"))
+                    edge_weight_type = EWT_GEO;
+                else if (s_word_is (word, len, "EXPLICIT"))
+                    edge_weight_type = EWT_EXPLICIT;
+                else
+                    error = "unsupported EDGE_WEIGHT_TYPE";
+            }
+            else if (s_word_is (word, len, "EDGE_WEIGHT_FORMAT")) {
+                len = s_scanner_read_word (&scanner, &word);
+                if (s_word_is (word, len, "FULL_MATRIX"))
+                    edge_weight_format = EWF_FULL_MATRIX;
+                else if (s_word_is (word, len, "LOWER_ROW") ||
+                         s_word_is (word, len, "LOWROW"))
+                    edge_weight_format = EWF_LOWER_ROW;
+                else if (s_word_is (word, len, "LOWER_DIAG_ROW"))
+                    edge_weight_format = EWF_LOWER_DIAG_ROW;
+                else if (s_word_is (word, len, "UPPER_ROW"))
+                    edge_weight_format = EWF_UPPER_ROW;
+                else if (s_word_is (word, len, "UPPER_DIAG_ROW"))
+                    edge_weight_format = EWF_UPPER_DIAG_ROW;
+                else
+                    error = "unsupported EDGE_WEIGHT_FORMAT";
+            }
+            // NAME, TYPE, COMMENT, ... are ignored
+            s_scanner_skip_line (&scanner);
+            continue;
         }
 
-        // create model
-        self = vrp_new ();
-        char ext_id[UUID_STR_LEN];
-        size_t depot_id, node_id;
-
-        if (edge_weight_type == EUC_2D && coords != NULL)
-            vrp_set_coord_sys (self, CS_CARTESIAN2D);
+        if (s_word_is (word, len, "EOF"))
+            break;
 
-        // Add nodes, arc distances, and requests
-        for (size_t cnt = 0; cnt < num_nodes; cnt++) {
-            sprintf (ext_id, "node-%04zu", cnt + 1);
-            node_id = vrp_add_node (self, ext_id);
-            if (coords != NULL)
-                vrp_set_node_coord (self, node_id, coords[cnt]);
+        // Data part. Model is created at the first section.
+        if (self == NULL) {
+            if (num_nodes == 0 || edge_weight_type == EWT_NONE) {
+                error = "DIMENSION or EDGE_WEIGHT_TYPE is missing";
+                break;
+            }
+            if (edge_weight_type == EWT_EXPLICIT && edge_weight_format == EWF_NONE) {
+                error = "EDGE_WEIGHT_FORMAT is missing";
+                break;
+            }
 
-            if (demands != NULL) { // CVRP
-                if (cnt == 0) // depot
-                    depot_id = node_id;
-                else // add request: depot->customer
-                    vrp_add_request (self, ext_id, depot_id, node_id, demands[cnt]);
+            self = vrp_new ();
+            // All formats except full matrix are symmetric
+            vrp_set_arc_storage (self, false,
+                                 edge_weight_format != EWF_FULL_MATRIX);
+            // Distances computed from coordinates are integers
+            vrp_set_integer_distances (self, edge_weight_type != EWT_EXPLICIT);
+            vrp_create_distances (self, max2 (num_nodes, 2));
+
+            char ext_id[UUID_STR_LEN];
+            for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+                sprintf (ext_id, "node-%04zu", cnt + 1);
+                vrp_add_node (self, ext_id);
+                arcmatrix_set (self->distances, cnt, cnt, 0);
             }
-            else // TSP
-                vrp_add_request (self, ext_id, ID_NONE, node_id, 0);
+        }
 
-            for (size_t cnt1 = 0; cnt1 <= cnt; cnt1++) {
-                if (cnt1 == cnt)
-                    vrp_set_arc_distance (self, cnt1, cnt, 0);
+        if (s_word_is (word, len, "NODE_COORD_SECTION")) {
+            // lines: "index x y"
+            while (error == NULL && s_scanner_has_number (&scanner)) {
+                double index, x, y;
+                if (!s_scanner_read_number (&scanner, &index) ||
+                    !s_scanner_read_number (&scanner, &x) ||
+                    !s_scanner_read_number (&scanner, &y) ||
+                    index < 1 || index > num_nodes) {
+                    error = "invalid NODE_COORD_SECTION";
+                    break;
+                }
+                coord2d_t *coord = vrp_coord (self, (size_t) index - 1);
+                if (edge_weight_type == EWT_GEO) {
+                    coord->v1 = s_tsplib_geo_degrees (x);
+                    coord->v2 = s_tsplib_geo_degrees (y);
+                }
                 else {
-                    vrp_set_arc_distance (self, cnt1, cnt,
-                                          matrixd_get (costs, cnt1, cnt));
-                    vrp_set_arc_distance (self, cnt, cnt1,
-                                          matrixd_get (costs, cnt, cnt1));
+                    coord->v1 = x;
+                    coord->v2 = y;
                 }
             }
+            has_coords = true;
         }
 
-        // Add vehicles
-        if (demands != NULL) { // CVRP
-            for (size_t cnt = 0; cnt < num_vehicles; cnt++) {
-                sprintf (ext_id, "vehicle-%04zu", cnt + 1);
-                vrp_add_vehicle (self, ext_id, capacity, depot_id, depot_id);
+        else if (s_word_is (word, len, "DEMAND_SECTION")) {
+            // lines: "index demand"
+            if (demands == NULL) {
+                demands = (double *) calloc (num_nodes, sizeof (double));
+                assert (demands);
+            }
+            while (error == NULL && s_scanner_has_number (&scanner)) {
+                double index;
+                if (!s_scanner_read_number (&scanner, &index) ||
+                    !s_scanner_read_number (&scanner, &value) ||
+                    index < 1 || index > num_nodes)
+                    error = "invalid DEMAND_SECTION";
+                else
+                    demands[(size_t) index - 1] = value;
+            }
+        }
+
+        else if (s_word_is (word, len, "DEPOT_SECTION")) {
+            // depot indices terminated by -1. Only the first depot is used.
+            bool first = true;
+            while (s_scanner_read_number (&scanner, &value) && value >= 0) {
+                if (first && value >= 1 && value <= num_nodes)
+                    depot_id = (size_t) value - 1;
+                first = false;
+            }
+        }
+
+        else if (s_word_is (word, len, "EDGE_WEIGHT_SECTION")) {
+            if (edge_weight_type != EWT_EXPLICIT) {
+                error = "EDGE_WEIGHT_SECTION for non-explicit weights";
+                break;
+            }
+            size_t i, j;
+            s_first_edge_weight_position (edge_weight_format, &i, &j);
+            bool more = (num_nodes > 1 || edge_weight_format == EWF_FULL_MATRIX ||
+                         edge_weight_format == EWF_LOWER_DIAG_ROW ||
+                         edge_weight_format == EWF_UPPER_DIAG_ROW);
+            while (more) {
+                if (!s_scanner_read_number (&scanner, &value)) {
+                    error = "EDGE_WEIGHT_SECTION is incomplete";
+                    break;
+                }
+                // Diagonal is always 0
+                arcmatrix_set (self->distances, i, j, (i == j) ? 0 : value);
+                more = s_next_edge_weight_position (edge_weight_format,
+                                                    num_nodes, &i, &j);
             }
         }
+
         else {
-            sprintf (ext_id, "vehicle-%04d", 1);
-            vrp_add_vehicle (self, ext_id, DOUBLE_MAX, ID_NONE, ID_NONE);
+            // Unsupported section (e.g. DISPLAY_DATA_SECTION): skip its data
+            while (s_scanner_has_number (&scanner))
+                s_scanner_skip_line (&scanner);
         }
     }
 
-    if (demands != NULL)
+    if (error == NULL && self == NULL)
+        error = "no data section";
+    if (error == NULL && edge_weight_type != EWT_EXPLICIT && !has_coords)
+        error = "NODE_COORD_SECTION is missing";
+    if (error != NULL) {
+        print_error ("Invalid VRP file %s: %s.\n", filename, error);
         free (demands);
-    if (costs != NULL)
-        matrixd_free (&costs);
-    if (coords != NULL)
-        free (coords);
+        vrp_free (&self);
+        return NULL;
+    }
+
+    // Compute distances from coordinates. Storage is symmetric, so each pair
+    // is computed once.
+    if (edge_weight_type != EWT_EXPLICIT) {
+        if (edge_weight_type != EWT_GEO)
+            vrp_set_coord_sys (self, CS_CARTESIAN2D);
+        else
+            vrp_set_coord_sys (self, CS_WGS84);
+
+        for (size_t i = 1; i < num_nodes; i++) {
+            const coord2d_t *ci = vrp_coord (self, i);
+            for (size_t j = 0; j < i; j++)
+                arcmatrix_set (self->distances, i, j,
+                               s_tsplib_distance (edge_weight_type, ci,
+                                                  vrp_coord (self, j)));
+        }
+    }
+    vrp_recount_roadgraph (self);
+
+    // Add requests and vehicles
+    char ext_id[UUID_STR_LEN];
+    if (is_cvrp && demands != NULL) {
+        for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+            if (cnt != depot_id)
+                vrp_add_request (self, vrp_node (self, cnt)->ext_id,
+                                 depot_id, cnt, demands[cnt]);
+        }
+        for (size_t cnt = 0; cnt < num_vehicles; cnt++) {
+            sprintf (ext_id, "vehicle-%04zu", cnt + 1);
+            vrp_add_vehicle (self, ext_id, capacity, depot_id, depot_id);
+        }
+    }
+    else { // TSP
+        for (size_t cnt = 0; cnt < num_nodes; cnt++)
+            vrp_add_request (self, vrp_node (self, cnt)->ext_id,
+                             ID_NONE, cnt, 0);
+        sprintf (ext_id, "vehicle-%04d", 1);
+        vrp_add_vehicle (self, ext_id, DOUBLE_MAX, ID_NONE, ID_NONE);
+    }
 
+    free (demands);
     print_info ("vrp created from file.\n");
     return self;
 }
 
 
-// ---------------------------------------------------------------------------
-// Roadgraph
-// ---------------------------------------------------------------------------
-
-
-// Get node by id
-static s_node_t *vrp_node (const vrp_t *self, size_t node_id) {
-    s_node_t *node = (s_node_t *) arrayset_data (self->nodes, node_id);
-    return node;
+// Check if content is in Solomon / Homberger VRPTW format:
+// name line followed by "VEHICLE" section
+static bool s_is_solomon (s_scanner_t scanner) {
+    const char *word;
+    size_t len = s_scanner_read_word (&scanner, &word);
+    if (len == 0)
+        return false;
+    s_scanner_skip_line (&scanner);
+    len = s_scanner_read_word (&scanner, &word);
+    return s_word_is (word, len, "VEHICLE");
 }
 
 
-void vrp_set_coord_sys (vrp_t *self, coord2d_sys_t coord_sys) {
-    assert (self);
-    assert (self->coord_sys == CS_NONE); // only set once
-    self->coord_sys = coord_sys;
-}
+// Create VRPTW model from Solomon / Homberger file content:
+//
+// R101
+//
+// VEHICLE
+// NUMBER     CAPACITY
+//   25         200
+//
+// CUSTOMER
+// CUST NO.  XCOORD.   YCOORD.    DEMAND   READY TIME  DUE DATE   SERVICE TIME
+//     0      35         35          0          0        230          0
+//     1      41         49         10        161        171         10
+//
+// Customer 0 is depot. Each customer gets a request from depot, with time
+// windows and service durations of depot and customer. Distances are beeline
+// distances, and durations are distances at unit speed.
+static vrp_t *vrp_new_from_solomon (const char *filename, s_scanner_t scanner) {
+    const char *word;
+    size_t len;
+    double num_vehicles = 0, capacity = 0;
 
+    // Fleet
+    s_scanner_skip_line (&scanner); // name
+    len = s_scanner_read_word (&scanner, &word); // VEHICLE
+    s_scanner_skip_line (&scanner);
+    s_scanner_skip_space (&scanner);
+    s_scanner_skip_line (&scanner); // NUMBER CAPACITY
+    if (!s_scanner_read_number (&scanner, &num_vehicles) ||
+        !s_scanner_read_number (&scanner, &capacity) ||
+        num_vehicles < 1 || capacity <= 0) {
+        print_error ("Invalid VRPTW file %s: invalid fleet.\n", filename);
+        return NULL;
+    }
 
-size_t vrp_add_node (vrp_t *self, const char *ext_id) {
-    assert (self);
+    // Customers
+    len = s_scanner_read_word (&scanner, &word);
+    if (!s_word_is (word, len, "CUSTOMER")) {
+        print_error ("Invalid VRPTW file %s: CUSTOMER is missing.\n", filename);
+        return NULL;
+    }
+    s_scanner_skip_line (&scanner);
+    s_scanner_skip_space (&scanner);
+    s_scanner_skip_line (&scanner); // column names
 
-    s_node_t *node = s_node_new (ext_id);
-    size_t id = arrayset_add (self->nodes, node, node->ext_id);
+    vrp_t *self = vrp_new ();
+    vrp_set_coord_sys (self, CS_CARTESIAN2D);
+    vrp_set_arc_storage (self, false, true);
+
+    char ext_id[UUID_STR_LEN];
+    size_t depot_id = ID_NONE;
+    double depot_tw[2] = {0, 0}, depot_service = 0;
+    double row[7]; // no, x, y, demand, ready time, due date, service time
+
+    while (s_scanner_has_number (&scanner)) {
+        for (size_t col = 0; col < 7; col++) {
+            if (!s_scanner_read_number (&scanner, &row[col]) ||
+                row[col] < 0) {
+                print_error ("Invalid VRPTW file %s: invalid customer.\n",
+                             filename);
+                vrp_free (&self);
+                return NULL;
+            }
+        }
+
+        sprintf (ext_id, "node-%04zu", (size_t) row[0]);
+        size_t node_id = vrp_add_node (self, ext_id);
+        if (node_id == ID_NONE) {
+            vrp_free (&self);
+            return NULL;
+        }
+        *vrp_coord (self, node_id) = (coord2d_t) {row[1], row[2]};
+
+        if (depot_id == ID_NONE) { // first one is depot
+            depot_id = node_id;
+            depot_tw[0] = row[4];
+            depot_tw[1] = row[5];
+            depot_service = row[6];
+            continue;
+        }
+
+        size_t request_id =
+            vrp_add_request (self, ext_id, depot_id, node_id, row[3]);
+        vrp_add_time_window (self, request_id, NR_SENDER,
+                             (size_t) depot_tw[0], (size_t) depot_tw[1]);
+        vrp_add_time_window (self, request_id, NR_RECEIVER,
+                             (size_t) row[4], (size_t) row[5]);
+        vrp_set_service_duration (self, request_id, NR_SENDER,
+                                  (size_t) depot_service);
+        vrp_set_service_duration (self, request_id, NR_RECEIVER,
+                                  (size_t) row[6]);
+    }
+
+    if (depot_id == ID_NONE) {
+        print_error ("Invalid VRPTW file %s: no customer.\n", filename);
+        vrp_free (&self);
+        return NULL;
+    }
+
+    // Distances and durations in one pass, each pair computed once
+    size_t num_nodes = vrp_num_nodes (self);
+    vrp_create_distances (self, max2 (num_nodes, 2));
+    vrp_create_durations (self, max2 (num_nodes, 2));
+    for (size_t i = 0; i < num_nodes; i++) {
+        const coord2d_t *ci = vrp_coord (self, i);
+        for (size_t j = 0; j <= i; j++) {
+            double dist = (i == j) ? 0 :
+                          coord2d_distance (ci, vrp_coord (self, j),
+                                            CS_CARTESIAN2D);
+            arcmatrix_set (self->distances, i, j, dist);
+            arcmatrix_set (self->durations, i, j, (double) (size_t) dist);
+        }
+    }
+    vrp_recount_roadgraph (self);
+
+    for (size_t cnt = 0; cnt < (size_t) num_vehicles; cnt++) {
+        sprintf (ext_id, "vehicle-%04zu", cnt + 1);
+        vrp_add_vehicle (self, ext_id, capacity, depot_id, depot_id);
+    }
+
+    print_info ("vrp created from file.\n");
+    return self;
+}
+
+
+vrp_t *vrp_new_from_file (const char *filename) {
+    assert (filename);
+
+    // Map file
+    int fd = open (filename, O_RDONLY);
+    if (fd < 0) {
+        print_error ("Open VRP file %s failed.\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat (fd, &st) == 0 && st.st_size > 0)
+        map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        print_error ("Map VRP file %s failed.\n", filename);
+        return NULL;
+    }
+
+    s_scanner_t scanner = {(const char *) map, (const char *) map + st.st_size};
+    vrp_t *self = NULL;
+
+    // Recognize file format and try to read vehicle number K from filename
+    const char *p = strrchr (filename, '.');
+    // VRP
+    if (p != NULL && (strcmp (p + 1, "vrp") == 0 || strcmp (p + 1, "VRP") == 0)) {
+        size_t num_vehicles = 1;
+        // try to get K from filename
+        p = strrchr (filename, 'k');
+        if (p == NULL)
+            p = strrchr (filename, 'K');
+        if (p != NULL)
+            num_vehicles = (size_t) strtol (p + 1, NULL, 10);
+        else
+            print_warning ("No vehicle number specified in filename.\n");
+        self = vrp_new_from_tsplib (filename, scanner, true, num_vehicles);
+    }
+    // TSP
+    else if (p != NULL &&
+             (strcmp (p + 1, "tsp") == 0 ||
+              strcmp (p + 1, "TSP") == 0 ||
+              strcmp (p + 1, "atsp") == 0 ||
+              strcmp (p + 1, "ATSP") == 0))
+        self = vrp_new_from_tsplib (filename, scanner, false, 1);
+    // VRPTW
+    else if (s_is_solomon (scanner))
+        self = vrp_new_from_solomon (filename, scanner);
+    else
+        print_error ("Unsupported input file.\n");
+
+    munmap (map, (size_t) st.st_size);
+    return self;
+}
+
+
+// ---------------------------------------------------------------------------
+// Roadgraph
+// ---------------------------------------------------------------------------
+
+
+// Get node by id
+static s_node_t *vrp_node (const vrp_t *self, size_t node_id) {
+    s_node_t *node = (s_node_t *) arrayset_data (self->nodes, node_id);
+    return node;
+}
+
+
+void vrp_set_coord_sys (vrp_t *self, coord2d_sys_t coord_sys) {
+    assert (self);
+    assert (self->coord_sys == CS_NONE); // only set once
+    self->coord_sys = coord_sys;
+}
+
+
+// Matrix row (and column) of node in arc matrices
+static inline size_t vrp_arc_row (const vrp_t *self, size_t node_id) {
+    if (self->arc_rows == NULL)
+        return node_id;
+    assert (node_id < self->arc_rows_size);
+    return self->arc_rows[node_id];
+}
+
+
+// Assign next matrix row to new node if nodes are renumbered
+static void vrp_add_arc_row (vrp_t *self, size_t node_id) {
+    if (self->arc_rows == NULL)
+        return;
+    if (node_id >= self->arc_rows_size) {
+        size_t size = max2 (node_id + 1, self->arc_rows_size * 2);
+        self->arc_rows =
+            (size_t *) realloc (self->arc_rows, size * sizeof (size_t));
+        assert (self->arc_rows);
+        for (size_t idx = self->arc_rows_size; idx < size; idx++)
+            self->arc_rows[idx] = SIZE_NONE;
+        self->arc_rows_size = size;
+    }
+    self->arc_rows[node_id] = self->num_arc_rows++;
+}
+
+
+// Add arc of matrix rows (row, col) to counters if it is set
+static void vrp_count_arc (vrp_t *self, size_t row, size_t col) {
+    if (self->distances != NULL && arcmatrix_is_set (self->distances, row, col))
+        self->num_distances_set++;
+    if (self->durations != NULL && arcmatrix_is_set (self->durations, row, col))
+        self->num_durations_set++;
+    if (self->td_durations != NULL &&
+        tdarcs_is_set (self->td_durations, row, col))
+        self->num_td_durations_set++;
+}
+
+
+// Add set arcs between node and itself or other nodes to counters, in
+// O(num_others)
+static void vrp_count_node_arcs (vrp_t *self,
+                                 size_t node_id,
+                                 const size_t *other_ids,
+                                 size_t num_others) {
+    if (self->distances == NULL && self->durations == NULL &&
+        self->td_durations == NULL)
+        return;
+    size_t row = vrp_arc_row (self, node_id);
+    vrp_count_arc (self, row, row);
+    for (size_t k = 0; k < num_others; k++) {
+        size_t col = vrp_arc_row (self, other_ids[k]);
+        if (col == row)
+            continue;
+        vrp_count_arc (self, row, col);
+        vrp_count_arc (self, col, row);
+    }
+}
+
+
+// Number of arcs between nodes which become set by setting cell of matrix
+// for arc (from_node_id, to_node_id) which is not set yet
+static size_t vrp_num_new_arcs (vrp_t *self,
+                                const arcmatrix_t *matrix,
+                                size_t from_node_id,
+                                size_t to_node_id) {
+    if (vrp_node (self, from_node_id) == NULL ||
+        vrp_node (self, to_node_id) == NULL)
+        return 0; // counted when node is added
+    return (arcmatrix_is_symmetric (matrix) && from_node_id != to_node_id) ?
+           2 : 1;
+}
+
+
+// Recount counters of roadgraph after bulk changes, in O(n^2)
+static void vrp_recount_roadgraph (vrp_t *self) {
+    self->num_nodes_without_coord = 0;
+    self->num_distances_set = 0;
+    self->num_durations_set = 0;
+    self->num_td_durations_set = 0;
+    self->roadgraph_counts_stale = false;
+
+    size_t num_nodes = listu_size (self->node_ids);
+    const size_t *node_ids = listu_array (self->node_ids);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        if (coord2d_is_none (vrp_coord (self, node_ids[cnt])))
+            self->num_nodes_without_coord++;
+        vrp_count_node_arcs (self, node_ids[cnt], node_ids, cnt);
+    }
+}
+
+
+size_t vrp_add_node (vrp_t *self, const char *ext_id) {
+    assert (self);
+
+    s_node_t *node = s_node_new (self->arena, ext_id);
+    size_t id =
+        s_add_indexed (self->nodes, self->node_index, node, node->ext_id);
 
     if (id == ID_NONE) {
         print_error ("Node with external ID %s already exists.\n", ext_id);
@@ -676,16 +1635,193 @@ size_t vrp_add_node (vrp_t *self, const char *ext_id) {
 
     node->id = id;
     assert (!listu_includes (self->node_ids, id));
+    vrp_reserve_node_fields (self, id);
+    vrp_add_arc_row (self, id);
+    vrp_count_node_arcs (self, id,
+                         listu_array (self->node_ids),
+                         listu_size (self->node_ids));
+    self->num_nodes_without_coord++;
     listu_insert_sorted (self->node_ids, id);
     return id;
 }
 
 
+size_t vrp_add_nodes (vrp_t *self,
+                      const char **ext_ids,
+                      const coord2d_t *coords,
+                      size_t num_nodes,
+                      size_t *node_ids) {
+    assert (self);
+    assert (ext_ids);
+
+    size_t *new_ids = (size_t *) malloc ((num_nodes + 1) * sizeof (size_t));
+    assert (new_ids);
+    size_t num_added = 0;
+
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        s_node_t *node = s_node_new (self->arena, ext_ids[cnt]);
+        size_t id =
+            s_add_indexed (self->nodes, self->node_index, node, node->ext_id);
+        if (id == ID_NONE) {
+            print_error ("Node with external ID %s already exists.\n",
+                         ext_ids[cnt]);
+            s_node_free (&node);
+        }
+        else {
+            node->id = id;
+            vrp_reserve_node_fields (self, id);
+            if (coords != NULL)
+                self->node_coords[id] = coords[cnt];
+            if (coord2d_is_none (&self->node_coords[id]))
+                self->num_nodes_without_coord++;
+            else if (self->spatial_index != NULL)
+                spatialindex_insert (self->spatial_index, id,
+                                     &self->node_coords[id]);
+            vrp_add_arc_row (self, id);
+            vrp_count_node_arcs (self, id,
+                                 listu_array (self->node_ids),
+                                 listu_size (self->node_ids));
+            vrp_count_node_arcs (self, id, new_ids, num_added);
+            new_ids[num_added++] = id;
+        }
+        if (node_ids != NULL)
+            node_ids[cnt] = id;
+    }
+
+    s_merge_sorted_ids (self->node_ids, new_ids, num_added);
+    free (new_ids);
+    return num_added;
+}
+
+
 void vrp_set_node_coord (vrp_t *self, size_t node_id, coord2d_t coord) {
+    assert (self);
+    assert (vrp_node (self, node_id) != NULL);
+    coord2d_t *node_coord = vrp_coord (self, node_id);
+    if (coord2d_is_none (node_coord))
+        self->num_nodes_without_coord--;
+    node_coord->v1 = coord.v1;
+    node_coord->v2 = coord.v2;
+    if (coord2d_is_none (node_coord))
+        self->num_nodes_without_coord++;
+    if (self->spatial_index != NULL) {
+        spatialindex_remove (self->spatial_index, node_id);
+        if (!coord2d_is_none (node_coord))
+            spatialindex_insert (self->spatial_index, node_id, node_coord);
+    }
+    if (self->distance_cache != NULL)
+        rowcache_clear (self->distance_cache);
+}
+
+
+void vrp_set_node_vertex (vrp_t *self, size_t node_id, size_t vertex) {
     assert (self);
     s_node_t *node = vrp_node (self, node_id);
-    node->coord.v1 = coord.v1;
-    node->coord.v2 = coord.v2;
+    assert (node);
+    node->vertex = vertex;
+}
+
+
+void vrp_set_road_network (vrp_t *self,
+                           size_t num_vertices,
+                           const size_t *tails,
+                           const size_t *heads,
+                           const double *lengths,
+                           const double *travel_times,
+                           size_t num_edges) {
+    assert (self);
+    roadnet_free (&self->road_network);
+    self->road_network = roadnet_new (num_vertices, tails, heads,
+                                      lengths, travel_times, num_edges);
+}
+
+
+void vrp_set_arc_storage (vrp_t *self, bool compact, bool symmetric) {
+    assert (self);
+    // Storage could not be changed once arcs are set
+    assert (self->distances == NULL);
+    assert (self->durations == NULL);
+    self->compact_arcs = compact;
+    self->symmetric_arcs = symmetric;
+}
+
+
+void vrp_set_integer_distances (vrp_t *self, bool integer) {
+    assert (self);
+    assert (self->distances == NULL);
+    self->integer_distances = integer;
+}
+
+
+void vrp_set_on_demand_distances (vrp_t *self, size_t cache_rows) {
+    assert (self);
+    assert (self->distances == NULL);
+    self->on_demand_distances = true;
+    rowcache_free (&self->distance_cache);
+    if (cache_rows > 0)
+        self->distance_cache = rowcache_new (cache_rows);
+}
+
+
+void vrp_set_sparse_arcs (vrp_t *self, double detour_factor, size_t cache_rows) {
+    assert (self);
+    assert (detour_factor >= 1);
+    assert (self->distances == NULL);
+    assert (self->durations == NULL);
+    vrp_set_on_demand_distances (self, cache_rows);
+    self->detour_factor = detour_factor;
+    if (self->sparse_arcs == NULL)
+        self->sparse_arcs = sparsearcs_new ();
+}
+
+
+// Check if arc distances are defined, by matrix or on demand (sparse arcs
+// fall back to on demand)
+static bool vrp_arc_distances_defined (const vrp_t *self) {
+    return self->distances != NULL || self->on_demand_distances;
+}
+
+
+// Check if arc durations are defined, by matrix (time-dependent or not) or on
+// demand
+static bool vrp_arc_durations_defined (const vrp_t *self) {
+    return self->durations != NULL || self->td_durations != NULL ||
+           (self->distances == NULL && self->duration_speed > 0);
+}
+
+
+bool vrp_integer_distances (const vrp_t *self) {
+    assert (self);
+    return self->integer_distances;
+}
+
+
+// Order of arc matrices to hold all nodes
+static size_t vrp_arc_matrix_order (vrp_t *self) {
+    if (self->arc_rows != NULL)
+        return max2 (self->num_arc_rows, 2);
+    size_t num_nodes = listu_size (self->node_ids);
+    return (num_nodes > 0) ?
+           max2 (listu_get (self->node_ids, num_nodes - 1) + 1, 2) : 2;
+}
+
+
+// Create distance matrix in storage mode of model
+static void vrp_create_distances (vrp_t *self, size_t order) {
+    assert (self->distances == NULL);
+    arcmatrix_type_t type = self->integer_distances ? AM_INT32 :
+                            (self->compact_arcs ? AM_FLOAT32 : AM_FLOAT64);
+    self->distances = arcmatrix_new (type, self->symmetric_arcs, order);
+}
+
+
+// Create duration matrix in storage mode of model
+static void vrp_create_durations (vrp_t *self, size_t order) {
+    assert (self->durations == NULL);
+    self->durations =
+        arcmatrix_new (self->compact_arcs ? AM_UINT32 : AM_SIZE,
+                       self->symmetric_arcs,
+                       order);
 }
 
 
@@ -695,11 +1831,25 @@ void vrp_set_arc_distance (vrp_t *self,
                            double distance) {
     assert (self);
     assert (distance >= 0);
-    if (self->distances == NULL) {
-        size_t order = max3 (from_node_id + 1, to_node_id + 1, 2);
-        self->distances = matrixd_new (order, order);
+    // Set arcs override on-demand ones, as with sparse arcs
+    if (self->on_demand_distances && self->sparse_arcs == NULL)
+        self->sparse_arcs = sparsearcs_new ();
+    if (self->sparse_arcs != NULL) {
+        if (self->integer_distances)
+            distance = (double) (int) (distance + 0.5);
+        sparsearcs_set_distance (self->sparse_arcs,
+                                 from_node_id, to_node_id, distance);
+        return;
     }
-    matrixd_set (self->distances, from_node_id, to_node_id, distance);
+    size_t row = vrp_arc_row (self, from_node_id);
+    size_t col = vrp_arc_row (self, to_node_id);
+    if (self->distances == NULL)
+        vrp_create_distances (self, max3 (vrp_arc_matrix_order (self),
+                                          row + 1, col + 1));
+    if (!arcmatrix_is_set (self->distances, row, col))
+        self->num_distances_set +=
+            vrp_num_new_arcs (self, self->distances, from_node_id, to_node_id);
+    arcmatrix_set (self->distances, row, col, distance);
 }
 
 
@@ -709,128 +1859,944 @@ void vrp_set_arc_duration (vrp_t *self,
                            size_t duration) {
     assert (self);
     assert (duration >= 0);
-    if (self->durations == NULL) {
-        size_t order = max3 (from_node_id + 1, to_node_id + 1, 2);
-        self->durations = matrixu_new (order, order);
+    if (self->on_demand_distances && self->sparse_arcs == NULL)
+        self->sparse_arcs = sparsearcs_new ();
+    if (self->sparse_arcs != NULL) {
+        sparsearcs_set_duration (self->sparse_arcs,
+                                 from_node_id, to_node_id, duration);
+        return;
     }
-    matrixu_set (self->durations, from_node_id, to_node_id, duration);
+    size_t row = vrp_arc_row (self, from_node_id);
+    size_t col = vrp_arc_row (self, to_node_id);
+    if (self->durations == NULL)
+        vrp_create_durations (self, max3 (vrp_arc_matrix_order (self),
+                                          row + 1, col + 1));
+    if (!arcmatrix_is_set (self->durations, row, col))
+        self->num_durations_set +=
+            vrp_num_new_arcs (self, self->durations, from_node_id, to_node_id);
+    arcmatrix_set (self->durations, row, col, (double) duration);
+}
+
+
+void vrp_set_time_dependent_durations (vrp_t *self,
+                                       size_t num_slices,
+                                       size_t slice_duration) {
+    assert (self);
+    assert (self->td_durations == NULL);
+    self->td_durations = tdarcs_new (num_slices, slice_duration,
+                                     vrp_arc_matrix_order (self));
+    self->num_td_durations_set = 0;
+}
+
+
+void vrp_set_arc_durations_by_time (vrp_t *self,
+                                    size_t from_node_id,
+                                    size_t to_node_id,
+                                    const size_t *durations) {
+    assert (self);
+    assert (self->td_durations != NULL);
+    size_t row = vrp_arc_row (self, from_node_id);
+    size_t col = vrp_arc_row (self, to_node_id);
+    if (!tdarcs_is_set (self->td_durations, row, col) &&
+        vrp_node_exists (self, from_node_id) &&
+        vrp_node_exists (self, to_node_id))
+        self->num_td_durations_set++;
+    tdarcs_set (self->td_durations, row, col, durations);
+}
+
+
+// Check that matrix loaded from file fits model: arcs are not on demand,
+// matrix covers all nodes, and its storage mode agrees with the other
+// matrix if that is already set. Storage mode of model is then taken from
+// matrix.
+// Return true if matrix fits.
+static bool vrp_check_loaded_arcs (vrp_t *self,
+                                   const arcmatrix_t *matrix,
+                                   const arcmatrix_t *other,
+                                   const char *filename) {
+    if (self->on_demand_distances) {
+        print_error ("Matrix file %s could not be loaded into model with "
+                     "on-demand or sparse arcs.\n", filename);
+        return false;
+    }
+
+    size_t num_nodes = listu_size (self->node_ids);
+    if (num_nodes > 0 &&
+        arcmatrix_order (matrix) <
+        listu_get (self->node_ids, num_nodes - 1) + 1) {
+        print_error ("Matrix file %s does not cover all nodes.\n", filename);
+        return false;
+    }
+
+    // Compact mode could not be told from integer distances
+    arcmatrix_type_t type = arcmatrix_type (matrix);
+    bool symmetric = arcmatrix_is_symmetric (matrix);
+    bool compact = (type == AM_FLOAT32 || type == AM_UINT32);
+    bool compact_known = (type != AM_INT32);
+    if (other != NULL) {
+        arcmatrix_type_t other_type = arcmatrix_type (other);
+        bool other_compact =
+            (other_type == AM_FLOAT32 || other_type == AM_UINT32);
+        if (arcmatrix_is_symmetric (other) != symmetric ||
+            (compact_known && other_type != AM_INT32 &&
+             other_compact != compact)) {
+            print_error ("Storage mode of matrix file %s differs from "
+                         "model.\n", filename);
+            return false;
+        }
+    }
+
+    self->symmetric_arcs = symmetric;
+    if (compact_known)
+        self->compact_arcs = compact;
+    return true;
+}
+
+
+int vrp_load_arc_distances (vrp_t *self, const char *filename) {
+    assert (self);
+    assert (self->distances == NULL);
+    assert (self->arc_rows == NULL); // file rows are node IDs
+
+    arcmatrix_t *distances = arcmatrix_new_from_file (filename);
+    if (distances == NULL)
+        return -1;
+
+    arcmatrix_type_t type = arcmatrix_type (distances);
+    if (type != AM_FLOAT64 && type != AM_FLOAT32 && type != AM_INT32) {
+        print_error ("Matrix file %s does not hold distances.\n", filename);
+        arcmatrix_free (&distances);
+        return -1;
+    }
+    if (!vrp_check_loaded_arcs (self, distances, self->durations, filename)) {
+        arcmatrix_free (&distances);
+        return -1;
+    }
+
+    self->distances = distances;
+    self->integer_distances = (type == AM_INT32);
+    // Counting reads every page of the mapped file, so it is left to
+    // validation
+    self->roadgraph_counts_stale = true;
+    return 0;
+}
+
+
+int vrp_load_arc_durations (vrp_t *self, const char *filename) {
+    assert (self);
+    assert (self->durations == NULL);
+    assert (self->arc_rows == NULL); // file rows are node IDs
+
+    arcmatrix_t *durations = arcmatrix_new_from_file (filename);
+    if (durations == NULL)
+        return -1;
+
+    arcmatrix_type_t type = arcmatrix_type (durations);
+    if (type != AM_SIZE && type != AM_UINT32) {
+        print_error ("Matrix file %s does not hold durations.\n", filename);
+        arcmatrix_free (&durations);
+        return -1;
+    }
+    if (!vrp_check_loaded_arcs (self, durations, self->distances, filename)) {
+        arcmatrix_free (&durations);
+        return -1;
+    }
+
+    self->durations = durations;
+    self->roadgraph_counts_stale = true; // as for distances
+    return 0;
+}
+
+
+int vrp_save_arc_distances (const vrp_t *self, const char *filename) {
+    assert (self);
+    assert (self->distances != NULL);
+    assert (self->arc_rows == NULL);
+    return arcmatrix_save (self->distances, filename);
+}
+
+
+int vrp_save_arc_durations (const vrp_t *self, const char *filename) {
+    assert (self);
+    assert (self->durations != NULL);
+    assert (self->arc_rows == NULL);
+    return arcmatrix_save (self->durations, filename);
 }
 
 
 void vrp_generate_beeline_distances (vrp_t *self) {
     assert (self);
     assert (self->coord_sys != ID_NONE);
+    assert (self->sparse_arcs == NULL);
 
     size_t num_nodes = vrp_num_nodes (self);
     assert (num_nodes == listu_size (self->node_ids));
-    size_t cnt1, cnt2;
-    size_t id1, id2;
-    double dist;
-
-    for (cnt1 = 0; cnt1 < num_nodes; cnt1++) {
-        for (cnt2 = 0; cnt2 < num_nodes; cnt2++) {
-            id1 = listu_get (self->node_ids, cnt1);
-            id2 = listu_get (self->node_ids, cnt2);
-            if (cnt1 != cnt2)
-                dist = coord2d_distance (vrp_node_coord (self, id1),
-                                         vrp_node_coord (self, id2),
-                                         self->coord_sys);
-            else
-                dist = 0;
-            vrp_set_arc_distance (self, id1, id2, dist);
+    const size_t *node_ids = listu_array (self->node_ids);
+
+    // Allocate matrix once
+    if (self->distances == NULL)
+        vrp_create_distances (self, vrp_arc_matrix_order (self));
+    else
+        arcmatrix_reserve (self->distances, vrp_arc_matrix_order (self));
+
+    coord2d_t *coords =
+        (coord2d_t *) malloc ((num_nodes + 1) * sizeof (coord2d_t));
+    assert (coords);
+    size_t *rows = (size_t *) malloc ((num_nodes + 1) * sizeof (size_t));
+    assert (rows);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        coords[cnt] = *vrp_coord (self, node_ids[cnt]);
+        rows[cnt] = vrp_arc_row (self, node_ids[cnt]);
+    }
+
+    // Each pair of nodes is computed once, in parallel
+    beeline_fill_matrix (self->distances, coords, rows, num_nodes,
+                         self->coord_sys, 0);
+    free (rows);
+    free (coords);
+    vrp_recount_roadgraph (self);
+}
+
+
+void vrp_set_node_arcs (vrp_t *self,
+                        size_t node_id,
+                        const size_t *other_ids,
+                        const double *out_distances,
+                        const double *in_distances,
+                        size_t num_others) {
+    assert (self);
+    assert (vrp_node_exists (self, node_id));
+    assert (other_ids);
+    assert (out_distances);
+    if (in_distances == NULL)
+        in_distances = out_distances;
+
+    // Durations follow if they were generated from distances
+    bool with_durations =
+        self->durations != NULL && self->duration_speed > 0;
+
+    // Reserve once. Matrices grow geometrically, so appending nodes one by
+    // one keeps O(n) amortized cost per node.
+    size_t order = vrp_arc_matrix_order (self);
+    if (self->distances != NULL)
+        arcmatrix_reserve_geometric (self->distances, order);
+    if (with_durations)
+        arcmatrix_reserve_geometric (self->durations, order);
+
+    vrp_set_arc_distance (self, node_id, node_id, 0);
+    if (with_durations)
+        vrp_set_arc_duration (self, node_id, node_id, 0);
+
+    for (size_t k = 0; k < num_others; k++) {
+        size_t other_id = other_ids[k];
+        if (other_id == node_id)
+            continue;
+        vrp_set_arc_distance (self, node_id, other_id, out_distances[k]);
+        if (!self->symmetric_arcs || self->on_demand_distances)
+            vrp_set_arc_distance (self, other_id, node_id, in_distances[k]);
+        if (with_durations) {
+            vrp_set_arc_duration (
+                self, node_id, other_id,
+                (size_t) (out_distances[k] / self->duration_speed));
+            if (!self->symmetric_arcs)
+                vrp_set_arc_duration (
+                    self, other_id, node_id,
+                    (size_t) (in_distances[k] / self->duration_speed));
         }
     }
 }
 
 
-void vrp_generate_durations (vrp_t *self, double speed) {
+void vrp_generate_node_beeline_arcs (vrp_t *self, size_t node_id) {
+    assert (self);
+    assert (self->coord_sys != CS_NONE);
+
+    // On-demand and sparse distances follow coordinates already
+    if (self->distances == NULL)
+        return;
+
+    size_t num_nodes = listu_size (self->node_ids);
+    const size_t *node_ids = listu_array (self->node_ids);
+    const coord2d_t *coord = vrp_coord (self, node_id);
+    double *distances = (double *) malloc ((num_nodes + 1) * sizeof (double));
+    assert (distances);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++)
+        distances[cnt] = coord2d_distance (coord,
+                                           vrp_coord (self, node_ids[cnt]),
+                                           self->coord_sys);
+
+    vrp_set_node_arcs (self, node_id, node_ids, distances, NULL, num_nodes);
+    free (distances);
+}
+
+
+void vrp_generate_road_arcs (vrp_t *self) {
+    assert (self);
+    assert (self->road_network != NULL);
+    assert (self->sparse_arcs == NULL);
+
+    size_t num_nodes = vrp_num_nodes (self);
+    const size_t *node_ids = listu_array (self->node_ids);
+    bool has_times = roadnet_has_travel_times (self->road_network);
+
+    size_t order = vrp_arc_matrix_order (self);
+    if (self->distances == NULL)
+        vrp_create_distances (self, order);
+    else
+        arcmatrix_reserve (self->distances, order);
+    if (has_times) {
+        if (self->durations == NULL)
+            vrp_create_durations (self, order);
+        else
+            arcmatrix_reserve (self->durations, order);
+    }
+
+    size_t *vertices = (size_t *) malloc ((num_nodes + 1) * sizeof (size_t));
+    size_t *rows = (size_t *) malloc ((num_nodes + 1) * sizeof (size_t));
+    assert (vertices && rows);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        vertices[cnt] = vrp_node (self, node_ids[cnt])->vertex;
+        assert (vertices[cnt] != ID_NONE);
+        rows[cnt] = vrp_arc_row (self, node_ids[cnt]);
+    }
+
+    // One search per node, in parallel
+    roadnet_fill_matrices (self->road_network,
+                           self->distances,
+                           has_times ? self->durations : NULL,
+                           vertices, rows, num_nodes, 0);
+    free (vertices);
+    free (rows);
+    vrp_recount_roadgraph (self);
+}
+
+
+void vrp_generate_durations (vrp_t *self, double speed) {
+    assert (self);
+    assert (speed > 0);
+    assert (vrp_arc_distances_defined (self));
+
+    // Durations follow on-demand (or sparse) distances
+    self->duration_speed = speed;
+    if (self->distances == NULL)
+        return;
+
+    size_t num_nodes = vrp_num_nodes (self);
+    const size_t *node_ids = listu_array (self->node_ids);
+
+    if (self->durations == NULL)
+        vrp_create_durations (self, vrp_arc_matrix_order (self));
+    else
+        arcmatrix_reserve (self->durations, vrp_arc_matrix_order (self));
+
+    size_t *rows = (size_t *) malloc ((num_nodes + 1) * sizeof (size_t));
+    assert (rows);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++)
+        rows[cnt] = vrp_arc_row (self, node_ids[cnt]);
+
+    // Same threaded row kernel as beeline distances. Arcs of unset
+    // distances are skipped.
+    beeline_fill_durations (self->durations, self->distances, rows,
+                            num_nodes, speed, 0);
+    free (rows);
+    vrp_recount_roadgraph (self);
+}
+
+
+// Index of cell (x, y) along Hilbert curve filling 2^16 x 2^16 grid
+static uint64_t s_hilbert_index (uint32_t x, uint32_t y) {
+    const uint32_t n = 1u << 16;
+    uint64_t index = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        index += (uint64_t) s * s * ((3 * rx) ^ ry);
+        // Rotate quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            uint32_t tmp = x;
+            x = y;
+            y = tmp;
+        }
+    }
+    return index;
+}
+
+
+typedef struct {
+    uint64_t key; // Hilbert index
+    size_t node_id;
+} s_curve_pos_t;
+
+
+static int s_curve_pos_compare (const void *a, const void *b) {
+    const s_curve_pos_t *pa = (const s_curve_pos_t *) a;
+    const s_curve_pos_t *pb = (const s_curve_pos_t *) b;
+    if (pa->key != pb->key)
+        return (pa->key < pb->key) ? -1 : 1;
+    return (pa->node_id < pb->node_id) ? -1 : (pa->node_id > pb->node_id);
+}
+
+
+// Grid cell of coordinate value in [min, min + range]
+static uint32_t s_grid_cell (double value, double min, double range) {
+    if (range <= 0)
+        return 0;
+    double cell = (value - min) / range * 65535.0;
+    return (uint32_t) (cell < 0 ? 0 : (cell > 65535.0 ? 65535.0 : cell));
+}
+
+
+// Copy of matrix with cell (old_rows[i], old_rows[j]) moved to
+// (new_rows[i], new_rows[j])
+static arcmatrix_t *vrp_permute_arc_matrix (const arcmatrix_t *matrix,
+                                            const size_t *old_rows,
+                                            const size_t *new_rows,
+                                            size_t num_rows,
+                                            size_t order) {
+    bool symmetric = arcmatrix_is_symmetric (matrix);
+    arcmatrix_t *permuted =
+        arcmatrix_new (arcmatrix_type (matrix), symmetric, order);
+    for (size_t i = 0; i < num_rows; i++) {
+        size_t end = symmetric ? i + 1 : num_rows;
+        for (size_t j = 0; j < end; j++) {
+            if (arcmatrix_is_set (matrix, old_rows[i], old_rows[j]))
+                arcmatrix_set (permuted, new_rows[i], new_rows[j],
+                               arcmatrix_get (matrix, old_rows[i], old_rows[j]));
+        }
+    }
+    return permuted;
+}
+
+
+void vrp_renumber_nodes_spatially (vrp_t *self) {
+    assert (self);
+    assert (self->coord_sys != CS_NONE);
+    assert (self->td_durations == NULL);
+
+    size_t num_nodes = listu_size (self->node_ids);
+    if (num_nodes == 0)
+        return;
+    const size_t *node_ids = listu_array (self->node_ids);
+
+    // Bounding box of coordinates
+    double min_v1 = DOUBLE_MAX, max_v1 = -DOUBLE_MAX;
+    double min_v2 = DOUBLE_MAX, max_v2 = -DOUBLE_MAX;
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        const coord2d_t *coord = vrp_coord (self, node_ids[cnt]);
+        assert (!coord2d_is_none (coord));
+        min_v1 = (coord->v1 < min_v1) ? coord->v1 : min_v1;
+        max_v1 = (coord->v1 > max_v1) ? coord->v1 : max_v1;
+        min_v2 = (coord->v2 < min_v2) ? coord->v2 : min_v2;
+        max_v2 = (coord->v2 > max_v2) ? coord->v2 : max_v2;
+    }
+
+    s_curve_pos_t *positions =
+        (s_curve_pos_t *) malloc (num_nodes * sizeof (s_curve_pos_t));
+    assert (positions);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        const coord2d_t *coord = vrp_coord (self, node_ids[cnt]);
+        positions[cnt].key =
+            s_hilbert_index (s_grid_cell (coord->v1, min_v1, max_v1 - min_v1),
+                             s_grid_cell (coord->v2, min_v2, max_v2 - min_v2));
+        positions[cnt].node_id = node_ids[cnt];
+    }
+    qsort (positions, num_nodes, sizeof (s_curve_pos_t), s_curve_pos_compare);
+
+    // New row of each node is its position along the curve
+    size_t arc_rows_size = node_ids[num_nodes - 1] + 1;
+    size_t *arc_rows = (size_t *) malloc (arc_rows_size * sizeof (size_t));
+    assert (arc_rows);
+    for (size_t idx = 0; idx < arc_rows_size; idx++)
+        arc_rows[idx] = SIZE_NONE;
+    for (size_t cnt = 0; cnt < num_nodes; cnt++)
+        arc_rows[positions[cnt].node_id] = cnt;
+    free (positions);
+
+    // Move existing arcs to new rows
+    size_t *old_rows = (size_t *) malloc (num_nodes * sizeof (size_t));
+    size_t *new_rows = (size_t *) malloc (num_nodes * sizeof (size_t));
+    assert (old_rows && new_rows);
+    for (size_t cnt = 0; cnt < num_nodes; cnt++) {
+        old_rows[cnt] = vrp_arc_row (self, node_ids[cnt]);
+        new_rows[cnt] = arc_rows[node_ids[cnt]];
+    }
+    size_t order = max2 (num_nodes, 2);
+    if (self->distances != NULL) {
+        arcmatrix_t *distances =
+            vrp_permute_arc_matrix (self->distances,
+                                    old_rows, new_rows, num_nodes, order);
+        arcmatrix_free (&self->distances);
+        self->distances = distances;
+    }
+    if (self->durations != NULL) {
+        arcmatrix_t *durations =
+            vrp_permute_arc_matrix (self->durations,
+                                    old_rows, new_rows, num_nodes, order);
+        arcmatrix_free (&self->durations);
+        self->durations = durations;
+    }
+    free (old_rows);
+    free (new_rows);
+
+    free (self->arc_rows);
+    self->arc_rows = arc_rows;
+    self->arc_rows_size = arc_rows_size;
+    self->num_arc_rows = num_nodes;
+}
+
+
+coord2d_sys_t vrp_coord_sys (vrp_t *self) {
+    assert (self);
+    return self->coord_sys;
+}
+
+
+size_t vrp_query_node (vrp_t *self, const char *node_ext_id) {
+    assert (self);
+    return strindex_query (self->node_index, node_ext_id);
+}
+
+
+size_t vrp_query_nodes (vrp_t *self,
+                        const char **node_ext_ids,
+                        size_t num_nodes,
+                        size_t *node_ids) {
+    assert (self);
+    return strindex_query_batch (self->node_index,
+                                 node_ext_ids, num_nodes, node_ids);
+}
+
+
+bool vrp_node_exists (vrp_t *self, size_t node_id) {
+    assert (self);
+    s_node_t *node = vrp_node (self, node_id);
+    return node != NULL;
+}
+
+
+const char *vrp_node_ext_id (const vrp_t *self, size_t node_id) {
+    assert (self);
+    s_node_t *node = vrp_node (self, node_id);
+    assert (node != NULL);
+    return node->ext_id;
+}
+
+
+const coord2d_t *vrp_node_coord (vrp_t *self, size_t node_id) {
+    assert (self);
+    assert (vrp_node (self, node_id) != NULL);
+    return vrp_coord (self, node_id);
+}
+
+
+// Spatial index of nodes with coordinates. Built on first use, then kept
+// up to date as nodes are added and coordinates set.
+static spatialindex_t *vrp_spatial_index (vrp_t *self) {
+    assert (self->coord_sys != CS_NONE);
+    if (self->spatial_index == NULL) {
+        self->spatial_index = spatialindex_new (self->coord_sys);
+        for (size_t idx = 0; idx < listu_size (self->node_ids); idx++) {
+            size_t id = listu_get (self->node_ids, idx);
+            if (!coord2d_is_none (vrp_coord (self, id)))
+                spatialindex_insert (self->spatial_index, id,
+                                     vrp_coord (self, id));
+        }
+    }
+    return self->spatial_index;
+}
+
+
+const listu_t *vrp_node_pending_request_ids (vrp_t *self, size_t node_id) {
+    assert (self);
+    s_node_t *node = vrp_node (self, node_id);
+    assert (node);
+    return node->pending_request_ids;
+}
+
+
+size_t vrp_num_nodes (vrp_t *self) {
+    assert (self);
+    return arrayset_size (self->nodes);
+}
+
+
+const listu_t *vrp_nodes (vrp_t *self) {
+    assert (self);
+    return self->node_ids;
+}
+
+
+// Distance computed from node coordinates, through cache if any
+static double vrp_on_demand_distance (const vrp_t *self,
+                                      size_t from_node_id, size_t to_node_id) {
+    if (from_node_id == to_node_id)
+        return 0;
+
+    if (self->distance_cache != NULL) {
+        double dist = rowcache_get (self->distance_cache,
+                                    from_node_id, to_node_id);
+        if (!double_is_none (dist))
+            return dist;
+    }
+
+    double dist = coord2d_distance (vrp_coord (self, from_node_id),
+                                    vrp_coord (self, to_node_id),
+                                    self->coord_sys) * self->detour_factor;
+    if (self->integer_distances)
+        dist = (double) (int) (dist + 0.5);
+
+    if (self->distance_cache != NULL)
+        rowcache_set (self->distance_cache, from_node_id, to_node_id, dist);
+    return dist;
+}
+
+
+double vrp_arc_distance (const vrp_t *self,
+                         size_t from_node_id, size_t to_node_id) {
+    assert (self);
+    if (self->distances != NULL)
+        return arcmatrix_get (self->distances,
+                              vrp_arc_row (self, from_node_id),
+                              vrp_arc_row (self, to_node_id));
+    if (self->sparse_arcs != NULL) {
+        double dist =
+            sparsearcs_distance (self->sparse_arcs, from_node_id, to_node_id);
+        if (!double_is_none (dist))
+            return dist;
+    }
+    assert (self->on_demand_distances);
+    return vrp_on_demand_distance (self, from_node_id, to_node_id);
+}
+
+
+size_t vrp_arc_duration (const vrp_t *self,
+                         size_t from_node_id, size_t to_node_id) {
+    assert (self);
+    if (self->td_durations != NULL)
+        return tdarcs_duration (self->td_durations,
+                                vrp_arc_row (self, from_node_id),
+                                vrp_arc_row (self, to_node_id),
+                                0);
+    if (self->durations != NULL)
+        return arcmatrix_get_size (self->durations,
+                                   vrp_arc_row (self, from_node_id),
+                                   vrp_arc_row (self, to_node_id));
+    if (self->sparse_arcs != NULL) {
+        size_t duration =
+            sparsearcs_duration (self->sparse_arcs, from_node_id, to_node_id);
+        if (duration != SIZE_NONE)
+            return duration;
+    }
+    assert (vrp_arc_durations_defined (self));
+    return (size_t) (vrp_arc_distance (self, from_node_id, to_node_id) /
+                     self->duration_speed);
+}
+
+
+size_t vrp_arc_duration_at (const vrp_t *self,
+                            size_t from_node_id,
+                            size_t to_node_id,
+                            size_t departure_time) {
+    assert (self);
+    if (self->td_durations == NULL)
+        return vrp_arc_duration (self, from_node_id, to_node_id);
+    return tdarcs_duration (self->td_durations,
+                            vrp_arc_row (self, from_node_id),
+                            vrp_arc_row (self, to_node_id),
+                            departure_time);
+}
+
+
+size_t vrp_arc_latest_departure (const vrp_t *self,
+                                 size_t from_node_id,
+                                 size_t to_node_id,
+                                 size_t arrival_time) {
+    assert (self);
+    if (self->td_durations == NULL)
+        return arrival_time - vrp_arc_duration (self, from_node_id, to_node_id);
+    return tdarcs_latest_departure (self->td_durations,
+                                    vrp_arc_row (self, from_node_id),
+                                    vrp_arc_row (self, to_node_id),
+                                    arrival_time);
+}
+
+
+size_t vrp_nearest_nodes (vrp_t *self,
+                          size_t node_id,
+                          size_t k,
+                          size_t *node_ids) {
+    assert (self);
+    assert (node_ids);
+    if (k == 0)
+        return 0;
+
+    // One more, as node itself is among nearest
+    size_t *ids = (size_t *) malloc ((k + 1) * sizeof (size_t));
+    assert (ids);
+    size_t num_ids = spatialindex_nearest (vrp_spatial_index (self),
+                                           vrp_node_coord (self, node_id),
+                                           k + 1, ids, NULL);
+    size_t num_found = 0;
+    for (size_t idx = 0; idx < num_ids && num_found < k; idx++) {
+        if (ids[idx] != node_id)
+            node_ids[num_found++] = ids[idx];
+    }
+    free (ids);
+    return num_found;
+}
+
+
+size_t vrp_nearest_nodes_to_coord (vrp_t *self,
+                                   coord2d_t coord,
+                                   size_t k,
+                                   size_t *node_ids,
+                                   double *distances) {
+    assert (self);
+    assert (node_ids);
+    return spatialindex_nearest (vrp_spatial_index (self), &coord, k,
+                                 node_ids, distances);
+}
+
+
+size_t vrp_nodes_within (vrp_t *self,
+                         coord2d_t coord,
+                         double radius,
+                         listu_t *node_ids) {
     assert (self);
-    assert (speed > 0);
-    assert (self->distances != NULL);
+    assert (node_ids);
+    return spatialindex_within (vrp_spatial_index (self), &coord, radius,
+                                node_ids);
+}
 
-    size_t num_nodes = vrp_num_nodes (self);
-    size_t cnt1, cnt2;
-    size_t id1, id2;
-    double dist;
-
-    for (cnt1 = 0; cnt1 < num_nodes; cnt1++) {
-        for (cnt2 = 0; cnt2 < num_nodes; cnt2++) {
-            id1 = listu_get (self->node_ids, cnt1);
-            id2 = listu_get (self->node_ids, cnt2);
-            dist = matrixd_get (self->distances, id1, id2);
-            vrp_set_arc_duration (self, id1, id2, (int)(dist / speed));
-        }
+
+static s_request_t *vrp_request (vrp_t *self, size_t request_id);
+
+
+// Record update of arc in change log
+static void vrp_log_arc_change (vrp_t *self,
+                                size_t from_node_id, size_t to_node_id) {
+    if (self->num_arc_changes == self->arc_changes_alloc_size) {
+        self->arc_changes_alloc_size =
+            max2 (64, self->arc_changes_alloc_size * 2);
+        self->arc_changes = (s_arc_change_t *)
+            realloc (self->arc_changes,
+                     self->arc_changes_alloc_size * sizeof (s_arc_change_t));
+        assert (self->arc_changes);
+    }
+
+    s_arc_change_t *change = &self->arc_changes[self->num_arc_changes];
+    change->from_node_id = from_node_id;
+    change->to_node_id = to_node_id;
+    change->seq = self->num_arc_changes++;
+    change->old_distance = DOUBLE_NONE;
+    if (self->distances != NULL) {
+        size_t row = vrp_arc_row (self, from_node_id);
+        size_t col = vrp_arc_row (self, to_node_id);
+        if (arcmatrix_is_set (self->distances, row, col))
+            change->old_distance = arcmatrix_get (self->distances, row, col);
     }
+    else if (vrp_arc_distances_defined (self))
+        change->old_distance =
+            vrp_arc_distance (self, from_node_id, to_node_id);
 }
 
 
-coord2d_sys_t vrp_coord_sys (vrp_t *self) {
+void vrp_update_arcs (vrp_t *self,
+                      const size_t *from_node_ids,
+                      const size_t *to_node_ids,
+                      const double *distances,
+                      const size_t *durations,
+                      size_t num_arcs) {
     assert (self);
-    return self->coord_sys;
+    assert (from_node_ids);
+    assert (to_node_ids);
+
+    // With symmetric storage an update changes both directions. Sparse arcs,
+    // also kept in on-demand mode, are directed.
+    bool both_directions =
+        self->symmetric_arcs && !self->on_demand_distances;
+
+    for (size_t k = 0; k < num_arcs; k++) {
+        size_t from_id = from_node_ids[k];
+        size_t to_id = to_node_ids[k];
+        vrp_log_arc_change (self, from_id, to_id);
+        if (both_directions && from_id != to_id)
+            vrp_log_arc_change (self, to_id, from_id);
+
+        if (distances != NULL)
+            vrp_set_arc_distance (self, from_id, to_id, distances[k]);
+        if (durations != NULL)
+            vrp_set_arc_duration (self, from_id, to_id, durations[k]);
+    }
 }
 
 
-size_t vrp_query_node (vrp_t *self, const char *node_ext_id) {
+size_t vrp_num_changed_arcs (const vrp_t *self) {
     assert (self);
-    return arrayset_query (self->nodes, node_ext_id);
+    return self->num_arc_changes;
 }
 
 
-bool vrp_node_exists (vrp_t *self, size_t node_id) {
+void vrp_clear_arc_changes (vrp_t *self) {
     assert (self);
-    s_node_t *node = vrp_node (self, node_id);
-    return node != NULL;
+    self->num_arc_changes = 0;
 }
 
 
-const char *vrp_node_ext_id (const vrp_t *self, size_t node_id) {
-    assert (self);
-    s_node_t *node = vrp_node (self, node_id);
-    assert (node != NULL);
-    return node->ext_id;
+// Order by arc, then by order of update
+static int s_arc_change_compare (const void *a, const void *b) {
+    const s_arc_change_t *ca = (const s_arc_change_t *) a;
+    const s_arc_change_t *cb = (const s_arc_change_t *) b;
+    if (ca->from_node_id != cb->from_node_id)
+        return (ca->from_node_id < cb->from_node_id) ? -1 : 1;
+    if (ca->to_node_id != cb->to_node_id)
+        return (ca->to_node_id < cb->to_node_id) ? -1 : 1;
+    return (ca->seq < cb->seq) ? -1 : (ca->seq > cb->seq);
 }
 
 
-const coord2d_t *vrp_node_coord (vrp_t *self, size_t node_id) {
-    assert (self);
-    s_node_t *node = vrp_node (self, node_id);
-    return &(node->coord);
+// Find change of arc in sorted change log, or NULL
+static const s_arc_change_t *vrp_find_arc_change (const vrp_t *self,
+                                                  size_t from_node_id,
+                                                  size_t to_node_id) {
+    size_t low = 0, high = self->num_arc_changes;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const s_arc_change_t *change = &self->arc_changes[mid];
+        if (change->from_node_id < from_node_id ||
+            (change->from_node_id == from_node_id &&
+             change->to_node_id < to_node_id))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < self->num_arc_changes &&
+        self->arc_changes[low].from_node_id == from_node_id &&
+        self->arc_changes[low].to_node_id == to_node_id)
+        return &self->arc_changes[low];
+    return NULL;
 }
 
 
-const listu_t *vrp_node_pending_request_ids (vrp_t *self, size_t node_id) {
-    assert (self);
-    s_node_t *node = vrp_node (self, node_id);
-    assert (node);
-    return node->pending_request_ids;
+// Time windows and service duration of node, taken from its first pending
+// request, in receiver role if node is a receiver of the request
+static const s_time_windows_t *vrp_node_service (vrp_t *self,
+                                                 size_t node_id,
+                                                 size_t *service_duration) {
+    const listu_t *request_ids = vrp_node (self, node_id)->pending_request_ids;
+    *service_duration = 0;
+    if (listu_size (request_ids) == 0)
+        return NULL;
+
+    size_t request_id = listu_get (request_ids, 0);
+    if (self->request_receivers[request_id] == node_id) {
+        *service_duration = self->delivery_durations[request_id];
+        return &self->delivery_time_windows[request_id];
+    }
+    *service_duration = self->pickup_durations[request_id];
+    return &self->pickup_time_windows[request_id];
 }
 
 
-size_t vrp_num_nodes (vrp_t *self) {
-    assert (self);
-    return arrayset_size (self->nodes);
+// Service time given arrival time and time windows, or SIZE_NONE if no
+// time window fits
+static size_t s_service_time (const s_time_windows_t *time_windows,
+                              size_t arrival_time) {
+    if (time_windows == NULL || time_windows->size == 0)
+        return arrival_time;
+    const size_t *values = s_time_windows_values (time_windows);
+    for (size_t idx = 0; idx + 1 < time_windows->size; idx += 2) {
+        if (arrival_time <= values[idx + 1])
+            return max2 (arrival_time, values[idx]);
+    }
+    return SIZE_NONE;
 }
 
 
-const listu_t *vrp_nodes (vrp_t *self) {
-    assert (self);
-    return self->node_ids;
+// Check time windows along route of node IDs
+static bool vrp_route_is_on_time (vrp_t *self, const route_t *route) {
+    size_t size = route_size (route);
+    if (size == 0 || !vrp_arc_durations_defined (self))
+        return true;
+
+    size_t service_duration;
+    size_t node = route_at (route, 0);
+    const s_time_windows_t *tws =
+        vrp_node_service (self, node, &service_duration);
+    size_t departure_time =
+        ((tws != NULL && tws->size > 0) ? s_time_windows_values (tws)[0] : 0) +
+        service_duration;
+
+    for (size_t idx = 1; idx < size; idx++) {
+        size_t last_node = node;
+        node = route_at (route, idx);
+        size_t arrival_time =
+            departure_time +
+            vrp_arc_duration_at (self, last_node, node, departure_time);
+        tws = vrp_node_service (self, node, &service_duration);
+        size_t service_time = s_service_time (tws, arrival_time);
+        if (service_time == SIZE_NONE)
+            return false;
+        departure_time = service_time + service_duration;
+    }
+    return true;
 }
 
 
-double vrp_arc_distance (const vrp_t *self,
-                         size_t from_node_id, size_t to_node_id) {
+size_t vrp_reevaluate_solution (vrp_t *self,
+                                solution_t *sol,
+                                listu_t *late_route_indices) {
     assert (self);
-    assert (self->distances != NULL);
-    return matrixd_get (self->distances, from_node_id, to_node_id);
-}
+    assert (sol);
+
+    // Sort change log once; the first record of an arc has its distance
+    // before all updates
+    qsort (self->arc_changes, self->num_arc_changes, sizeof (s_arc_change_t),
+           s_arc_change_compare);
+    size_t num_unique = 0;
+    for (size_t idx = 0; idx < self->num_arc_changes; idx++) {
+        if (num_unique > 0 &&
+            self->arc_changes[num_unique - 1].from_node_id ==
+            self->arc_changes[idx].from_node_id &&
+            self->arc_changes[num_unique - 1].to_node_id ==
+            self->arc_changes[idx].to_node_id)
+            continue;
+        self->arc_changes[num_unique++] = self->arc_changes[idx];
+    }
+    self->num_arc_changes = num_unique;
+
+    size_t num_affected = 0;
+    double delta_distance = 0;
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        const route_t *route = solution_route (sol, idx_r);
+        bool affected = false;
+        for (size_t idx = 0; idx + 1 < route_size (route); idx++) {
+            size_t from_id = route_at (route, idx);
+            size_t to_id = route_at (route, idx + 1);
+            const s_arc_change_t *change =
+                vrp_find_arc_change (self, from_id, to_id);
+            if (change == NULL)
+                continue;
+            affected = true;
+            if (!double_is_none (change->old_distance))
+                delta_distance += vrp_arc_distance (self, from_id, to_id) -
+                                  change->old_distance;
+        }
 
+        if (!affected)
+            continue;
+        num_affected++;
+        if (late_route_indices != NULL && !vrp_route_is_on_time (self, route))
+            listu_append (late_route_indices, idx_r);
+    }
 
-size_t vrp_arc_duration (const vrp_t *self,
-                         size_t from_node_id, size_t to_node_id) {
-    assert (self);
-    assert (self->durations != NULL);
-    return matrixu_get (self->durations, from_node_id, to_node_id);
+    solution_increase_total_distance (sol, delta_distance);
+    self->num_arc_changes = 0;
+    return num_affected;
 }
 
 
@@ -853,6 +2819,26 @@ static bool vrp_vehicle_exists (vrp_t *self, size_t vehicle_id) {
 }
 
 
+// Update fleet attributes with new vehicle. Vehicles are compared in order
+// of IDs, with the first one which has start (end) node.
+static void vrp_count_vehicle (vrp_t *self, const s_vehicle_t *vehicle) {
+    double max_capacity = self->vehicle_max_capacities[vehicle->id];
+    if (double_is_none (self->fleet_capacity))
+        self->fleet_capacity = max_capacity;
+    if (!double_equal (self->fleet_capacity, max_capacity))
+        self->vehicles_have_same_capacity = false;
+
+    if (self->fleet_start_node_id == ID_NONE)
+        self->fleet_start_node_id = vehicle->start_node_id;
+    else if (vehicle->start_node_id != self->fleet_start_node_id)
+        self->vehicles_start_at_same_node = false;
+    if (self->fleet_end_node_id == ID_NONE)
+        self->fleet_end_node_id = vehicle->end_node_id;
+    else if (vehicle->end_node_id != self->fleet_end_node_id)
+        self->vehicles_end_at_same_node = false;
+}
+
+
 size_t vrp_add_vehicle (vrp_t *self,
                         const char *vehicle_ext_id,
                         double max_capacity,
@@ -864,10 +2850,11 @@ size_t vrp_add_vehicle (vrp_t *self,
     assert (start_node_id == ID_NONE || vrp_node_exists (self, start_node_id));
     assert (end_node_id == ID_NONE || vrp_node_exists (self, end_node_id));
 
-    s_vehicle_t *vehicle = s_vehicle_new (vehicle_ext_id);
+    s_vehicle_t *vehicle = s_vehicle_new (self->arena, vehicle_ext_id);
     assert (vehicle);
 
-    size_t id = arrayset_add (self->vehicles, vehicle, vehicle->ext_id);
+    size_t id = s_add_indexed (self->vehicles, self->vehicle_index,
+                               vehicle, vehicle->ext_id);
     if (id == ID_NONE) {
         print_error ("vehicle with external ID %s already exists.\n", vehicle_ext_id);
         s_vehicle_free (&vehicle);
@@ -875,10 +2862,12 @@ size_t vrp_add_vehicle (vrp_t *self,
     }
 
     vehicle->id = id;
-    vehicle->max_capacity = max_capacity;
-    vehicle->capacity = max_capacity;
+    vrp_reserve_vehicle_fields (self, id);
+    self->vehicle_max_capacities[id] = max_capacity;
+    self->vehicle_capacities[id] = max_capacity;
     vehicle->start_node_id = start_node_id;
     vehicle->end_node_id = end_node_id;
+    vrp_count_vehicle (self, vehicle);
 
     assert (!listu_includes (self->vehicle_ids, id));
     listu_insert_sorted (self->vehicle_ids, id);
@@ -886,6 +2875,59 @@ size_t vrp_add_vehicle (vrp_t *self,
 }
 
 
+size_t vrp_add_vehicles (vrp_t *self,
+                         const char **vehicle_ext_ids,
+                         const double *max_capacities,
+                         const size_t *start_node_ids,
+                         const size_t *end_node_ids,
+                         size_t num_vehicles,
+                         size_t *vehicle_ids) {
+    assert (self);
+    assert (vehicle_ext_ids);
+    assert (max_capacities);
+
+    size_t *new_ids = (size_t *) malloc ((num_vehicles + 1) * sizeof (size_t));
+    assert (new_ids);
+    size_t num_added = 0;
+
+    for (size_t cnt = 0; cnt < num_vehicles; cnt++) {
+        size_t start_node_id =
+            (start_node_ids != NULL) ? start_node_ids[cnt] : ID_NONE;
+        size_t end_node_id =
+            (end_node_ids != NULL) ? end_node_ids[cnt] : ID_NONE;
+        assert (max_capacities[cnt] > 0);
+        assert (start_node_id == ID_NONE ||
+                vrp_node_exists (self, start_node_id));
+        assert (end_node_id == ID_NONE || vrp_node_exists (self, end_node_id));
+
+        s_vehicle_t *vehicle = s_vehicle_new (self->arena, vehicle_ext_ids[cnt]);
+        size_t id = s_add_indexed (self->vehicles, self->vehicle_index,
+                                   vehicle, vehicle->ext_id);
+        if (id == ID_NONE) {
+            print_error ("vehicle with external ID %s already exists.\n",
+                         vehicle_ext_ids[cnt]);
+            s_vehicle_free (&vehicle);
+        }
+        else {
+            vehicle->id = id;
+            vrp_reserve_vehicle_fields (self, id);
+            self->vehicle_max_capacities[id] = max_capacities[cnt];
+            self->vehicle_capacities[id] = max_capacities[cnt];
+            vehicle->start_node_id = start_node_id;
+            vehicle->end_node_id = end_node_id;
+            vrp_count_vehicle (self, vehicle);
+            new_ids[num_added++] = id;
+        }
+        if (vehicle_ids != NULL)
+            vehicle_ids[cnt] = id;
+    }
+
+    s_merge_sorted_ids (self->vehicle_ids, new_ids, num_added);
+    free (new_ids);
+    return num_added;
+}
+
+
 size_t vrp_num_vehicles (vrp_t *self) {
     assert (self);
     return arrayset_size (self->vehicles);
@@ -907,57 +2949,59 @@ const char *vrp_vehicle_ext_id (vrp_t *self, size_t vehicle_id) {
 
 double vrp_vehicle_max_capacity (vrp_t *self, size_t vehicle_id) {
     assert (self);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    return vehicle->max_capacity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    return self->vehicle_max_capacities[vehicle_id];
 }
 
 
 double vrp_vehicle_capacity (vrp_t *self, size_t vehicle_id) {
     assert (self);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    return vehicle->capacity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    return self->vehicle_capacities[vehicle_id];
 }
 
 
 void vrp_reset_vehicle_capacity (vrp_t *self, size_t vehicle_id) {
     assert (self);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    vehicle->capacity = vehicle->max_capacity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    self->vehicle_capacities[vehicle_id] =
+        self->vehicle_max_capacities[vehicle_id];
 }
 
 
 void vrp_reset_all_vehicles_capacities (vrp_t *self) {
     assert (self);
-    for (s_vehicle_t *vehicle = (s_vehicle_t *) arrayset_first (self->vehicles);
-         vehicle != NULL;
-         vehicle = (s_vehicle_t *) arrayset_next (self->vehicles)) {
-        vehicle->capacity = vehicle->max_capacity;
-    }
+    // Fields of IDs without vehicle are not used, so all are copied
+    if (self->vehicle_fields_size > 0)
+        memcpy (self->vehicle_capacities, self->vehicle_max_capacities,
+                self->vehicle_fields_size * sizeof (double));
 }
 
 
 double vrp_vehicle_load (vrp_t *self, size_t vehicle_id) {
     assert (self);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    return vehicle->max_capacity - vehicle->capacity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    return self->vehicle_max_capacities[vehicle_id] -
+           self->vehicle_capacities[vehicle_id];
 }
 
 
 void vrp_vehicle_do_pickup (vrp_t *self, size_t vehicle_id, double quantity) {
     assert (self);
     assert (quantity >= 0);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    assert (quantity <= vehicle->capacity);
-    vehicle->capacity -= quantity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    assert (quantity <= self->vehicle_capacities[vehicle_id]);
+    self->vehicle_capacities[vehicle_id] -= quantity;
 }
 
 
 void vrp_vehicle_do_delivery (vrp_t *self, size_t vehicle_id, double quantity) {
     assert (self);
     assert (quantity >= 0);
-    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-    assert (vehicle->capacity + quantity <= vehicle->max_capacity);
-    vehicle->capacity += quantity;
+    assert (vrp_vehicle_exists (self, vehicle_id));
+    assert (self->vehicle_capacities[vehicle_id] + quantity <=
+            self->vehicle_max_capacities[vehicle_id]);
+    self->vehicle_capacities[vehicle_id] += quantity;
 }
 
 
@@ -999,6 +3043,36 @@ void vrp_detach_route_from_vehicle (vrp_t *self, size_t vehicle_id) {
 }
 
 
+const listu_t *vrp_vehicle_fixed_node_ids (vrp_t *self, size_t vehicle_id) {
+    assert (self);
+    return vrp_vehicle (self, vehicle_id)->fixed_node_ids;
+}
+
+
+double vrp_vehicle_fixed_quantity (vrp_t *self, size_t vehicle_id) {
+    assert (self);
+    return vrp_vehicle (self, vehicle_id)->fixed_quantity;
+}
+
+
+size_t vrp_vehicle_departure_time (vrp_t *self, size_t vehicle_id) {
+    assert (self);
+    return vrp_vehicle (self, vehicle_id)->departure_time;
+}
+
+
+size_t vrp_num_fixed_vehicles (vrp_t *self) {
+    assert (self);
+    size_t num = 0;
+    for (size_t idx = 0; idx < listu_size (self->vehicle_ids); idx++) {
+        size_t vehicle_id = listu_get (self->vehicle_ids, idx);
+        if (vrp_vehicle (self, vehicle_id)->fixed_node_ids != NULL)
+            num++;
+    }
+    return num;
+}
+
+
 // ---------------------------------------------------------------------------
 // Requests
 // ---------------------------------------------------------------------------
@@ -1012,6 +3086,43 @@ static s_request_t *vrp_request (vrp_t *self, size_t request_id) {
 }
 
 
+static void s_count (size_t *counter, bool condition, bool add) {
+    if (!condition)
+        return;
+    if (add)
+        (*counter)++;
+    else {
+        assert (*counter > 0);
+        (*counter)--;
+    }
+}
+
+
+static bool vrp_request_has_time_windows (const vrp_t *self,
+                                          size_t request_id) {
+    return self->pickup_time_windows[request_id].size > 0 ||
+           self->delivery_time_windows[request_id].size > 0;
+}
+
+
+// Add request to counters of pending requests, or remove it
+static void vrp_count_pending_request (vrp_t *self,
+                                       const s_request_t *request,
+                                       bool add) {
+    size_t id = request->id;
+    s_count (&self->num_pending_pd, request->type == RT_PD, add);
+    s_count (&self->num_pending_plain_visits,
+             request->type == RT_VISIT && self->request_quantities[id] <= 0,
+             add);
+    s_count (&self->num_pending_with_sender,
+             self->request_senders[id] != ID_NONE, add);
+    s_count (&self->num_pending_with_receiver,
+             self->request_receivers[id] != ID_NONE, add);
+    s_count (&self->num_pending_with_time_windows,
+             vrp_request_has_time_windows (self, id), add);
+}
+
+
 static void vrp_associate_node_with_new_request (vrp_t *self,
                                                  size_t node_id,
                                                  size_t request_id) {
@@ -1038,18 +3149,26 @@ size_t vrp_add_request (vrp_t *self,
     assert (quantity >= 0);
 
     // Create a new request
-    s_request_t *request = s_request_new (request_ext_id);
-    size_t id = arrayset_add (self->requests, request, request->ext_id);
+    s_request_t *request = s_request_new (self->arena, request_ext_id);
+    size_t id = s_add_indexed (self->requests, self->request_index,
+                               request, request->ext_id);
+    if (id == ID_NONE) {
+        print_error ("Request with external ID %s already exists.\n",
+                     request_ext_id);
+        s_request_free (&request);
+        return ID_NONE;
+    }
     request->id = id;
 
     // Set task
-    request->sender_id = sender;
-    request->receiver_id = receiver;
+    vrp_reserve_request_fields (self, id);
+    self->request_senders[id] = sender;
+    self->request_receivers[id] = receiver;
     if (sender == ID_NONE || receiver == ID_NONE)
         request->type = RT_VISIT;
     else
         request->type = RT_PD;
-    request->quantity = quantity;
+    self->request_quantities[id] = quantity;
 
     // Associate nodes with request
     if (sender != ID_NONE) {
@@ -1065,10 +3184,493 @@ size_t vrp_add_request (vrp_t *self,
 
     assert (!listu_includes (self->pending_request_ids, id));
     listu_insert_sorted (self->pending_request_ids, id);
+    vrp_count_pending_request (self, request, true);
     return id;
 }
 
 
+size_t vrp_add_requests (vrp_t *self,
+                         const char **request_ext_ids,
+                         const size_t *senders,
+                         const size_t *receivers,
+                         const double *quantities,
+                         size_t num_requests,
+                         size_t *request_ids) {
+    assert (self);
+    assert (request_ext_ids);
+
+    // New request IDs, senders and receivers, merged once at the end
+    size_t *new_ids =
+        (size_t *) malloc ((3 * num_requests + 1) * sizeof (size_t));
+    assert (new_ids);
+    size_t *new_senders = new_ids + num_requests;
+    size_t *new_receivers = new_senders + num_requests;
+    size_t num_added = 0, num_senders = 0, num_receivers = 0;
+
+    for (size_t cnt = 0; cnt < num_requests; cnt++) {
+        size_t sender = (senders != NULL) ? senders[cnt] : ID_NONE;
+        size_t receiver = (receivers != NULL) ? receivers[cnt] : ID_NONE;
+        double quantity = (quantities != NULL) ? quantities[cnt] : 0;
+        assert (sender == ID_NONE || vrp_node_exists (self, sender));
+        assert (receiver == ID_NONE || vrp_node_exists (self, receiver));
+        assert (sender != ID_NONE || receiver != ID_NONE);
+        assert (sender != receiver);
+        assert (quantity >= 0);
+
+        s_request_t *request = s_request_new (self->arena, request_ext_ids[cnt]);
+        size_t id = s_add_indexed (self->requests, self->request_index,
+                                   request, request->ext_id);
+        if (request_ids != NULL)
+            request_ids[cnt] = id;
+        if (id == ID_NONE) {
+            print_error ("Request with external ID %s already exists.\n",
+                         request_ext_ids[cnt]);
+            s_request_free (&request);
+            continue;
+        }
+
+        request->id = id;
+        vrp_reserve_request_fields (self, id);
+        self->request_senders[id] = sender;
+        self->request_receivers[id] = receiver;
+        request->type = (sender == ID_NONE || receiver == ID_NONE) ?
+                        RT_VISIT : RT_PD;
+        self->request_quantities[id] = quantity;
+
+        // Request ID is new, so it is appended to nodes without checking
+        if (sender != ID_NONE) {
+            listu_append (vrp_node (self, sender)->pending_request_ids, id);
+            new_senders[num_senders++] = sender;
+        }
+        if (receiver != ID_NONE) {
+            listu_append (vrp_node (self, receiver)->pending_request_ids, id);
+            new_receivers[num_receivers++] = receiver;
+        }
+        vrp_count_pending_request (self, request, true);
+        new_ids[num_added++] = id;
+    }
+
+    s_merge_sorted_ids (self->sender_ids, new_senders, num_senders);
+    s_merge_sorted_ids (self->receiver_ids, new_receivers, num_receivers);
+    s_merge_sorted_ids (self->pending_request_ids, new_ids, num_added);
+    free (new_ids);
+    return num_added;
+}
+
+
+// Remove pending request from node. Node loses its role in model (sender or
+// receiver) when no other pending request of it plays the same role.
+static void vrp_dissociate_node_from_request (vrp_t *self,
+                                              size_t node_id,
+                                              size_t request_id,
+                                              listu_t *role_node_ids) {
+    listu_t *request_ids = vrp_node (self, node_id)->pending_request_ids;
+    size_t idx = listu_find (request_ids, request_id);
+    assert (idx != SIZE_NONE);
+    listu_remove_at (request_ids, idx);
+
+    const size_t *role_nodes = (role_node_ids == self->sender_ids) ?
+                               self->request_senders :
+                               self->request_receivers;
+    for (idx = 0; idx < listu_size (request_ids); idx++) {
+        if (role_nodes[listu_get (request_ids, idx)] == node_id)
+            return;
+    }
+    idx = listu_find (role_node_ids, node_id);
+    if (idx != SIZE_NONE)
+        listu_remove_at (role_node_ids, idx);
+}
+
+
+// Withdraw pending request from model and set its new state
+static void vrp_withdraw_request (vrp_t *self,
+                                  size_t request_id,
+                                  request_state_t state) {
+    size_t idx = listu_find (self->pending_request_ids, request_id);
+    assert (idx != SIZE_NONE);
+    s_request_t *request = vrp_request (self, request_id);
+    assert (request->state == RS_PENDING);
+    listu_remove_at (self->pending_request_ids, idx);
+    request->state = state;
+    vrp_count_pending_request (self, request, false);
+
+    size_t sender = self->request_senders[request_id];
+    size_t receiver = self->request_receivers[request_id];
+    if (sender != ID_NONE)
+        vrp_dissociate_node_from_request (self, sender,
+                                          request_id, self->sender_ids);
+    if (receiver != ID_NONE)
+        vrp_dissociate_node_from_request (self, receiver,
+                                          request_id, self->receiver_ids);
+}
+
+
+int vrp_cancel_request (vrp_t *self, size_t request_id) {
+    assert (self);
+    if (!listu_includes (self->pending_request_ids, request_id))
+        return -1;
+    vrp_withdraw_request (self, request_id, RS_CANCELLED);
+    return 0;
+}
+
+
+// Pending request which node receives, or ID_NONE
+static size_t vrp_node_received_request (vrp_t *self, size_t node_id) {
+    const listu_t *request_ids = vrp_node (self, node_id)->pending_request_ids;
+    for (size_t idx = 0; idx < listu_size (request_ids); idx++) {
+        size_t request_id = listu_get (request_ids, idx);
+        if (self->request_receivers[request_id] == node_id)
+            return request_id;
+    }
+    return ID_NONE;
+}
+
+
+// Check if node could be current position of a vehicle without being a
+// stop: it exists, has no pending requests, and is not start, end or fixed
+// stop of any vehicle, so that submodels never see it twice
+static bool vrp_is_position_node (vrp_t *self, size_t node_id) {
+    if (!vrp_node_exists (self, node_id) ||
+        listu_size (vrp_node (self, node_id)->pending_request_ids) > 0)
+        return false;
+    for (size_t idx = 0; idx < listu_size (self->vehicle_ids); idx++) {
+        s_vehicle_t *vehicle =
+            vrp_vehicle (self, listu_get (self->vehicle_ids, idx));
+        if (vehicle->start_node_id == node_id ||
+            vehicle->end_node_id == node_id ||
+            (vehicle->fixed_node_ids != NULL &&
+             listu_includes (vehicle->fixed_node_ids, node_id)))
+            return false;
+    }
+    return true;
+}
+
+
+int vrp_fix_route_prefix (vrp_t *self,
+                          size_t vehicle_id,
+                          const size_t *node_ids,
+                          size_t num_nodes,
+                          size_t departure_time) {
+    assert (self);
+    assert (node_ids);
+    assert (num_nodes > 0);
+    s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
+
+    // Check all stops before changing anything. A stop must have exactly one
+    // pending request, which is received there: otherwise the node would stay
+    // a customer while it is also current position of vehicle. The last stop
+    // could instead be a position node without pending requests.
+    for (size_t idx = 0; idx < num_nodes; idx++) {
+        size_t node_id = node_ids[idx];
+        if (idx + 1 == num_nodes && vrp_is_position_node (self, node_id))
+            break;
+        if (!vrp_node_exists (self, node_id) ||
+            vrp_node_received_request (self, node_id) == ID_NONE) {
+            print_error ("Node %zu has no pending request to receive.\n",
+                         node_id);
+            return -1;
+        }
+        s_node_t *node = vrp_node (self, node_id);
+        if (listu_size (node->pending_request_ids) > 1) {
+            print_error ("Node %zu has other pending requests.\n", node_id);
+            return -1;
+        }
+        for (size_t k = 0; k < idx; k++) {
+            if (node_ids[k] == node_id) {
+                print_error ("Node %zu is visited twice.\n", node_id);
+                return -1;
+            }
+        }
+    }
+
+    if (vehicle->fixed_node_ids == NULL)
+        vehicle->fixed_node_ids = listu_new (num_nodes);
+    for (size_t idx = 0; idx < num_nodes; idx++) {
+        size_t request_id = vrp_node_received_request (self, node_ids[idx]);
+        if (request_id != ID_NONE) {
+            vehicle->fixed_quantity += self->request_quantities[request_id];
+            vrp_withdraw_request (self, request_id, RS_COMPLETED);
+        }
+        listu_append (vehicle->fixed_node_ids, node_ids[idx]);
+    }
+    vehicle->departure_time = departure_time;
+    return 0;
+}
+
+
+size_t vrp_archive_requests (vrp_t *self) {
+    assert (self);
+    listu_t *archived_ids = listu_new (0);
+    for (s_request_t *request = (s_request_t *) arrayset_first (self->requests);
+         request != NULL;
+         request = (s_request_t *) arrayset_next (self->requests)) {
+        if (request->state == RS_COMPLETED || request->state == RS_CANCELLED)
+            listu_append (archived_ids, request->id);
+    }
+
+    // Requests are already withdrawn from nodes and pending list
+    size_t num_archived = listu_size (archived_ids);
+    for (size_t idx = 0; idx < num_archived; idx++) {
+        size_t request_id = listu_get (archived_ids, idx);
+        strindex_remove (self->request_index,
+                         vrp_request (self, request_id)->ext_id);
+        s_time_windows_release (&self->pickup_time_windows[request_id],
+                                self);
+        s_time_windows_release (&self->delivery_time_windows[request_id],
+                                self);
+        arrayset_remove (self->requests, request_id);
+    }
+    listu_free (&archived_ids);
+    return num_archived;
+}
+
+
+// Remap sorted list of IDs in place, and sort it again
+static void s_remap_ids (listu_t *ids, const size_t *id_map) {
+    for (size_t idx = 0; idx < listu_size (ids); idx++) {
+        size_t new_id = id_map[listu_get (ids, idx)];
+        assert (new_id != ID_NONE);
+        listu_set (ids, idx, new_id);
+    }
+    listu_sort (ids, true);
+}
+
+
+// Move arcs of live nodes to rows of their new IDs: node_map[old ID] is new
+// ID or ID_NONE, for old IDs < id_bound
+static void vrp_compact_arcs (vrp_t *self,
+                              const size_t *node_map, size_t id_bound,
+                              size_t num_live) {
+    // Old and new rows of live nodes. Renumbered rows keep their order, so
+    // rows stay in curve order after vrp_renumber_nodes_spatially ().
+    size_t *old_rows = (size_t *) malloc ((num_live + 1) * sizeof (size_t));
+    size_t *new_rows = (size_t *) malloc ((num_live + 1) * sizeof (size_t));
+    assert (old_rows && new_rows);
+    size_t cnt = 0;
+    for (size_t old_id = 0; old_id < id_bound; old_id++) {
+        if (node_map[old_id] != ID_NONE) {
+            old_rows[cnt] = vrp_arc_row (self, old_id);
+            new_rows[cnt++] = node_map[old_id];
+        }
+    }
+    assert (cnt == num_live);
+
+    // New IDs are consecutive from 0
+    if (self->arc_rows != NULL) {
+        // Rank of old row among live rows
+        size_t *rank = (size_t *) malloc ((self->num_arc_rows + 1) *
+                                          sizeof (size_t));
+        assert (rank);
+        for (size_t row = 0; row < self->num_arc_rows; row++)
+            rank[row] = SIZE_NONE;
+        for (cnt = 0; cnt < num_live; cnt++)
+            rank[old_rows[cnt]] = 0;
+        size_t num_rows = 0;
+        for (size_t row = 0; row < self->num_arc_rows; row++) {
+            if (rank[row] == 0)
+                rank[row] = num_rows++;
+        }
+
+        size_t *arc_rows = (size_t *) malloc ((num_live + 1) * sizeof (size_t));
+        assert (arc_rows);
+        for (cnt = 0; cnt < num_live; cnt++) {
+            arc_rows[new_rows[cnt]] = rank[old_rows[cnt]];
+            new_rows[cnt] = rank[old_rows[cnt]];
+        }
+        free (rank);
+
+        free (self->arc_rows);
+        self->arc_rows = arc_rows;
+        self->arc_rows_size = num_live;
+        self->num_arc_rows = num_live;
+    }
+
+    if (self->distances != NULL) {
+        arcmatrix_t *distances =
+            vrp_permute_arc_matrix (self->distances,
+                                    old_rows, new_rows, num_live, num_live);
+        arcmatrix_free (&self->distances);
+        self->distances = distances;
+    }
+    if (self->durations != NULL) {
+        arcmatrix_t *durations =
+            vrp_permute_arc_matrix (self->durations,
+                                    old_rows, new_rows, num_live, num_live);
+        arcmatrix_free (&self->durations);
+        self->durations = durations;
+    }
+    if (self->td_durations != NULL) {
+        tdarcs_t *td_durations =
+            tdarcs_permute (self->td_durations,
+                            old_rows, new_rows, num_live, num_live);
+        tdarcs_free (&self->td_durations);
+        self->td_durations = td_durations;
+    }
+    free (old_rows);
+    free (new_rows);
+
+    // Sparse arcs and cached distances are indexed by node ID
+    if (self->sparse_arcs != NULL)
+        sparsearcs_remap (self->sparse_arcs, node_map, id_bound);
+    if (self->distance_cache != NULL)
+        rowcache_clear (self->distance_cache);
+    self->num_arc_changes = 0;
+}
+
+
+size_t vrp_compact (vrp_t *self,
+                    listu_t *node_id_map,
+                    listu_t *request_id_map) {
+    assert (self);
+    vrp_archive_requests (self);
+
+    // Live nodes: nodes of pending requests, and start, end and visited
+    // stops of vehicles. Marked with 0 first.
+    size_t id_bound = (listu_size (self->node_ids) > 0) ?
+                      listu_last (self->node_ids) + 1 : 0;
+    size_t *node_map = (size_t *) malloc ((id_bound + 1) * sizeof (size_t));
+    assert (node_map);
+    for (size_t id = 0; id < id_bound; id++)
+        node_map[id] = ID_NONE;
+    for (size_t idx = 0; idx < listu_size (self->node_ids); idx++) {
+        size_t id = listu_get (self->node_ids, idx);
+        if (listu_size (vrp_node (self, id)->pending_request_ids) > 0)
+            node_map[id] = 0;
+    }
+    for (s_vehicle_t *vehicle = (s_vehicle_t *) arrayset_first (self->vehicles);
+         vehicle != NULL;
+         vehicle = (s_vehicle_t *) arrayset_next (self->vehicles)) {
+        if (vehicle->start_node_id != ID_NONE)
+            node_map[vehicle->start_node_id] = 0;
+        if (vehicle->end_node_id != ID_NONE)
+            node_map[vehicle->end_node_id] = 0;
+        for (size_t idx = 0;
+             vehicle->fixed_node_ids != NULL &&
+             idx < listu_size (vehicle->fixed_node_ids);
+             idx++)
+            node_map[listu_get (vehicle->fixed_node_ids, idx)] = 0;
+    }
+
+    // Renumber live nodes in order of old IDs; the others are freed
+    arrayset_t *nodes =
+        s_arrayset_new (0, (destructor_t) s_node_free);
+    listu_t *node_ids = listu_new (listu_size (self->node_ids));
+    strindex_clear (self->node_index);
+    size_t num_live = 0;
+    for (size_t idx = 0; idx < listu_size (self->node_ids); idx++) {
+        size_t id = listu_get (self->node_ids, idx);
+        s_node_t *node = vrp_node (self, id);
+        if (node_map[id] == ID_NONE) {
+            s_node_free (&node);
+            continue;
+        }
+        node->id = s_add_indexed (nodes, self->node_index, node, node->ext_id);
+        assert (node->id != ID_NONE);
+        // New IDs are not greater than old ones, which are visited in
+        // ascending order, so fields are moved in place
+        self->node_coords[node->id] = self->node_coords[id];
+        node_map[id] = node->id;
+        listu_append (node_ids, node->id);
+        num_live++;
+    }
+    vrp_compact_arcs (self, node_map, id_bound, num_live);
+    if (self->fleet_start_node_id != ID_NONE)
+        self->fleet_start_node_id = node_map[self->fleet_start_node_id];
+    if (self->fleet_end_node_id != ID_NONE)
+        self->fleet_end_node_id = node_map[self->fleet_end_node_id];
+
+    // Nodes are moved, not destroyed with old set
+    arrayset_set_data_destructor (self->nodes, NULL);
+    arrayset_free (&self->nodes);
+    self->nodes = nodes;
+    listu_free (&self->node_ids);
+    self->node_ids = node_ids;
+    listu_sort (self->node_ids, true);
+    vrp_recount_roadgraph (self);
+    spatialindex_free (&self->spatial_index); // rebuilt on next query
+    s_remap_ids (self->sender_ids, node_map);
+    s_remap_ids (self->receiver_ids, node_map);
+
+    for (s_vehicle_t *vehicle = (s_vehicle_t *) arrayset_first (self->vehicles);
+         vehicle != NULL;
+         vehicle = (s_vehicle_t *) arrayset_next (self->vehicles)) {
+        if (vehicle->start_node_id != ID_NONE)
+            vehicle->start_node_id = node_map[vehicle->start_node_id];
+        if (vehicle->end_node_id != ID_NONE)
+            vehicle->end_node_id = node_map[vehicle->end_node_id];
+        for (size_t idx = 0;
+             vehicle->fixed_node_ids != NULL &&
+             idx < listu_size (vehicle->fixed_node_ids);
+             idx++)
+            listu_set (vehicle->fixed_node_ids, idx,
+                       node_map[listu_get (vehicle->fixed_node_ids, idx)]);
+    }
+
+    // Renumber remaining requests in order of old IDs
+    size_t request_bound = 0;
+    for (s_request_t *request = (s_request_t *) arrayset_first (self->requests);
+         request != NULL;
+         request = (s_request_t *) arrayset_next (self->requests))
+        request_bound = max2 (request_bound, request->id + 1);
+    size_t *request_map =
+        (size_t *) malloc ((request_bound + 1) * sizeof (size_t));
+    assert (request_map);
+    for (size_t id = 0; id < request_bound; id++)
+        request_map[id] = ID_NONE;
+
+    arrayset_t *requests =
+        s_arrayset_new (1, (destructor_t) s_request_free);
+    strindex_clear (self->request_index);
+    for (size_t id = 0; id < request_bound; id++) {
+        s_request_t *request =
+            (s_request_t *) arrayset_data (self->requests, id);
+        if (request == NULL)
+            continue;
+        request->id = s_add_indexed (requests, self->request_index,
+                                     request, request->ext_id);
+        assert (request->id != ID_NONE);
+        request_map[id] = request->id;
+
+        // Fields are moved in place, as nodes above
+        size_t new_id = request->id;
+        size_t sender = self->request_senders[id];
+        size_t receiver = self->request_receivers[id];
+        self->request_senders[new_id] =
+            (sender != ID_NONE) ? node_map[sender] : ID_NONE;
+        self->request_receivers[new_id] =
+            (receiver != ID_NONE) ? node_map[receiver] : ID_NONE;
+        self->request_quantities[new_id] = self->request_quantities[id];
+        self->pickup_time_windows[new_id] = self->pickup_time_windows[id];
+        self->delivery_time_windows[new_id] = self->delivery_time_windows[id];
+        self->pickup_durations[new_id] = self->pickup_durations[id];
+        self->delivery_durations[new_id] = self->delivery_durations[id];
+    }
+    arrayset_set_data_destructor (self->requests, NULL);
+    arrayset_free (&self->requests);
+    self->requests = requests;
+
+    s_remap_ids (self->pending_request_ids, request_map);
+    for (size_t idx = 0; idx < listu_size (self->node_ids); idx++) {
+        s_node_t *node = vrp_node (self, listu_get (self->node_ids, idx));
+        for (size_t k = 0; k < listu_size (node->pending_request_ids); k++)
+            listu_set (node->pending_request_ids, k,
+                       request_map[listu_get (node->pending_request_ids, k)]);
+    }
+
+    if (node_id_map != NULL) {
+        listu_purge (node_id_map);
+        listu_extend_array (node_id_map, node_map, id_bound);
+    }
+    if (request_id_map != NULL) {
+        listu_purge (request_id_map);
+        listu_extend_array (request_id_map, request_map, request_bound);
+    }
+    free (node_map);
+    free (request_map);
+    return num_live;
+}
+
+
 int vrp_add_time_window (vrp_t *self,
                           size_t request_id,
                           node_role_t node_role,
@@ -1078,24 +3680,39 @@ int vrp_add_time_window (vrp_t *self,
     assert (earliest <= latest);
     s_request_t *request = vrp_request (self, request_id);
     assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
 
-    size_t idx_e = listu_insert_sorted (tws, earliest);
-    size_t idx_l = listu_insert_sorted (tws, latest);
-    if (idx_e % 2 != 0 || (idx_e + 1 != idx_l)) {
-        listu_remove_at (tws, idx_l);
-        listu_remove_at (tws, idx_e);
+    bool had_time_windows = vrp_request_has_time_windows (self, request_id);
+    if (s_time_windows_insert (
+            vrp_request_time_windows (self, request_id, node_role),
+            self, earliest, latest) != 0)
         return -1;
-    }
 
+    if (!had_time_windows && request->state == RS_PENDING)
+        self->num_pending_with_time_windows++;
     return 0;
 }
 
 
+size_t vrp_add_time_windows (vrp_t *self,
+                             const size_t *request_ids,
+                             node_role_t node_role,
+                             const size_t *earliests,
+                             const size_t *latests,
+                             size_t num_time_windows) {
+    assert (self);
+    assert (request_ids && earliests && latests);
+
+    // Time windows are kept per request, so each insertion is cheap
+    size_t num_added = 0;
+    for (size_t cnt = 0; cnt < num_time_windows; cnt++) {
+        if (vrp_add_time_window (self, request_ids[cnt], node_role,
+                                 earliests[cnt], latests[cnt]) == 0)
+            num_added++;
+    }
+    return num_added;
+}
+
+
 void vrp_set_service_duration (vrp_t *self,
                                size_t request_id,
                                node_role_t node_role,
@@ -1105,15 +3722,25 @@ void vrp_set_service_duration (vrp_t *self,
     assert (request);
     assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
     if (node_role == NR_SENDER)
-        request->pickup_duration = service_duration;
+        self->pickup_durations[request_id] = service_duration;
     else
-        request->delivery_duration = service_duration;
+        self->delivery_durations[request_id] = service_duration;
 }
 
 
 size_t vrp_query_request (vrp_t *self, const char *request_ext_id) {
     assert (self);
-    return arrayset_query (self->requests, request_ext_id);
+    return strindex_query (self->request_index, request_ext_id);
+}
+
+
+size_t vrp_query_requests (vrp_t *self,
+                           const char **request_ext_ids,
+                           size_t num_requests,
+                           size_t *request_ids) {
+    assert (self);
+    return strindex_query_batch (self->request_index,
+                                 request_ext_ids, num_requests, request_ids);
 }
 
 
@@ -1155,25 +3782,22 @@ const listu_t *vrp_receivers (vrp_t *self) {
 
 size_t vrp_request_sender (vrp_t *self, size_t request_id) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    return request->sender_id;
+    assert (vrp_request (self, request_id) != NULL);
+    return self->request_senders[request_id];
 }
 
 
 size_t vrp_request_receiver (vrp_t *self, size_t request_id) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    return request->receiver_id;
+    assert (vrp_request (self, request_id) != NULL);
+    return self->request_receivers[request_id];
 }
 
 
 double vrp_request_quantity (vrp_t *self, size_t request_id) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    return request->quantity;
+    assert (vrp_request (self, request_id) != NULL);
+    return self->request_quantities[request_id];
 }
 
 
@@ -1181,13 +3805,8 @@ size_t vrp_num_time_windows (vrp_t *self,
                              size_t request_id,
                              node_role_t node_role) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
-    return (tws != NULL) ? listu_size (tws) / 2 : 0;
+    assert (vrp_request (self, request_id) != NULL);
+    return vrp_request_time_windows (self, request_id, node_role)->size / 2;
 }
 
 
@@ -1196,16 +3815,10 @@ size_t vrp_earliest_of_time_window (vrp_t *self,
                                     node_role_t node_role,
                                     size_t tw_idx) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
+    assert (vrp_request (self, request_id) != NULL);
     assert (tw_idx < vrp_num_time_windows (self, request_id, node_role));
-
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
-    assert (tws);
-    return listu_get (tws, tw_idx * 2);
+    return s_time_windows_values (
+        vrp_request_time_windows (self, request_id, node_role))[tw_idx * 2];
 }
 
 
@@ -1214,16 +3827,10 @@ size_t vrp_latest_of_time_window (vrp_t *self,
                                   node_role_t node_role,
                                   size_t tw_idx) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
+    assert (vrp_request (self, request_id) != NULL);
     assert (tw_idx < vrp_num_time_windows (self, request_id, node_role));
-
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
-    assert (tws);
-    return listu_get (tws, tw_idx * 2 + 1);
+    return s_time_windows_values (
+        vrp_request_time_windows (self, request_id, node_role))[tw_idx * 2 + 1];
 }
 
 
@@ -1231,34 +3838,22 @@ size_t vrp_earliest_service_time (vrp_t *self,
                                   size_t request_id,
                                   node_role_t node_role) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
-    assert (tws);
-    assert (listu_is_sorted_ascending (tws));
-    return (listu_size (tws) > 0) ? listu_get (tws, 0) : 0;
+    assert (vrp_request (self, request_id) != NULL);
+    const s_time_windows_t *tws =
+        vrp_request_time_windows (self, request_id, node_role);
+    return (tws->size > 0) ? s_time_windows_values (tws)[0] : 0;
 }
 
 
 size_t vrp_latest_service_time (vrp_t *self,
-                                size_t request_id,
-                                node_role_t node_role) {
-    assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-
-    listu_t *tws = (node_role == NR_SENDER) ?
-                   request->pickup_time_windows :
-                   request->delivery_time_windows;
-    assert (tws);
-    assert (listu_is_sorted_ascending (tws));
-    size_t size = listu_size (tws);
-    return (size > 0) ? listu_get (tws, size - 1) : SIZE_MAX;
+                                size_t request_id,
+                                node_role_t node_role) {
+    assert (self);
+    assert (vrp_request (self, request_id) != NULL);
+    const s_time_windows_t *tws =
+        vrp_request_time_windows (self, request_id, node_role);
+    return (tws->size > 0) ? s_time_windows_values (tws)[tws->size - 1] :
+                             SIZE_MAX;
 }
 
 
@@ -1266,27 +3861,21 @@ size_t vrp_service_duration (vrp_t *self,
                              size_t request_id,
                              node_role_t node_role) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
+    assert (vrp_request (self, request_id) != NULL);
     assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-
     return (node_role == NR_SENDER) ?
-           request->pickup_duration :
-           request->delivery_duration;
+           self->pickup_durations[request_id] :
+           self->delivery_durations[request_id];
 }
 
 
-const listu_t *vrp_time_windows (vrp_t *self,
-                                 size_t request_id,
-                                 node_role_t node_role) {
+const size_t *vrp_time_windows (vrp_t *self,
+                                size_t request_id,
+                                node_role_t node_role) {
     assert (self);
-    s_request_t *request = vrp_request (self, request_id);
-    assert (request);
-    assert (node_role == NR_SENDER || node_role == NR_RECEIVER);
-
-    return (node_role == NR_SENDER) ?
-           request->pickup_time_windows :
-           request->delivery_time_windows;
+    assert (vrp_request (self, request_id) != NULL);
+    return s_time_windows_values (
+        vrp_request_time_windows (self, request_id, node_role));
 }
 
 
@@ -1294,20 +3883,11 @@ bool vrp_time_windows_are_equal (vrp_t *self,
                                  size_t request_id1, node_role_t node_role1,
                                  size_t request_id2, node_role_t node_role2) {
     assert (self);
-    s_request_t *request1 = vrp_request (self, request_id1);
-    assert (request1);
-    assert (node_role1 == NR_SENDER || node_role1 == NR_RECEIVER);
-    s_request_t *request2 = vrp_request (self, request_id2);
-    assert (request2);
-    assert (node_role2 == NR_SENDER || node_role2 == NR_RECEIVER);
-
-    listu_t *tws1 = (node_role1 == NR_SENDER) ?
-                    request1->pickup_time_windows :
-                    request1->delivery_time_windows;
-    listu_t *tws2 = (node_role2 == NR_SENDER) ?
-                    request2->pickup_time_windows :
-                    request2->delivery_time_windows;
-    return listu_equal (tws1, tws2);
+    assert (vrp_request (self, request_id1) != NULL);
+    assert (vrp_request (self, request_id2) != NULL);
+    return s_time_windows_equal (
+        vrp_request_time_windows (self, request_id1, node_role1),
+        vrp_request_time_windows (self, request_id2, node_role2));
 }
 
 
@@ -1330,6 +3910,27 @@ static bool vrp_validate_roadgraph (vrp_t *self) {
     assert (num_nodes == listu_size (self->node_ids));
 
     bool coord_sys_is_defined = (vrp_coord_sys (self) != CS_NONE);
+    if (self->distances == NULL && self->on_demand_distances &&
+        !coord_sys_is_defined) {
+        if (self->sparse_arcs != NULL)
+            print_error ("Sparse arcs need coordinate system for arcs "
+                         "not set.\n");
+        else
+            print_error ("On-demand distances need coordinate system.\n");
+        return false;
+    }
+
+    // Counters tell if model is valid. Nodes are scanned only to report
+    // what is missing.
+    if (self->roadgraph_counts_stale)
+        vrp_recount_roadgraph (self);
+    size_t num_arcs = num_nodes * num_nodes;
+    if ((!coord_sys_is_defined || self->num_nodes_without_coord == 0) &&
+        (self->distances == NULL || self->num_distances_set == num_arcs) &&
+        (self->td_durations != NULL ?
+         self->num_td_durations_set == num_arcs :
+         (self->durations == NULL || self->num_durations_set == num_arcs)))
+        return true;
 
     for (size_t idx1 = 0; idx1 < num_nodes; idx1++) {
         size_t node_id1 = listu_get (self->node_ids, idx1);
@@ -1347,8 +3948,9 @@ static bool vrp_validate_roadgraph (vrp_t *self) {
 
             // All or none of arc distances should be set
             if (self->distances != NULL) {
-                double dist = vrp_arc_distance (self, node_id1, node_id2);
-                if (dist == DOUBLE_NONE) {
+                if (!arcmatrix_is_set (self->distances,
+                                       vrp_arc_row (self, node_id1),
+                                       vrp_arc_row (self, node_id2))) {
                     print_error ("Distance from node %s to node %s is not set.\n",
                                  vrp_node_ext_id (self, node_id1),
                                  vrp_node_ext_id (self, node_id2));
@@ -1357,9 +3959,20 @@ static bool vrp_validate_roadgraph (vrp_t *self) {
             }
 
             // All or none of arc durations should be set
-            if (self->durations != NULL) {
-                double duration = vrp_arc_duration (self, node_id1, node_id2);
-                if (duration == DOUBLE_NONE) {
+            if (self->td_durations != NULL) {
+                if (!tdarcs_is_set (self->td_durations,
+                                    vrp_arc_row (self, node_id1),
+                                    vrp_arc_row (self, node_id2))) {
+                    print_error ("Durations from node %s to node %s are not set.\n",
+                                 vrp_node_ext_id (self, node_id1),
+                                 vrp_node_ext_id (self, node_id2));
+                    return false;
+                }
+            }
+            else if (self->durations != NULL) {
+                if (!arcmatrix_is_set (self->durations,
+                                       vrp_arc_row (self, node_id1),
+                                       vrp_arc_row (self, node_id2))) {
                     print_error ("Duration from node %s to node %s is not set.\n",
                                  vrp_node_ext_id (self, node_id1),
                                  vrp_node_ext_id (self, node_id2));
@@ -1392,6 +4005,10 @@ static bool vrp_validate_requests (vrp_t *self) {
     if (num_requests == 0)
         return false;
 
+    // Only time windows are checked
+    if (self->num_pending_with_time_windows == 0)
+        return true;
+
     // Check pending requests
     for (size_t idx = 0; idx < num_requests; idx++) {
 
@@ -1403,7 +4020,7 @@ static bool vrp_validate_requests (vrp_t *self) {
         size_t num_dtw =
             vrp_num_time_windows (self, request_id, NR_RECEIVER);
 
-        if ((num_ptw > 0 || num_dtw > 0) && self->durations == NULL) {
+        if ((num_ptw > 0 || num_dtw > 0) && !vrp_arc_durations_defined (self)) {
             print_error ("Arc duration of roadgraph is not set.\n");
             return false;
         }
@@ -1451,8 +4068,6 @@ typedef struct {
     bool requests_are_all_pickup_and_delivery;
     bool requests_are_all_visiting_without_goods;
     bool time_windows_defined;
-    bool time_windows_are_same_for_single_sender; // relevant if single_sender is true
-    bool time_windows_are_same_for_single_receiver; // relevant if single_receiver is true
 
     bool single_vehicle;
     bool vehicles_start_at_same_node;
@@ -1465,116 +4080,56 @@ typedef struct {
 } s_attributes_t;
 
 
+// Attributes from counters, in O(1)
 static s_attributes_t vrp_collect_attributes (vrp_t *self) {
     s_attributes_t attr;
 
     // Roadgraph
 
-    attr.arc_distances_defined = (self->distances != NULL);
-    attr.arc_durations_defined = (self->durations != NULL);
+    attr.arc_distances_defined = vrp_arc_distances_defined (self);
+    attr.arc_durations_defined = vrp_arc_durations_defined (self);
 
     // Requests
 
-    attr.single_sender = true;
-    attr.single_receiver = true;
-    attr.requests_are_all_pickup_and_delivery = true;
-    attr.requests_are_all_visiting_without_goods = true;
-    attr.time_windows_defined = false;
-    attr.time_windows_are_same_for_single_sender = true;
-    attr.time_windows_are_same_for_single_receiver = true;
-
     size_t num_requests = listu_size (self->pending_request_ids);
     assert (num_requests > 0);
 
-    size_t single_sender_id = ID_NONE;
-    size_t single_receiver_id = ID_NONE;
-    size_t first_request_id = ID_NONE;
-
-    for (size_t idx = 0; idx < num_requests; idx++) {
-        size_t request_id = listu_get (self->pending_request_ids, idx);
-        if (first_request_id == ID_NONE)
-            first_request_id = request_id;
-        s_request_t *request = vrp_request (self, request_id);
-
-        // request type
-        if (request->type != RT_PD)
-            attr.requests_are_all_pickup_and_delivery = false;
-        if (request->type != RT_VISIT || request->quantity > 0)
-            attr.requests_are_all_visiting_without_goods = false;
-
-        // sender and receiver node
-        if (single_sender_id == ID_NONE)
-            single_sender_id = request->sender_id;
-        if (single_sender_id != request->sender_id)
-            attr.single_sender = false;
-
-        if (single_receiver_id == ID_NONE)
-            single_receiver_id = request->receiver_id;
-        if (single_receiver_id != request->receiver_id)
-            attr.single_receiver = false;
-
-        // time windows
-        if (vrp_num_time_windows (self, request_id, NR_SENDER) > 0 ||
-            vrp_num_time_windows (self, request_id, NR_RECEIVER) > 0)
-            attr.time_windows_defined = true;
-
-        if (attr.single_sender &&
-            attr.time_windows_defined &&
-            request_id != first_request_id) {
-            if (!vrp_time_windows_are_equal (self,
-                                             first_request_id, NR_SENDER,
-                                             request_id, NR_SENDER))
-                attr.time_windows_are_same_for_single_sender = false;
-        }
-
-        if (attr.single_receiver &&
-            attr.time_windows_defined &&
-            request_id != first_request_id) {
-            if (!vrp_time_windows_are_equal (self,
-                                             first_request_id, NR_RECEIVER,
-                                             request_id, NR_RECEIVER))
-                attr.time_windows_are_same_for_single_receiver = false;
-        }
-    }
+    attr.requests_are_all_pickup_and_delivery =
+        (self->num_pending_pd == num_requests);
+    attr.requests_are_all_visiting_without_goods =
+        (self->num_pending_plain_visits == num_requests);
+    attr.time_windows_defined = (self->num_pending_with_time_windows > 0);
+
+    // Requests share sender (receiver) node, or none of them has one
+    size_t num_senders = listu_size (self->sender_ids);
+    size_t num_receivers = listu_size (self->receiver_ids);
+    attr.single_sender =
+        num_senders <= 1 &&
+        (num_senders == 0 || self->num_pending_with_sender == num_requests);
+    attr.single_receiver =
+        num_receivers <= 1 &&
+        (num_receivers == 0 ||
+         self->num_pending_with_receiver == num_requests);
+    size_t single_sender_id =
+        (num_senders == 1) ? listu_get (self->sender_ids, 0) : ID_NONE;
+    size_t single_receiver_id =
+        (num_receivers == 1) ? listu_get (self->receiver_ids, 0) : ID_NONE;
 
     // Vehicles
 
     size_t num_vehicles = listu_size (self->vehicle_ids);
     assert (num_vehicles > 0);
-    assert (num_vehicles == vrp_num_vehicles (self));
     attr.single_vehicle = (num_vehicles == 1);
-    attr.vehicles_have_same_capacity = true;
-    attr.vehicles_start_at_same_node = true;
-    attr.vehicles_end_at_same_node = true;
+    attr.vehicles_have_same_capacity = self->vehicles_have_same_capacity;
+    attr.vehicles_start_at_same_node = self->vehicles_start_at_same_node;
+    attr.vehicles_end_at_same_node = self->vehicles_end_at_same_node;
     attr.vehicles_start_at_single_sender = false;
     attr.vehicles_end_at_single_sender = false;
     attr.vehicles_start_at_single_receiver = false;
     attr.vehicles_end_at_single_receiver = false;
 
-    double capacity = DOUBLE_NONE;
-    size_t start_node_id = ID_NONE;
-    size_t end_node_id = ID_NONE;
-
-    for (size_t idx = 0; idx < num_vehicles; idx++) {
-        size_t vehicle_id = listu_get (self->vehicle_ids, idx);
-        s_vehicle_t *vehicle = vrp_vehicle (self, vehicle_id);
-
-        // capacity
-        if (double_is_none (capacity))
-            capacity = vehicle->capacity;
-        if (!double_equal (capacity, vehicle->capacity))
-            attr.vehicles_have_same_capacity = false;
-
-        // start and end node
-        if (start_node_id == ID_NONE && vehicle->start_node_id != ID_NONE)
-            start_node_id = vehicle->start_node_id;
-        if (start_node_id != ID_NONE && vehicle->start_node_id != start_node_id)
-            attr.vehicles_start_at_same_node = false;
-        if (end_node_id == ID_NONE && vehicle->end_node_id != ID_NONE)
-            end_node_id = vehicle->end_node_id;
-        if (end_node_id != ID_NONE && vehicle->end_node_id != end_node_id)
-            attr.vehicles_end_at_same_node = false;
-    }
+    size_t start_node_id = self->fleet_start_node_id;
+    size_t end_node_id = self->fleet_end_node_id;
 
     // for single linehaul depot case
     if (attr.single_sender) {
@@ -1634,6 +4189,245 @@ static bool vrp_is_vrptw (const vrp_t *self, const s_attributes_t *attr) {
 }
 
 
+// ---------------------------------------------------------------------------
+// Customer aggregation
+// ---------------------------------------------------------------------------
+
+// Sort key of pending request: requests which may be merged are adjacent
+typedef struct {
+    size_t sender;
+    bool has_coord;
+    coord2d_t coord; // coordinates of receiver
+    const s_time_windows_t *time_windows; // delivery time windows
+    size_t receiver;
+    size_t request;
+} s_customer_key_t;
+
+
+static int s_customer_key_compare (const void *a, const void *b) {
+    const s_customer_key_t *k1 = (const s_customer_key_t *) a;
+    const s_customer_key_t *k2 = (const s_customer_key_t *) b;
+    if (k1->sender != k2->sender)
+        return (k1->sender < k2->sender) ? -1 : 1;
+    if (k1->has_coord != k2->has_coord)
+        return k1->has_coord ? -1 : 1;
+    if (k1->has_coord) {
+        if (k1->coord.v1 != k2->coord.v1)
+            return (k1->coord.v1 < k2->coord.v1) ? -1 : 1;
+        if (k1->coord.v2 != k2->coord.v2)
+            return (k1->coord.v2 < k2->coord.v2) ? -1 : 1;
+    }
+    else if (k1->receiver != k2->receiver)
+        return (k1->receiver < k2->receiver) ? -1 : 1;
+
+    const s_time_windows_t *tws1 = k1->time_windows;
+    const s_time_windows_t *tws2 = k2->time_windows;
+    if (tws1->size != tws2->size)
+        return (tws1->size < tws2->size) ? -1 : 1;
+    const size_t *values1 = s_time_windows_values (tws1);
+    const size_t *values2 = s_time_windows_values (tws2);
+    for (size_t idx = 0; idx < tws1->size; idx++) {
+        if (values1[idx] != values2[idx])
+            return (values1[idx] < values2[idx]) ? -1 : 1;
+    }
+
+    if (k1->receiver != k2->receiver)
+        return (k1->receiver < k2->receiver) ? -1 : 1;
+    return (k1->request < k2->request) ? -1 :
+           ((k1->request > k2->request) ? 1 : 0);
+}
+
+
+// Requests in the same place with equal time windows
+static bool s_customer_keys_match (const s_customer_key_t *k1,
+                                   const s_customer_key_t *k2) {
+    return k1->sender == k2->sender &&
+           k1->has_coord == k2->has_coord &&
+           (k1->has_coord ?
+            k1->coord.v1 == k2->coord.v1 && k1->coord.v2 == k2->coord.v2 :
+            k1->receiver == k2->receiver) &&
+           s_time_windows_equal (k1->time_windows, k2->time_windows);
+}
+
+
+// Merge pending requests into customers, in O(n log n). Merged quantity
+// must fit the smallest vehicle capacity: requests to a co-located receiver
+// which do not fit start a new customer. Requests to the same receiver can
+// not be split, as submodels identify customers by node.
+// Return false if those exceed capacity.
+static bool vrp_aggregate_customers (vrp_t *self) {
+    if (self->customer_fields_size < self->request_fields_size) {
+        size_t old_size = self->customer_fields_size;
+        size_t size = self->request_fields_size;
+        self->request_customers =
+            vrp_resize_field (self, self->request_customers, old_size, size,
+                              sizeof (size_t));
+        self->merged_request_ids =
+            vrp_resize_field (self, self->merged_request_ids, old_size, size,
+                              sizeof (size_t));
+        self->customer_quantities =
+            vrp_resize_field (self, self->customer_quantities, old_size, size,
+                              sizeof (double));
+        self->customer_durations =
+            vrp_resize_field (self, self->customer_durations, old_size, size,
+                              sizeof (size_t));
+        self->customer_fields_size = size;
+    }
+    if (self->customer_request_ids == NULL)
+        self->customer_request_ids = listu_new (0);
+    listu_purge (self->customer_request_ids);
+
+    size_t num_requests = listu_size (self->pending_request_ids);
+    const size_t *request_ids = listu_array (self->pending_request_ids);
+    s_customer_key_t *keys =
+        (s_customer_key_t *) malloc ((num_requests + 1) *
+                                     sizeof (s_customer_key_t));
+    assert (keys);
+    for (size_t cnt = 0; cnt < num_requests; cnt++) {
+        size_t id = request_ids[cnt];
+        s_customer_key_t *key = &keys[cnt];
+        key->sender = self->request_senders[id];
+        key->receiver = self->request_receivers[id];
+        key->has_coord = (key->receiver != ID_NONE &&
+                          !coord2d_is_none (vrp_coord (self, key->receiver)));
+        if (key->has_coord)
+            key->coord = *vrp_coord (self, key->receiver);
+        key->time_windows = &self->delivery_time_windows[id];
+        key->request = id;
+    }
+    qsort (keys, num_requests, sizeof (s_customer_key_t),
+           s_customer_key_compare);
+
+    // Any vehicle may serve a customer
+    double capacity = DOUBLE_MAX;
+    for (size_t cnt = 0; cnt < listu_size (self->vehicle_ids); cnt++) {
+        size_t vehicle_id = listu_get (self->vehicle_ids, cnt);
+        capacity = min2 (capacity, self->vehicle_max_capacities[vehicle_id]);
+    }
+
+    // Requests of a receiver are adjacent, and so are receivers in the same
+    // place. Customer of a place moves on when capacity is exceeded.
+    size_t customer = ID_NONE, last_merged = ID_NONE;
+    bool fits = true;
+    for (size_t cnt = 0; cnt < num_requests; cnt++) {
+        const s_customer_key_t *key = &keys[cnt];
+        size_t id = key->request;
+        bool merged = false;
+        if (customer != ID_NONE && key->receiver != ID_NONE &&
+            s_customer_keys_match (key, &keys[cnt - 1])) {
+            size_t receiver = self->request_receivers[customer];
+            bool merge_fits = self->customer_quantities[customer] +
+                              self->request_quantities[id] <= capacity;
+            if (key->receiver == receiver) {
+                merged = true;
+                if (!merge_fits && fits) {
+                    print_error ("Pending requests to node %s exceed "
+                                 "vehicle capacity.\n",
+                                 vrp_node_ext_id (self, receiver));
+                    fits = false;
+                }
+            }
+            else
+                merged =
+                    merge_fits &&
+                    vrp_arc_distance (self, receiver, key->receiver) == 0 &&
+                    vrp_arc_distance (self, key->receiver, receiver) == 0;
+        }
+
+        self->merged_request_ids[id] = ID_NONE;
+        if (merged) {
+            self->request_customers[id] = customer;
+            self->merged_request_ids[last_merged] = id;
+            self->customer_quantities[customer] +=
+                self->request_quantities[id];
+            self->customer_durations[customer] +=
+                self->delivery_durations[id];
+        }
+        else {
+            customer = id;
+            self->request_customers[id] = id;
+            self->customer_quantities[id] = self->request_quantities[id];
+            self->customer_durations[id] = self->delivery_durations[id];
+            listu_append (self->customer_request_ids, id);
+        }
+        last_merged = id;
+    }
+    free (keys);
+    listu_sort (self->customer_request_ids, true);
+
+    size_t num_customers = listu_size (self->customer_request_ids);
+    if (num_customers < num_requests)
+        print_info ("%zu requests merged into %zu customers.\n",
+                    num_requests, num_customers);
+    return fits;
+}
+
+
+// Visit receivers of requests merged into customers right after them
+static void vrp_expand_customers (vrp_t *self, solution_t *sol) {
+    if (sol == NULL || listu_size (self->customer_request_ids) ==
+                       listu_size (self->pending_request_ids))
+        return;
+
+    // Customer of node, and next customer of the same receiver
+    size_t num_customers = listu_size (self->customer_request_ids);
+    const size_t *customers = listu_array (self->customer_request_ids);
+    size_t id_bound = listu_last (self->node_ids) + 1;
+    size_t *node_customers =
+        (size_t *) malloc ((id_bound + num_customers) * sizeof (size_t));
+    assert (node_customers);
+    size_t *next_customers = node_customers + id_bound;
+    for (size_t id = 0; id < id_bound; id++)
+        node_customers[id] = ID_NONE;
+    for (size_t cnt = num_customers; cnt-- > 0;) {
+        size_t receiver = self->request_receivers[customers[cnt]];
+        next_customers[cnt] = node_customers[receiver];
+        node_customers[receiver] = cnt;
+    }
+
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        route_t *route = solution_route (sol, idx_r);
+        for (size_t idx = 0; idx < route_size (route); idx++) {
+            size_t node = route_at (route, idx);
+            size_t cnt = node_customers[node];
+            if (cnt == ID_NONE)
+                continue;
+            node_customers[node] = next_customers[cnt];
+            for (size_t id = self->merged_request_ids[customers[cnt]];
+                 id != ID_NONE;
+                 id = self->merged_request_ids[id])
+                route_insert_node (route, ++idx, self->request_receivers[id]);
+        }
+    }
+    free (node_customers);
+
+    // Total is recalculated from arcs rather than assumed unchanged
+    solution_cal_set_total_distance (sol, self,
+                                     (vrp_arc_distance_t) vrp_arc_distance);
+}
+
+
+const listu_t *vrp_customer_request_ids (vrp_t *self) {
+    assert (self);
+    assert (self->customer_request_ids);
+    return self->customer_request_ids;
+}
+
+
+double vrp_customer_quantity (vrp_t *self, size_t request_id) {
+    assert (self);
+    assert (request_id < self->customer_fields_size);
+    return self->customer_quantities[self->request_customers[request_id]];
+}
+
+
+size_t vrp_customer_service_duration (vrp_t *self, size_t request_id) {
+    assert (self);
+    assert (request_id < self->customer_fields_size);
+    return self->customer_durations[self->request_customers[request_id]];
+}
+
+
 solution_t *vrp_solve (vrp_t *self) {
     assert (self);
 
@@ -1655,17 +4449,35 @@ solution_t *vrp_solve (vrp_t *self) {
     }
     else if (vrp_is_cvrp (self, &attr)) {
         print_info ("Submodel detected: CVRP\n");
+        if (!vrp_aggregate_customers (self))
+            return NULL;
         cvrp_t *model = cvrp_new_from_generic (self);
         assert (model);
         sol = cvrp_solve (model);
+        // Routes from depot are warm start for vehicles with fixed prefix
+        if (vrp_num_fixed_vehicles (self) > 0) {
+            solution_t *planned = sol;
+            sol = cvrp_resolve (model, planned);
+            solution_free (&planned);
+        }
         cvrp_free (&model);
+        vrp_expand_customers (self, sol);
     }
     else if (vrp_is_vrptw (self, &attr)) {
         print_info ("Submodel detected: VRPTW\n");
+        if (!vrp_aggregate_customers (self))
+            return NULL;
         vrptw_t *model = vrptw_new_from_generic (self);
         assert (model);
         sol = vrptw_solve (model);
+        // Routes from depot are warm start for vehicles with fixed prefix
+        if (vrp_num_fixed_vehicles (self) > 0) {
+            solution_t *planned = (sol != NULL) ? sol : solution_new ();
+            sol = vrptw_resolve (model, planned);
+            solution_free (&planned);
+        }
         vrptw_free (&model);
+        vrp_expand_customers (self, sol);
     }
     else
         print_error ("Unsupported model. Problem Not solved.\n");
@@ -1674,25 +4486,838 @@ solution_t *vrp_solve (vrp_t *self) {
 }
 
 
+solution_t *vrp_resolve (vrp_t *self, const solution_t *previous) {
+    assert (self);
+    if (previous == NULL)
+        return vrp_solve (self);
+
+    if (!vrp_validate (self)) {
+        print_error ("Model validation failed.\n");
+        return NULL;
+    }
+
+    s_attributes_t attr = vrp_collect_attributes (self);
+
+    // Submodels without warm start are solved from scratch
+    solution_t *sol = NULL;
+    if (vrp_is_tsp (self, &attr))
+        sol = vrp_solve (self);
+    else if (vrp_is_cvrp (self, &attr)) {
+        print_info ("Submodel detected: CVRP (warm start)\n");
+        if (!vrp_aggregate_customers (self))
+            return NULL;
+        cvrp_t *model = cvrp_new_from_generic (self);
+        assert (model);
+        sol = cvrp_resolve (model, previous);
+        cvrp_free (&model);
+        vrp_expand_customers (self, sol);
+    }
+    else if (vrp_is_vrptw (self, &attr)) {
+        print_info ("Submodel detected: VRPTW (warm start)\n");
+        if (!vrp_aggregate_customers (self))
+            return NULL;
+        vrptw_t *model = vrptw_new_from_generic (self);
+        assert (model);
+        sol = vrptw_resolve (model, previous);
+        vrptw_free (&model);
+        vrp_expand_customers (self, sol);
+    }
+    else
+        print_error ("Unsupported model. Problem Not solved.\n");
+
+    return sol;
+}
+
+
+// Write content to a temporary input file
+static void s_test_write_file (const char *filename, const char *content) {
+    FILE *file = fopen (filename, "w");
+    assert (file);
+    fputs (content, file);
+    fclose (file);
+}
+
+
+// ---------------------------------------------------------------------------
+// Self test helpers
+
+// Model of customers scattered around depot at deterministic positions.
+// Requests get time windows and service durations if with_time_windows.
+static vrp_t *s_test_model (size_t num_customers, bool with_time_windows) {
+    vrp_t *vrp = vrp_new ();
+    assert (vrp);
+    vrp_set_coord_sys (vrp, CS_CARTESIAN2D);
+
+    size_t depot = vrp_add_node (vrp, "depot");
+    vrp_set_node_coord (vrp, depot, (coord2d_t) {50, 50});
+    char ext_id[32];
+    for (size_t idx = 0; idx < num_customers; idx++) {
+        sprintf (ext_id, "node%zu", idx);
+        size_t node = vrp_add_node (vrp, ext_id);
+        vrp_set_node_coord (vrp, node,
+                            (coord2d_t) {(idx * 37) % 101, (idx * 61) % 97});
+        sprintf (ext_id, "request%zu", idx);
+        size_t request =
+            vrp_add_request (vrp, ext_id, depot, node, 1 + idx % 9);
+        if (with_time_windows) {
+            size_t earliest = (idx * 53) % 600;
+            vrp_add_time_window (vrp, request, NR_SENDER, 0, 1000);
+            vrp_add_time_window (vrp, request, NR_RECEIVER,
+                                 earliest, earliest + 300);
+            vrp_set_service_duration (vrp, request, NR_RECEIVER, 10);
+        }
+    }
+    for (size_t idx = 0; idx < 10; idx++) {
+        sprintf (ext_id, "vehicle%zu", idx);
+        vrp_add_vehicle (vrp, ext_id, 30, depot, depot);
+    }
+
+    // Rounded as in TSPLIB instances, so that solver costs are exact
+    vrp_set_integer_distances (vrp, true);
+    vrp_generate_beeline_distances (vrp);
+    if (with_time_windows)
+        vrp_generate_durations (vrp, 1.0);
+    return vrp;
+}
+
+
+// Check that each pending request of model is served exactly once
+static void s_test_check_served (vrp_t *vrp, const solution_t *sol) {
+    assert (sol);
+    const listu_t *requests = vrp_pending_request_ids (vrp);
+    for (size_t idx = 0; idx < listu_size (requests); idx++) {
+        size_t receiver =
+            vrp_request_receiver (vrp, listu_get (requests, idx));
+        size_t cnt = 0;
+        solution_iterator_t iter = solution_iter_init (sol);
+        size_t node;
+        while ((node = solution_iter_node (sol, &iter)) != ID_NONE) {
+            if (node == receiver)
+                cnt++;
+        }
+        assert (cnt == 1);
+    }
+}
+
+
+// Number of routes of solution which start with depot and stops
+static size_t s_test_num_routes_with_prefix (const solution_t *sol,
+                                             size_t depot,
+                                             const size_t *stops,
+                                             size_t num_stops) {
+    size_t cnt = 0;
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        const route_t *route = solution_route (sol, idx_r);
+        if (route_size (route) < num_stops + 2 || route_at (route, 0) != depot)
+            continue;
+        size_t idx = 0;
+        while (idx < num_stops && route_at (route, idx + 1) == stops[idx])
+            idx++;
+        if (idx == num_stops)
+            cnt++;
+    }
+    return cnt;
+}
+
+
+// Fix first two stops of a route of solved model, then check that warm and
+// cold start keep the prefix and serve the rest
+static void s_test_fixed_prefix (vrp_t *vrp) {
+    solution_t *sol = vrp_solve (vrp);
+    assert (sol);
+    const route_t *route = solution_route (sol, 0);
+    assert (route_size (route) >= 4);
+    size_t depot = route_at (route, 0);
+    size_t stops[2] = {route_at (route, 1), route_at (route, 2)};
+
+    // Vehicle leaves second stop after serving both
+    size_t departure_time = 0, predecessor = depot;
+    for (size_t idx = 0; idx < 2; idx++) {
+        size_t request =
+            listu_get (vrp_node_pending_request_ids (vrp, stops[idx]), 0);
+        if (vrp_num_time_windows (vrp, request, NR_RECEIVER) == 0)
+            break;
+        departure_time += vrp_arc_duration (vrp, predecessor, stops[idx]);
+        departure_time =
+            max2 (departure_time,
+                  vrp_earliest_service_time (vrp, request, NR_RECEIVER)) +
+            vrp_service_duration (vrp, request, NR_RECEIVER);
+        predecessor = stops[idx];
+    }
+
+    size_t vehicle = listu_get (vrp_vehicles (vrp), 0);
+    size_t twice[2] = {stops[0], stops[0]};
+    assert (vrp_fix_route_prefix (vrp, vehicle, twice, 2, 0) == -1);
+    assert (vrp_fix_route_prefix (vrp, vehicle, &depot, 1, 0) == -1);
+    assert (vrp_fix_route_prefix (vrp, vehicle, stops, 2, departure_time) == 0);
+    assert (vrp_num_fixed_vehicles (vrp) == 1);
+    assert (vrp_fix_route_prefix (vrp, vehicle, stops, 2, 0) == -1);
+
+    solution_t *warm = vrp_resolve (vrp, sol);
+    s_test_check_served (vrp, warm);
+    assert (s_test_num_routes_with_prefix (warm, depot, stops, 2) == 1);
+
+    solution_t *cold = vrp_solve (vrp);
+    s_test_check_served (vrp, cold);
+    assert (s_test_num_routes_with_prefix (cold, depot, stops, 2) == 1);
+
+    // Vehicle has moved on: its GPS position is a node without request
+    size_t position = vrp_add_node (vrp, "position");
+    const coord2d_t *coord = vrp_node_coord (vrp, stops[1]);
+    vrp_set_node_coord (vrp, position,
+                        (coord2d_t) {coord->v1 + 1, coord->v2 + 1});
+    vrp_generate_node_beeline_arcs (vrp, position);
+    assert (vrp_fix_route_prefix (vrp, vehicle, &position, 1,
+                                  departure_time + 2) == 0);
+    assert (vrp_fix_route_prefix (vrp, vehicle, &position, 1, 0) == -1);
+    size_t prefix[3] = {stops[0], stops[1], position};
+    solution_t *moved = vrp_solve (vrp);
+    s_test_check_served (vrp, moved);
+    assert (s_test_num_routes_with_prefix (moved, depot, prefix, 3) == 1);
+
+    solution_free (&sol);
+    solution_free (&warm);
+    solution_free (&cold);
+    solution_free (&moved);
+}
+
+
+// Fixed route prefix of TSP: stops and current position are kept
+static void s_test_tsp_prefix (size_t num_nodes) {
+    vrp_t *vrp = vrp_new ();
+    vrp_set_coord_sys (vrp, CS_CARTESIAN2D);
+    size_t depot = vrp_add_node (vrp, "depot");
+    vrp_set_node_coord (vrp, depot, (coord2d_t) {50, 50});
+    char ext_id[32];
+    for (size_t idx = 0; idx < num_nodes; idx++) {
+        sprintf (ext_id, "node%zu", idx);
+        size_t node = vrp_add_node (vrp, ext_id);
+        vrp_set_node_coord (vrp, node,
+                            (coord2d_t) {(idx * 37) % 101, (idx * 61) % 97});
+        vrp_add_request (vrp, ext_id, ID_NONE, node, 0);
+    }
+    size_t vehicle = vrp_add_vehicle (vrp, "vehicle", DOUBLE_MAX,
+                                      depot, depot);
+    vrp_set_integer_distances (vrp, true);
+    vrp_generate_beeline_distances (vrp);
+
+    // Stops far from the start of an optimal route
+    size_t stops[3] = {vrp_query_node (vrp, "node3"),
+                       vrp_query_node (vrp, "node0"),
+                       vrp_add_node (vrp, "position")};
+    vrp_set_node_coord (vrp, stops[2], (coord2d_t) {90, 10});
+    vrp_generate_node_beeline_arcs (vrp, stops[2]);
+    assert (vrp_fix_route_prefix (vrp, vehicle, stops, 3, 0) == 0);
+
+    solution_t *sol = vrp_solve (vrp);
+    s_test_check_served (vrp, sol);
+    assert (s_test_num_routes_with_prefix (sol, depot, stops, 3) == 1);
+    solution_free (&sol);
+    vrp_free (&vrp);
+}
+
+
+// Bulk ingestion: IDs follow input order, and existing external IDs are
+// skipped
+static void s_test_bulk_add (void) {
+    vrp_t *vrp = vrp_new ();
+    vrp_set_coord_sys (vrp, CS_CARTESIAN2D);
+    size_t depot = vrp_add_node (vrp, "depot");
+
+    const char *node_ext_ids[] = {"a", "depot", "b", "c"};
+    coord2d_t coords[] = {{1, 1}, {0, 0}, {2, 2}, {3, 3}};
+    size_t node_ids[4];
+    assert (vrp_add_nodes (vrp, node_ext_ids, coords, 4, node_ids) == 3);
+    assert (node_ids[0] == depot + 1);
+    assert (node_ids[1] == ID_NONE);
+    assert (node_ids[2] == depot + 2);
+    assert (node_ids[3] == depot + 3);
+    assert (vrp_num_nodes (vrp) == 4);
+    assert (vrp_query_node (vrp, "c") == node_ids[3]);
+    assert (vrp_node_coord (vrp, node_ids[2])->v1 == 2);
+
+    const char *vehicle_ext_ids[] = {"v1", "v2"};
+    double capacities[] = {10, 10};
+    size_t vehicle_ids[2];
+    assert (vrp_add_vehicles (vrp, vehicle_ext_ids, capacities,
+                              NULL, NULL, 2, vehicle_ids) == 2);
+    assert (vehicle_ids[1] == vehicle_ids[0] + 1);
+    assert (vrp_num_vehicles (vrp) == 2);
+
+    const char *request_ext_ids[] = {"r3", "r1", "r2"};
+    size_t senders[] = {depot, depot, depot};
+    size_t receivers[] = {node_ids[3], node_ids[0], node_ids[2]};
+    double quantities[] = {3, 1, 2};
+    size_t request_ids[3];
+    assert (vrp_add_requests (vrp, request_ext_ids, senders, receivers,
+                              quantities, 3, request_ids) == 3);
+    for (size_t idx = 0; idx < 3; idx++) {
+        if (idx > 0)
+            assert (request_ids[idx] == request_ids[idx - 1] + 1);
+        assert (vrp_request_receiver (vrp, request_ids[idx]) == receivers[idx]);
+        assert (vrp_request_quantity (vrp, request_ids[idx]) ==
+                quantities[idx]);
+        assert (listu_get (vrp_pending_request_ids (vrp), idx) ==
+                request_ids[idx]);
+    }
+    assert (vrp_query_request (vrp, "r1") == request_ids[1]);
+
+    size_t earliests[] = {0, 10, 20};
+    size_t latests[] = {100, 110, 120};
+    assert (vrp_add_time_windows (vrp, request_ids, NR_RECEIVER,
+                                  earliests, latests, 3) == 3);
+    assert (vrp_earliest_service_time (vrp, request_ids[2], NR_RECEIVER) ==
+            20);
+
+    vrp_free (&vrp);
+}
+
+
+// Solomon VRPTW file: depot, one request per customer, and fleet
+static void s_test_solomon (void) {
+    // First customers of R101
+    const char *filename = "vrp-test-solomon.txt";
+    s_test_write_file (filename,
+        "R101\n"
+        "\n"
+        "VEHICLE\n"
+        "NUMBER     CAPACITY\n"
+        "  25         200\n"
+        "\n"
+        "CUSTOMER\n"
+        "CUST NO.  XCOORD.   YCOORD.    DEMAND   READY TIME  DUE DATE   "
+        "SERVICE   TIME\n"
+        "\n"
+        "    0      35         35          0          0        230"
+        "          0\n"
+        "    1      41         49         10        161        171"
+        "         10\n"
+        "    2      35         17          7         50         60"
+        "         10\n"
+        "    3      55         45         13        116        126"
+        "         10\n"
+        "    4      55         20         19        149        159"
+        "         10\n");
+    vrp_t *vrp = vrp_new_from_file (filename);
+    remove (filename);
+    assert (vrp);
+    assert (vrp_num_nodes (vrp) == 5);
+    assert (vrp_num_requests (vrp) == 4);
+    assert (listu_size (vrp_pending_request_ids (vrp)) == 4);
+    assert (vrp_num_vehicles (vrp) == 25);
+    assert (vrp_vehicle_max_capacity (vrp,
+                                      listu_get (vrp_vehicles (vrp), 0)) ==
+            200);
+
+    // Customer 1: 41 49 10 161 171 10
+    size_t request = vrp_query_request (vrp, "node-0001");
+    assert (request != ID_NONE);
+    size_t depot = vrp_request_sender (vrp, request);
+    assert (depot == vrp_query_node (vrp, "node-0000"));
+    assert (vrp_node_coord (vrp, vrp_request_receiver (vrp, request))->v1 ==
+            41);
+    assert (vrp_request_quantity (vrp, request) == 10);
+    assert (vrp_num_time_windows (vrp, request, NR_RECEIVER) == 1);
+    assert (vrp_earliest_service_time (vrp, request, NR_RECEIVER) == 161);
+    assert (vrp_latest_service_time (vrp, request, NR_RECEIVER) == 171);
+    assert (vrp_service_duration (vrp, request, NR_RECEIVER) == 10);
+    assert (vrp_latest_service_time (vrp, request, NR_SENDER) == 230);
+    assert (vrp_arc_duration (vrp, depot, depot) == 0);
+
+    // Customer 3 at (55, 45): sqrt (500) from depot
+    size_t node = vrp_query_node (vrp, "node-0003");
+    assert (fabs (vrp_arc_distance (vrp, depot, node) - sqrt (500)) < 1e-6);
+    assert (vrp_arc_duration (vrp, node, depot) == 22);
+
+    assert (vrp_new_from_file (filename) == NULL);
+    vrp_free (&vrp);
+}
+
+
+// TSPLIB files: explicit edge weight formats, coordinate distance types, and
+// depot section
+static void s_test_tsplib (void) {
+    const char *filename = "vrp-test.tsp";
+    char content[512];
+
+    // Symmetric matrix of 4 nodes in each triangular format, and an
+    // asymmetric one in full
+    const double symmetric[4][4] = {
+        {0, 10, 20, 30}, {10, 0, 40, 50}, {20, 40, 0, 60}, {30, 50, 60, 0}
+    };
+    const double full[4][4] = {
+        {0, 1, 2, 3}, {4, 0, 5, 6}, {7, 8, 0, 9}, {10, 11, 12, 0}
+    };
+    struct {
+        const char *format;
+        const char *weights;
+        const double (*expected)[4];
+    } explicit_cases[] = {
+        {"FULL_MATRIX", "0 1 2 3\n4 0 5 6\n7 8 0 9\n10 11 12 0\n", full},
+        {"UPPER_ROW", "10 20 30\n40 50\n60\n", symmetric},
+        {"UPPER_DIAG_ROW", "0 10 20 30\n0 40 50\n0 60\n0\n", symmetric},
+        {"LOWER_DIAG_ROW", "0\n10 0\n20 40 0\n30 50 60 0\n", symmetric},
+        {"LOWER_ROW", "10\n20 40\n30 50 60\n", symmetric}
+    };
+    for (size_t k = 0; k < sizeof (explicit_cases) / sizeof (explicit_cases[0]);
+         k++) {
+        sprintf (content,
+                 "NAME : x\nTYPE : TSP\nDIMENSION : 4\n"
+                 "EDGE_WEIGHT_TYPE : EXPLICIT\nEDGE_WEIGHT_FORMAT : %s\n"
+                 "EDGE_WEIGHT_SECTION\n%sEOF\n",
+                 explicit_cases[k].format, explicit_cases[k].weights);
+        s_test_write_file (filename, content);
+        vrp_t *vrp = vrp_new_from_file (filename);
+        assert (vrp);
+        assert (vrp_num_nodes (vrp) == 4);
+        assert (vrp_num_requests (vrp) == 4);
+        assert (vrp_num_vehicles (vrp) == 1);
+        for (size_t i = 0; i < 4; i++)
+            for (size_t j = 0; j < 4; j++)
+                assert (vrp_arc_distance (vrp, i, j) ==
+                        explicit_cases[k].expected[i][j]);
+        vrp_free (&vrp);
+    }
+
+    // Distances of 3 nodes computed from coordinates
+    struct {
+        const char *type;
+        const char *coords;
+        double d10, d20, d21;
+    } coord_cases[] = {
+        // ceil (sqrt (2)), 5, ceil (sqrt (13))
+        {"CEIL_2D", "1 0 0\n2 1 1\n3 3 4\n", 2, 5, 4},
+        // sqrt (10) rounded up, sqrt (1000) and sqrt (1010) rounded
+        {"ATT", "1 0 0\n2 10 0\n3 0 100\n", 4, 32, 32},
+        // DDD.MM: 10.30 is 10.5 degrees. 10.5 degrees of equator is
+        // 1168.9 km, and 45.5 degrees of meridian 5065.1 km.
+        {"GEO", "1 0.0 0.0\n2 0.0 10.30\n3 45.30 10.30\n", 1169, 5170, 5066}
+    };
+    for (size_t k = 0; k < sizeof (coord_cases) / sizeof (coord_cases[0]);
+         k++) {
+        sprintf (content,
+                 "NAME : x\nTYPE : TSP\nDIMENSION : 3\n"
+                 "EDGE_WEIGHT_TYPE : %s\nNODE_COORD_SECTION\n%sEOF\n",
+                 coord_cases[k].type, coord_cases[k].coords);
+        s_test_write_file (filename, content);
+        vrp_t *vrp = vrp_new_from_file (filename);
+        assert (vrp);
+        assert (vrp_arc_distance (vrp, 1, 0) == coord_cases[k].d10);
+        assert (vrp_arc_distance (vrp, 0, 2) == coord_cases[k].d20);
+        assert (vrp_arc_distance (vrp, 2, 1) == coord_cases[k].d21);
+        if (strcmp (coord_cases[k].type, "GEO") == 0) {
+            assert (vrp_coord_sys (vrp) == CS_WGS84);
+            assert (fabs (vrp_node_coord (vrp, 2)->v1 - 45.5) < 1e-9);
+        }
+        vrp_free (&vrp);
+    }
+    remove (filename);
+
+    // Only the first depot is used, and it gets no request
+    filename = "vrp-test-k1.vrp";
+    s_test_write_file (filename,
+        "NAME : x\nTYPE : CVRP\nDIMENSION : 4\n"
+        "EDGE_WEIGHT_TYPE : EUC_2D\nCAPACITY : 10\n"
+        "NODE_COORD_SECTION\n1 0 0\n2 3 4\n3 6 8\n4 0 8\n"
+        "DEMAND_SECTION\n1 2\n2 3\n3 0\n4 4\n"
+        "DEPOT_SECTION\n3\n1\n-1\nEOF\n");
+    vrp_t *vrp = vrp_new_from_file (filename);
+    remove (filename);
+    assert (vrp);
+    size_t depot = vrp_query_node (vrp, "node-0003");
+    assert (vrp_num_requests (vrp) == 3);
+    assert (vrp_query_request (vrp, "node-0003") == ID_NONE);
+    size_t request = vrp_query_request (vrp, "node-0001");
+    assert (vrp_request_sender (vrp, request) == depot);
+    assert (vrp_request_quantity (vrp, request) == 2);
+    size_t vehicle = listu_get (vrp_vehicles (vrp), 0);
+    assert (vrp_num_vehicles (vrp) == 1);
+    assert (vrp_vehicle_start_node_id (vrp, vehicle) == depot);
+    assert (vrp_vehicle_end_node_id (vrp, vehicle) == depot);
+    assert (vrp_arc_distance (vrp, depot, 0) == 10);
+    vrp_free (&vrp);
+}
+
+
+// Re-evaluation after arc updates: adjusted total distance equals the one
+// recalculated from arcs
+static void s_test_reevaluate (void) {
+    vrp_arc_distance_t arc_distance = (vrp_arc_distance_t) vrp_arc_distance;
+    vrp_t *vrp = s_test_model (20, false);
+    solution_t *sol = vrp_solve (vrp);
+    assert (sol);
+
+    const route_t *route = solution_route (sol, 0);
+    assert (route_size (route) >= 3);
+    size_t from_ids[3] = {route_at (route, 0), route_at (route, 1), 0};
+    size_t to_ids[3] = {route_at (route, 1), route_at (route, 2), 0};
+    double distances[3];
+    for (size_t idx = 0; idx < 2; idx++)
+        distances[idx] =
+            vrp_arc_distance (vrp, from_ids[idx], to_ids[idx]) + 7;
+    distances[2] = 0; // arc from depot to itself, not in solution
+
+    vrp_update_arcs (vrp, from_ids, to_ids, distances, NULL, 3);
+    assert (vrp_num_changed_arcs (vrp) == 3);
+    assert (vrp_reevaluate_solution (vrp, sol, NULL) >= 1);
+    assert (vrp_num_changed_arcs (vrp) == 0);
+    assert (solution_total_distance (sol) ==
+            solution_cal_total_distance (sol, vrp, arc_distance));
+
+    // Update of the same arc again is relative to the last evaluation
+    distances[0] -= 3;
+    vrp_update_arcs (vrp, from_ids, to_ids, distances, NULL, 1);
+    vrp_reevaluate_solution (vrp, sol, NULL);
+    assert (solution_total_distance (sol) ==
+            solution_cal_total_distance (sol, vrp, arc_distance));
+
+    solution_free (&sol);
+    vrp_free (&vrp);
+}
+
+
+// Warm start after requests are cancelled and added: every pending request
+// is served exactly once, and cancelled ones are not
+static void s_test_resolve (void) {
+    vrp_t *vrp = s_test_model (30, false);
+    solution_t *sol = vrp_solve (vrp);
+    s_test_check_served (vrp, sol);
+
+    const listu_t *pending = vrp_pending_request_ids (vrp);
+    size_t depot = vrp_request_sender (vrp, listu_get (pending, 0));
+    size_t cancelled[3];
+    for (size_t idx = 0; idx < 3; idx++)
+        cancelled[idx] = listu_get (pending, 5 * idx);
+    for (size_t idx = 0; idx < 3; idx++)
+        assert (vrp_cancel_request (vrp, cancelled[idx]) == 0);
+    assert (vrp_cancel_request (vrp, cancelled[0]) == -1);
+
+    char ext_id[32];
+    for (size_t idx = 0; idx < 3; idx++) {
+        sprintf (ext_id, "new-node%zu", idx);
+        size_t node = vrp_add_node (vrp, ext_id);
+        vrp_set_node_coord (vrp, node,
+                            (coord2d_t) {10 + 40 * idx, 90 - 30 * idx});
+        vrp_generate_node_beeline_arcs (vrp, node);
+        sprintf (ext_id, "new-request%zu", idx);
+        vrp_add_request (vrp, ext_id, depot, node, 5);
+    }
+
+    solution_t *resolved = vrp_resolve (vrp, sol);
+    s_test_check_served (vrp, resolved);
+    for (size_t idx = 0; idx < 3; idx++) {
+        size_t receiver = vrp_request_receiver (vrp, cancelled[idx]);
+        solution_iterator_t iter = solution_iter_init (resolved);
+        size_t node;
+        while ((node = solution_iter_node (resolved, &iter)) != ID_NONE)
+            assert (node != receiver);
+    }
+
+    solution_free (&sol);
+    solution_free (&resolved);
+    vrp_free (&vrp);
+}
+
+
+// Compaction: cancelled requests and their nodes are removed, the rest are
+// renumbered consecutively in original order, and model still solves
+static void s_test_compact (void) {
+    vrp_arc_distance_t arc_distance = (vrp_arc_distance_t) vrp_arc_distance;
+    vrp_t *vrp = s_test_model (30, false);
+    size_t old_receivers[30];
+    for (size_t id = 0; id < 30; id++) {
+        old_receivers[id] = vrp_request_receiver (vrp, id);
+        if (id % 3 == 0)
+            assert (vrp_cancel_request (vrp, id) == 0);
+    }
+
+    listu_t *node_map = listu_new (0);
+    listu_t *request_map = listu_new (0);
+    assert (vrp_compact (vrp, node_map, request_map) == 21);
+    assert (vrp_num_nodes (vrp) == 21);
+    assert (vrp_num_requests (vrp) == 20);
+    assert (listu_size (node_map) == 31);
+    assert (listu_size (request_map) == 30);
+
+    size_t next_node = 1, next_request = 0;
+    assert (listu_get (node_map, 0) == 0); // depot
+    for (size_t id = 0; id < 30; id++) {
+        size_t new_node = listu_get (node_map, old_receivers[id]);
+        size_t new_request = listu_get (request_map, id);
+        if (id % 3 == 0) {
+            assert (new_node == ID_NONE);
+            assert (new_request == ID_NONE);
+            continue;
+        }
+        assert (new_node == next_node++);
+        assert (new_request == next_request++);
+        assert (vrp_request_receiver (vrp, new_request) == new_node);
+        char ext_id[32];
+        sprintf (ext_id, "node%zu", id);
+        assert (strcmp (vrp_node_ext_id (vrp, new_node), ext_id) == 0);
+        sprintf (ext_id, "request%zu", id);
+        assert (vrp_query_request (vrp, ext_id) == new_request);
+    }
+
+    solution_t *sol = vrp_solve (vrp);
+    s_test_check_served (vrp, sol);
+    assert (solution_total_distance (sol) ==
+            solution_cal_total_distance (sol, vrp, arc_distance));
+    solution_free (&sol);
+
+    // Nothing more to remove
+    assert (vrp_compact (vrp, node_map, NULL) == 21);
+    for (size_t id = 0; id < 21; id++)
+        assert (listu_get (node_map, id) == id);
+
+    listu_free (&node_map);
+    listu_free (&request_map);
+    vrp_free (&vrp);
+}
+
+
+// Matrix files: matrix should fit model, and storage mode is taken from file
+static void s_test_load_arcs (void) {
+    vrp_t *vrp = s_test_model (10, true);
+    const char *distance_file = "vrp-test-distances.tmp";
+    const char *duration_file = "vrp-test-durations.tmp";
+    assert (vrp_save_arc_distances (vrp, distance_file) == 0);
+    assert (vrp_save_arc_durations (vrp, duration_file) == 0);
+    double distance = vrp_arc_distance (vrp, 3, 7);
+    size_t duration = vrp_arc_duration (vrp, 7, 3);
+    vrp_free (&vrp);
+
+    // Symmetric storage of a model whose durations are stored in full
+    vrp_t *symmetric = vrp_new ();
+    vrp_set_coord_sys (symmetric, CS_CARTESIAN2D);
+    vrp_set_arc_storage (symmetric, false, true);
+    char ext_id[32];
+    for (size_t idx = 0; idx < 11; idx++) {
+        sprintf (ext_id, "node%zu", idx);
+        size_t node = vrp_add_node (symmetric, ext_id);
+        vrp_set_node_coord (symmetric, node, (coord2d_t) {idx, 2 * idx});
+    }
+    vrp_generate_beeline_distances (symmetric);
+    const char *symmetric_file = "vrp-test-symmetric.tmp";
+    assert (vrp_save_arc_distances (symmetric, symmetric_file) == 0);
+    vrp_free (&symmetric);
+
+    vrp = vrp_new ();
+    vrp_set_arc_storage (vrp, true, true);
+    for (size_t idx = 0; idx < 11; idx++) {
+        sprintf (ext_id, "node%zu", idx);
+        vrp_add_node (vrp, ext_id);
+    }
+    assert (vrp_load_arc_durations (vrp, duration_file) == 0);
+    assert (!vrp->symmetric_arcs);
+    assert (!vrp->compact_arcs);
+    assert (vrp_load_arc_distances (vrp, symmetric_file) == -1);
+    assert (vrp->distances == NULL);
+    assert (vrp_load_arc_distances (vrp, distance_file) == 0);
+    assert (vrp_arc_distance (vrp, 3, 7) == distance);
+    assert (vrp_arc_duration (vrp, 7, 3) == duration);
+    vrp_free (&vrp);
+
+    // Matrix does not cover all nodes
+    vrp = vrp_new ();
+    for (size_t idx = 0; idx < 12; idx++) {
+        sprintf (ext_id, "node%zu", idx);
+        vrp_add_node (vrp, ext_id);
+    }
+    assert (vrp_load_arc_distances (vrp, distance_file) == -1);
+    vrp_free (&vrp);
+
+    // Arcs on demand
+    vrp = vrp_new ();
+    vrp_set_coord_sys (vrp, CS_CARTESIAN2D);
+    vrp_set_on_demand_distances (vrp, 0);
+    assert (vrp_load_arc_distances (vrp, distance_file) == -1);
+    assert (vrp_load_arc_durations (vrp, duration_file) == -1);
+    vrp_free (&vrp);
+
+    remove (distance_file);
+    remove (duration_file);
+    remove (symmetric_file);
+}
+
+
+// Arcs set in on-demand mode override computed ones, without a matrix
+static void s_test_on_demand_overrides (void) {
+    vrp_t *vrp = vrp_new ();
+    vrp_set_coord_sys (vrp, CS_CARTESIAN2D);
+    vrp_set_on_demand_distances (vrp, 4);
+    for (size_t idx = 0; idx < 3; idx++) {
+        char ext_id[32];
+        sprintf (ext_id, "node%zu", idx);
+        size_t node = vrp_add_node (vrp, ext_id);
+        vrp_set_node_coord (vrp, node, (coord2d_t) {3 * idx, 4 * idx});
+    }
+    assert (vrp_arc_distance (vrp, 0, 1) == 5);
+
+    vrp_set_arc_distance (vrp, 0, 1, 9);
+    vrp_set_arc_duration (vrp, 0, 1, 12);
+    assert (vrp->distances == NULL);
+    assert (vrp->durations == NULL);
+    assert (vrp_arc_distance (vrp, 0, 1) == 9);
+    assert (vrp_arc_distance (vrp, 1, 0) == 5);
+    assert (vrp_arc_distance (vrp, 0, 2) == 10);
+    assert (vrp_arc_duration (vrp, 0, 1) == 12);
+
+    size_t from_ids[] = {1};
+    size_t to_ids[] = {2};
+    double distances[] = {7};
+    vrp_update_arcs (vrp, from_ids, to_ids, distances, NULL, 1);
+    assert (vrp->distances == NULL);
+    assert (vrp_arc_distance (vrp, 1, 2) == 7);
+    assert (vrp_arc_distance (vrp, 2, 1) == 5);
+
+    vrp_free (&vrp);
+}
+
+
+// Allocator hook counting live blocks in context
+static void *s_test_alloc (void *context, size_t size) {
+    (*(size_t *) context)++;
+    return malloc (size);
+}
+
+
+static void s_test_free (void *context, void *ptr) {
+    (*(size_t *) context)--;
+    free (ptr);
+}
+
+
+// Per-field arrays and spilled time windows are taken from allocator hook,
+// and all are given back
+static void s_test_allocator (void) {
+    size_t num_blocks = 0;
+    vrp_t *vrp = vrp_new ();
+    vrp_set_allocator (vrp, s_test_alloc, s_test_free, &num_blocks);
+    size_t depot = vrp_add_node (vrp, "depot");
+    size_t node = vrp_add_node (vrp, "node");
+    size_t requests[2];
+    requests[0] = vrp_add_request (vrp, "request0", depot, node, 1);
+    requests[1] = vrp_add_request (vrp, "request1", depot, node, 1);
+    size_t num_field_blocks = num_blocks;
+
+    // Four time windows do not fit inline
+    for (size_t idx = 0; idx < 4; idx++)
+        vrp_add_time_window (vrp, requests[0], NR_RECEIVER,
+                             100 * idx, 100 * idx + 10);
+    assert (num_blocks == num_field_blocks + 1);
+    assert (vrp_num_time_windows (vrp, requests[0], NR_RECEIVER) == 4);
+    assert (vrp_latest_service_time (vrp, requests[0], NR_RECEIVER) == 310);
+
+    // Released when request is compacted away
+    assert (vrp_cancel_request (vrp, requests[0]) == 0);
+    vrp_compact (vrp, NULL, NULL);
+    assert (num_blocks <= num_field_blocks);
+    for (size_t idx = 0; idx < 4; idx++)
+        vrp_add_time_window (vrp, 0, NR_SENDER, 100 * idx, 100 * idx + 10);
+
+    vrp_free (&vrp);
+    assert (num_blocks == 0);
+}
+
+
+// Nodes appended one by one: matrix storage grows geometrically, i.e. it is
+// reallocated O(log n) times
+static void s_test_append_nodes (void) {
+    vrp_t *vrp = s_test_model (5, false);
+    size_t old_size = arcmatrix_memory_size (vrp->distances);
+    size_t num_reallocs = 0;
+    char ext_id[32];
+    for (size_t idx = 0; idx < 500; idx++) {
+        sprintf (ext_id, "appended%zu", idx);
+        size_t node = vrp_add_node (vrp, ext_id);
+        vrp_set_node_coord (vrp, node,
+                            (coord2d_t) {idx % 100, (idx * 7) % 100});
+        vrp_generate_node_beeline_arcs (vrp, node);
+        size_t size = arcmatrix_memory_size (vrp->distances);
+        if (size != old_size)
+            num_reallocs++;
+        old_size = size;
+    }
+    assert (num_reallocs <= 8); // log2 (506 / 7) + 1
+    assert (vrp_arc_distance (vrp, 0, vrp_query_node (vrp, "appended0")) ==
+            71); // (50, 50) to (0, 0), rounded
+
+    vrp_free (&vrp);
+}
+
+
 // ---------------------------------------------------------------------------
 void vrp_test (bool verbose) {
     print_info (" * vrp: \n");
 
-    char filename[] =
-        "benchmark/cvrp/A-n32-k5.vrp";
-        // "benchmark/tsplib/tsp/berlin52.tsp";
-    // "benchmark/tsplib/tsp/a280.tsp";
-
+    // Small CVRP file in TSPLIB format. Vehicle number is read from "k2" of
+    // filename.
+    const char *filename = "vrp-test-k2.vrp";
+    s_test_write_file (filename,
+        "NAME : vrp-test-k2\n"
+        "TYPE : CVRP\n"
+        "DIMENSION : 7\n"
+        "EDGE_WEIGHT_TYPE : EUC_2D\n"
+        "CAPACITY : 40\n"
+        "NODE_COORD_SECTION\n"
+        " 1 50 50\n 2 20 20\n 3 80 20\n 4 20 80\n"
+        " 5 80 80\n 6 50 90\n 7 10 50\n"
+        "DEMAND_SECTION\n"
+        "1 0\n2 10\n3 12\n4 9\n5 14\n6 8\n7 5\n"
+        "DEPOT_SECTION\n"
+        " 1\n -1\n"
+        "EOF\n");
     vrp_t *vrp = vrp_new_from_file (filename);
+    remove (filename);
     assert (vrp);
 
     printf ("#nodes: %zu\n", vrp_num_nodes (vrp));
     printf ("#vehicles: %zu\n", vrp_num_vehicles (vrp));
+    assert (vrp_num_nodes (vrp) == 7);
+    assert (vrp_num_vehicles (vrp) == 2);
+    assert (vrp_num_requests (vrp) == 6);
+    assert (vrp_request_quantity (vrp, vrp_query_request (vrp, "node-0005"))
+            == 14);
+    assert (vrp_arc_distance (vrp, 0, 1) == 42); // sqrt (1800), rounded
+    assert (vrp_arc_distance (vrp, 6, 0) == 40);
 
     solution_t *sol = vrp_solve (vrp);
-    if (sol != NULL)
-        solution_print (sol);
+    assert (sol);
+    solution_print (sol);
+    s_test_check_served (vrp, sol);
+    solution_free (&sol);
+    vrp_free (&vrp);
+
+    s_test_bulk_add ();
+
+    s_test_solomon ();
+
+    s_test_tsplib ();
+
+    s_test_reevaluate ();
 
+    s_test_resolve ();
+
+    s_test_compact ();
+
+    s_test_on_demand_overrides ();
+
+    s_test_append_nodes ();
+
+    s_test_allocator ();
+
+    s_test_load_arcs ();
+
+    // Fixed route prefixes
+    vrp = s_test_model (40, false);
+    s_test_fixed_prefix (vrp);
     vrp_free (&vrp);
+    vrp = s_test_model (25, true);
+    s_test_fixed_prefix (vrp);
+    vrp_free (&vrp);
+    s_test_tsp_prefix (8);
+    s_test_tsp_prefix (70);
+
     print_info ("OK\n");
 }
@@ -59,12 +59,19 @@ For local search (in evolution or not), an auxiliary data structure is created
 along with the solution which records the time windows informations for
 acceleration purpose.
 
+A vehicle with fixed route prefix is represented by an anchor node: the
+current position of vehicle, with time window [departure time, departure time]
+and demand of the delivered quantity. Route of vehicle starts at its anchor
+instead of depot in warm start, and anchor is never moved. Prefix is restored
+for output.
+
 */
 
 #include "classes.h"
 
 
 #define SMALL_NUM_NODES 200
+#define NUM_WARM_START_PERTURBATIONS 4
 
 
 // Private node representation
@@ -72,8 +79,9 @@ typedef struct {
     size_t id; // node ID in roadgraph of generic model
     double demand;
     const coord2d_t *coord; // reference of node coords in roadgraph
-    const listu_t *time_windows; // reference of time windows in request
+    listu_t *time_windows; // copy of time windows in request
     size_t service_duration;
+    const listu_t *fixed_node_ids; // anchor: visited stops of vehicle
 } s_node_t;
 
 
@@ -83,7 +91,12 @@ struct _vrptw_t {
     size_t num_vehicles;
     size_t num_customers;
     s_node_t *nodes; // indices: depot: 0; customers: 1, 2, ..., num_customers
+                     // anchors: num_customers + 1, ..., + num_anchors
+    size_t num_anchors; // vehicles with fixed route prefix
+    size_t *sweep_order; // customers (index - 1) in ascending polar angle
+                         // around depot, or NULL until first sweep
     rng_t *rng;
+    arena_t *arena; // storage of genomes, routes, solutions and temporaries
 };
 
 
@@ -98,11 +111,25 @@ static double vrptw_arc_distance (const vrptw_t *self,
 }
 
 
+// Duration of arc departing at departure_time (durations may depend on it)
 static size_t vrptw_arc_duration (const vrptw_t *self,
-                                  size_t node1_idx, size_t node2_idx) {
-    return vrp_arc_duration (self->vrp,
-                             self->nodes[node1_idx].id,
-                             self->nodes[node2_idx].id);
+                                  size_t node1_idx, size_t node2_idx,
+                                  size_t departure_time) {
+    return vrp_arc_duration_at (self->vrp,
+                                self->nodes[node1_idx].id,
+                                self->nodes[node2_idx].id,
+                                departure_time);
+}
+
+
+// Latest departure time on arc to arrive no later than arrival_time
+static size_t vrptw_arc_latest_departure (const vrptw_t *self,
+                                          size_t node1_idx, size_t node2_idx,
+                                          size_t arrival_time) {
+    return vrp_arc_latest_departure (self->vrp,
+                                     self->nodes[node1_idx].id,
+                                     self->nodes[node2_idx].id,
+                                     arrival_time);
 }
 
 
@@ -197,7 +224,7 @@ static size_t vrptw_cal_service_time_by_arrival_time (const vrptw_t *self,
 // Transform VRPTW solution to giant tour representation
 static route_t *vrptw_giant_tour_from_solution (const vrptw_t *self,
                                                 const solution_t *sol) {
-    route_t *gtour = route_new (self->num_customers);
+    route_t *gtour = route_new_in_arena (self->arena, self->num_customers);
 
     solution_iterator_t iter = solution_iter_init (sol);
     size_t node;
@@ -238,7 +265,8 @@ static bool vrptw_solution_is_feasible (const vrptw_t *self,
             size_t last_node = node;
             node = route_at (route, idx_n);
             arrival_time = departure_time +
-                           vrptw_arc_duration (self, last_node, node);
+                           vrptw_arc_duration (self, last_node, node,
+                                               departure_time);
             if (arrival_time > vrptw_latest_service_time (self, node))
                 return false;
             service_time =
@@ -276,7 +304,8 @@ static void vrptw_print_solution (const vrptw_t *self, const solution_t *sol) {
             size_t last_node = node;
             node = route_at (route, idx_n);
             arrival_time =
-                departure_time + vrptw_arc_duration (self, last_node, node);
+                departure_time + vrptw_arc_duration (self, last_node, node,
+                                                     departure_time);
             service_time =
                 vrptw_cal_service_time_by_arrival_time (self,
                                                         node, arrival_time);
@@ -313,11 +342,13 @@ static solution_t *vrptw_split (const vrptw_t *self, const route_t *gtour) {
     size_t depot = 0;
 
     // Cost of the shortest path from node 0 to node (1 ~ N) in H
-    double *sp_costs = (double *) malloc ((N + 1) * sizeof (double));
+    double *sp_costs =
+        (double *) arena_alloc (self->arena, (N + 1) * sizeof (double));
     assert (sp_costs);
 
     // Predecessors of nodes on the shortest path
-    size_t *predecessors = (size_t *) malloc ((N + 1) * sizeof (size_t));
+    size_t *predecessors =
+        (size_t *) arena_alloc (self->arena, (N + 1) * sizeof (size_t));
     assert (predecessors);
 
     // Initialize
@@ -347,7 +378,8 @@ static solution_t *vrptw_split (const vrptw_t *self, const route_t *gtour) {
 
             // Compatibility of time windows
             size_t arrival_time = departure_time +
-                                  vrptw_arc_duration (self, last_node, node);
+                                  vrptw_arc_duration (self, last_node, node,
+                                                      departure_time);
             if (arrival_time > vrptw_latest_service_time (self, node))
                 break;
 
@@ -377,7 +409,7 @@ static solution_t *vrptw_split (const vrptw_t *self, const route_t *gtour) {
     }
 
     // Construct solution
-    solution_t *sol = solution_new (self->vrp);
+    solution_t *sol = solution_new_in_arena (self->arena);
     assert (sol);
 
     size_t j = N;
@@ -385,7 +417,7 @@ static solution_t *vrptw_split (const vrptw_t *self, const route_t *gtour) {
 
     while (i != SIZE_NONE) {
         // Add route: (depot, i+1, ..., j, depot)
-        route_t *route = route_new (2 + j - i);
+        route_t *route = route_new_in_arena (self->arena, 2 + j - i);
         assert (route);
         route_append_node (route, depot); // depot
         for (size_t k = i + 1; k <= j; k++)
@@ -401,8 +433,8 @@ static solution_t *vrptw_split (const vrptw_t *self, const route_t *gtour) {
     solution_set_total_distance (sol, sp_costs[N]);
     // assert (sp_costs[N] == solution_cal_set_total_distance (sol, self->vrp));
 
-    free (sp_costs);
-    free (predecessors);
+    arena_release (sp_costs);
+    arena_release (predecessors);
 
     assert (vrptw_solution_is_feasible (self, sol));
     return sol;
@@ -433,7 +465,8 @@ static size_t vrptw_cal_departure_time_by_predecessor (
                                             size_t predecessor,
                                             size_t departure_time_predecessor) {
     size_t arrival_time = departure_time_predecessor +
-                          vrptw_arc_duration (self, predecessor, node);
+                          vrptw_arc_duration (self, predecessor, node,
+                                              departure_time_predecessor);
     size_t service_time =
         vrptw_cal_service_time_by_arrival_time (self,
                                                 node, arrival_time);
@@ -454,9 +487,10 @@ static listu_t *vrptw_cal_subroute_tws_by_successor (
     if (latest_arrival_time_successor == SIZE_NONE)
         return listu_dup (self->nodes[node].time_windows);
 
-    size_t latest_service_time = latest_arrival_time_successor -
-                                 vrptw_arc_duration (self, node, successor) -
-                                 self->nodes[node].service_duration;
+    size_t latest_service_time =
+        vrptw_arc_latest_departure (self, node, successor,
+                                    latest_arrival_time_successor) -
+        self->nodes[node].service_duration;
     const listu_t *tws = self->nodes[node].time_windows;
 
     listu_t *subroute_tws = listu_new (2);
@@ -482,10 +516,12 @@ static listu_t *vrptw_cal_subroute_tws_by_successor (
 static s_meta_t *s_meta_new (const vrptw_t *vrptw, const solution_t *sol) {
     assert (sol);
 
-    s_meta_t *self = (s_meta_t *) malloc (sizeof (s_meta_t));
+    s_meta_t *self = (s_meta_t *) arena_alloc (vrptw->arena, sizeof (s_meta_t));
     assert (self);
     self->size = vrptw->num_customers + 1;
-    self->data = (s_meta_item_t *) malloc (sizeof (s_meta_t) * self->size);
+    self->data =
+        (s_meta_item_t *) arena_alloc (vrptw->arena,
+                                       sizeof (s_meta_item_t) * self->size);
     assert (self->data);
 
     s_meta_item_t *data = self->data;
@@ -537,7 +573,8 @@ static void s_meta_free (s_meta_t **meta_p) {
         s_meta_t *self = *meta_p;
         for (size_t idx = 0; idx < self->size; idx++)
             listu_free (&self->data[idx].subroute_tws);
-        free (self);
+        arena_release (self->data);
+        arena_release (self);
         *meta_p = NULL;
     }
 }
@@ -576,7 +613,8 @@ static bool s_meta_insert_node_is_feasible (const s_meta_t *self,
         return false;
 
     size_t arrival_time_at_successor =
-        departure_time_at_node + vrptw_arc_duration (vrptw, node, successor);
+        departure_time_at_node + vrptw_arc_duration (vrptw, node, successor,
+                                                     departure_time_at_node);
     size_t service_time_at_successor =
         service_time_by_arrival_time (self->data[successor].subroute_tws,
                                       arrival_time_at_successor);
@@ -705,7 +743,8 @@ static s_genome_t *s_genome_new (const vrptw_t *vrptw,
                                  route_t *gtour,
                                  solution_t *sol) {
     assert (gtour != NULL || sol != NULL);
-    s_genome_t *self = (s_genome_t *) malloc (sizeof (s_genome_t));
+    s_genome_t *self =
+        (s_genome_t *) arena_alloc (vrptw->arena, sizeof (s_genome_t));
     assert (self);
     self->gtour = gtour;
     self->sol = sol;
@@ -734,7 +773,7 @@ static void s_genome_free (s_genome_t **self_p) {
         route_free (&self->gtour);
         solution_free (&self->sol);
         s_meta_free (&self->meta);
-        free (self);
+        arena_release (self);
         *self_p = NULL;
     }
 }
@@ -846,7 +885,8 @@ static solution_t *vrptw_clark_wright_parallel (const vrptw_t *self,
         // Check compatibility of time windows
         size_t arrival_time =
             meta[last_visit].departure_time +
-            vrptw_arc_duration (self, last_visit, first_visit);
+            vrptw_arc_duration (self, last_visit, first_visit,
+                                meta[last_visit].departure_time);
         size_t latest_service_time =
             listu_last (meta[first_visit].subroute_tws);
         if (latest_service_time != SIZE_NONE &&
@@ -887,17 +927,18 @@ static solution_t *vrptw_clark_wright_parallel (const vrptw_t *self,
     }
 
     // Construct solution from predecessors and successors
-    solution_t *sol = solution_new (self->vrp);
+    solution_t *sol = solution_new_in_arena (self->arena);
     for (size_t idx = 1; idx <= N; idx++) {
         if (predecessors[idx] == 0) { // idx is first customer of a route
-            route_t *route = route_new (3); // a route has at least 3 nodes
-            route_append_node (route, self->nodes[0].id); // depot
+            // a route has at least 3 nodes
+            route_t *route = route_new_in_arena (self->arena, 3);
+            route_append_node (route, 0); // depot
             size_t successor = idx;
             while (successor != 0) {
-                route_append_node (route, self->nodes[successor].id);
+                route_append_node (route, successor);
                 successor = successors[successor];
             }
-            route_append_node (route, self->nodes[0].id); // depot
+            route_append_node (route, 0); // depot
             solution_append_route (sol, route);
         }
     }
@@ -917,17 +958,22 @@ static listx_t *vrptw_clark_wright (const vrptw_t *self, size_t num_expected) {
     listx_t *genomes = listx_new ();
     listu_t *hashes = listu_new (7);
 
-    size_t *predecessors = (size_t *) malloc (sizeof (size_t) * (N + 1));
+    size_t *predecessors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * (N + 1));
     assert (predecessors);
-    size_t *successors = (size_t *) malloc (sizeof (size_t) * (N + 1));
+    size_t *successors =
+        (size_t *) arena_alloc (self->arena, sizeof (size_t) * (N + 1));
     assert (successors);
-    double *route_demands = (double *) malloc (sizeof (double) * (N + 1));
+    double *route_demands =
+        (double *) arena_alloc (self->arena, sizeof (double) * (N + 1));
     assert (route_demands);
     s_cwsaving_t *savings =
-        (s_cwsaving_t *) malloc (sizeof (s_cwsaving_t) * N * (N - 1));
+        (s_cwsaving_t *) arena_alloc (self->arena,
+                                      sizeof (s_cwsaving_t) * N * (N - 1));
     assert (savings);
     s_meta_item_t *meta =
-        (s_meta_item_t *) malloc (sizeof (s_meta_item_t) * (N + 1));
+        (s_meta_item_t *) arena_alloc (self->arena,
+                                       sizeof (s_meta_item_t) * (N + 1));
     assert (meta);
 
     for (double lambda = 0.4; lambda <= 1.0; lambda += 0.1) {
@@ -959,13 +1005,13 @@ static listx_t *vrptw_clark_wright (const vrptw_t *self, size_t num_expected) {
     }
 
     listu_free (&hashes);
-    free (predecessors);
-    free (successors);
-    free (route_demands);
-    free (savings);
+    arena_release (predecessors);
+    arena_release (successors);
+    arena_release (route_demands);
+    arena_release (savings);
     for (size_t idx = 0; idx <= N; idx++)
         listu_free (&meta[idx].subroute_tws);
-    free (meta);
+    arena_release (meta);
 
     print_info ("generated: %zu\n", listx_size (genomes));
     return genomes;
@@ -975,7 +1021,7 @@ static listx_t *vrptw_clark_wright (const vrptw_t *self, size_t num_expected) {
 // Heuristics: giant tours constructed by sorting customers according to angle.
 // is_random: true
 // max_expected: self->num_customers
-static listx_t *vrptw_sweep_giant_tours (const vrptw_t *self,
+static listx_t *vrptw_sweep_giant_tours (vrptw_t *self,
                                          size_t num_expected) {
     print_info ("sweep giant tours starting ... (expected: %zu)\n",
                 num_expected);
@@ -989,27 +1035,33 @@ static listx_t *vrptw_sweep_giant_tours (const vrptw_t *self,
         return genomes;
     }
 
-    // Create giant tour template: nodes permutated in ascending angle order
-    coord2d_t *polars = (coord2d_t *) malloc (sizeof (coord2d_t) * N);
-    assert (polars);
-    for (size_t idx = 0; idx < N; idx++) {
-        if (coord2d_is_none (self->nodes[idx + 1].coord)) {
-            print_info ("Coordinates of nodes are not available.\n");
-            free (polars);
-            return genomes;
+    // Create giant tour template: nodes permutated in ascending angle order.
+    // Order is sorted on first call and cached.
+    if (self->sweep_order == NULL) {
+        const coord2d_t **coords =
+            (const coord2d_t **) arena_alloc (self->arena,
+                                              sizeof (coord2d_t *) * N);
+        assert (coords);
+        for (size_t idx = 0; idx < N; idx++) {
+            if (coord2d_is_none (self->nodes[idx + 1].coord)) {
+                print_info ("Coordinates of nodes are not available.\n");
+                arena_release (coords);
+                return genomes;
+            }
+            coords[idx] = self->nodes[idx + 1].coord;
         }
-        polars[idx] = coord2d_to_polar (self->nodes[idx + 1].coord,
-                                        self->nodes[0].coord,
-                                        vrp_coord_sys (self->vrp));
-        // Overwrite v1 with customer index
-        polars[idx].v1 = (double) (idx + 1);
+        self->sweep_order =
+            (size_t *) arena_alloc (self->arena, sizeof (size_t) * N);
+        assert (self->sweep_order);
+        coord2d_sort_by_polar_angle (coords, N, self->nodes[0].coord,
+                                     vrp_coord_sys (self->vrp),
+                                     self->sweep_order);
+        arena_release (coords);
     }
-    qsort (polars, N, sizeof (coord2d_t),
-           (comparator_t) coord2d_compare_polar_angle);
 
-    route_t *gtour_template = route_new (N);
+    route_t *gtour_template = route_new_in_arena (self->arena, N);
     for (size_t idx = 0; idx < N; idx++)
-        route_append_node (gtour_template, (size_t) polars[idx].v1);
+        route_append_node (gtour_template, self->sweep_order[idx] + 1);
 
     // Random rotation of template tour
     size_t random_num = rng_random_int (self->rng, 0, N);
@@ -1038,7 +1090,6 @@ static listx_t *vrptw_sweep_giant_tours (const vrptw_t *self,
     }
 
     print_info ("generated: %zu\n", listx_size (genomes));
-    free (polars);
     listu_free (&hashes);
     route_free (&gtour_template);
     return genomes;
@@ -1056,7 +1107,10 @@ static listx_t *vrptw_random_giant_tours (const vrptw_t *self,
     if (num_expected > max_expected)
         num_expected = max_expected;
 
-    route_t *gtour_template = route_new_range (1, self->num_customers, 1);
+    route_t *gtour_template =
+        route_new_in_arena (self->arena, self->num_customers);
+    for (size_t idx = 1; idx <= self->num_customers; idx++)
+        route_append_node (gtour_template, idx);
     listx_t *genomes = listx_new ();
     listu_t *hashes = listu_new (num_expected / 2 + 1);
 
@@ -1189,17 +1243,18 @@ static bool vrptw_is_basically_solvable (const vrptw_t *self) {
             return false;
         total_demands += self->nodes[idx].demand;
 
-        size_t arrival_time = vrptw_earliest_service_time (self, 0) +
-                              self->nodes[0].service_duration +
-                              vrptw_arc_duration (self, 0, idx);
+        size_t departure_time = vrptw_earliest_service_time (self, 0) +
+                                self->nodes[0].service_duration;
+        size_t arrival_time = departure_time +
+                              vrptw_arc_duration (self, 0, idx, departure_time);
         if (arrival_time > vrptw_latest_service_time (self, idx))
             return false;
 
         size_t service_time =
             vrptw_cal_service_time_by_arrival_time (self, idx, arrival_time);
-        size_t back_time = service_time +
-                           self->nodes[idx].service_duration +
-                           vrptw_arc_duration (self, idx, 0);
+        departure_time = service_time + self->nodes[idx].service_duration;
+        size_t back_time = departure_time +
+                           vrptw_arc_duration (self, idx, 0, departure_time);
         if (back_time > vrptw_latest_service_time (self, 0))
             return false;
 
@@ -1213,7 +1268,7 @@ static bool vrptw_is_basically_solvable (const vrptw_t *self) {
 
 // Small model solver.
 // Select best solution of constructive heuristics, and local search
-static solution_t *vrptw_solve_small_model (const vrptw_t *self) {
+static solution_t *vrptw_solve_small_model (vrptw_t *self) {
     print_info ("solve a small model...\n");
 
     double min_dist = DOUBLE_MAX;
@@ -1274,6 +1329,277 @@ static solution_t *vrptw_solve_small_model (const vrptw_t *self) {
 }
 
 
+// ----------------------------------------------------------------------------
+// Warm start
+
+// Check time windows of route with node inserted before idx_insert. Route is
+// checked as it is if node is ID_NONE.
+static bool vrptw_route_is_on_time (const vrptw_t *self,
+                                    const route_t *route,
+                                    size_t node,
+                                    size_t idx_insert) {
+    size_t size = route_size (route) + (node != ID_NONE ? 1 : 0);
+    size_t predecessor = route_at (route, 0);
+    size_t departure_time = vrptw_earliest_service_time (self, predecessor) +
+                            self->nodes[predecessor].service_duration;
+
+    for (size_t idx = 1; idx < size; idx++) {
+        size_t current = (node == ID_NONE || idx < idx_insert) ?
+                         route_at (route, idx) :
+                         (idx == idx_insert ? node : route_at (route, idx - 1));
+        departure_time =
+            vrptw_cal_departure_time_by_predecessor (self, current,
+                                                     predecessor,
+                                                     departure_time);
+        if (departure_time == SIZE_NONE)
+            return false;
+        predecessor = current;
+    }
+    return true;
+}
+
+
+// Insert customer node at cheapest feasible position, or in a new route if
+// there is no such position.
+// Return increase of total distance.
+static double vrptw_insert_cheapest (const vrptw_t *self, solution_t *sol,
+                                     size_t node) {
+    double demand = vrptw_node_demand (self, node);
+    route_t *best_route = NULL;
+    size_t best_idx = 0;
+    double best_dcost = DOUBLE_MAX;
+
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        route_t *route = solution_route (sol, idx_r);
+        if (vrptw_route_demand (self, route) + demand > self->capacity)
+            continue;
+        for (size_t idx = 1; idx < route_size (route); idx++) {
+            double dcost =
+                route_insert_node_delta_distance (route, idx, node,
+                                                  self,
+                                                  (vrp_arc_distance_t) vrptw_arc_distance);
+            if (dcost < best_dcost &&
+                vrptw_route_is_on_time (self, route, node, idx)) {
+                best_dcost = dcost;
+                best_route = route;
+                best_idx = idx;
+            }
+        }
+    }
+
+    if (best_route != NULL) {
+        route_insert_node (best_route, best_idx, node);
+        return best_dcost;
+    }
+
+    route_t *route = route_new (3);
+    route_append_node (route, 0);
+    route_append_node (route, node);
+    route_append_node (route, 0);
+    solution_append_route (sol, route);
+    return vrptw_arc_distance (self, 0, node) +
+           vrptw_arc_distance (self, node, 0);
+}
+
+
+// Local search: move each customer to its cheapest feasible position until
+// no move improves.
+// Return saving.
+static double vrptw_relocate_nodes (const vrptw_t *self, solution_t *sol) {
+    double saving = 0;
+    bool improved = true;
+
+    while (improved) {
+        improved = false;
+        for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+            route_t *route = solution_route (sol, idx_r);
+            for (size_t idx = 1; idx + 1 < route_size (route); idx++) {
+                size_t node = route_at (route, idx);
+                double dcost_remove =
+                    route_remove_node_delta_distance (
+                                    route, idx,
+                                    self,
+                                    (vrp_arc_distance_t) vrptw_arc_distance);
+                route_remove_node (route, idx);
+
+                // Original position is a candidate, so node is moved only if
+                // it is cheaper elsewhere
+                double dcost = dcost_remove +
+                               vrptw_insert_cheapest (self, sol, node);
+                saving -= dcost;
+                if (dcost < -1e-9)
+                    improved = true;
+
+                if (route_size (route) == 2 && route_at (route, 0) == 0) {
+                    solution_remove_route (sol, idx_r--);
+                    break;
+                }
+            }
+        }
+    }
+
+    solution_increase_total_distance (sol, -saving);
+    return saving;
+}
+
+
+// Repair previous solution (of generic node IDs) for current customers:
+// cancelled customers are removed, and new ones are inserted by cheapest
+// feasible insertion. Route of vehicle with fixed prefix starts at its anchor,
+// and keeps only customers after it. Returned solution is of inner node
+// indices.
+static solution_t *vrptw_repair_solution (const vrptw_t *self,
+                                          const solution_t *previous) {
+    // Inner index of generic node ID, or SIZE_NONE if node is not a customer
+    // or an anchor
+    size_t num_nodes = self->num_customers + self->num_anchors + 1;
+    size_t max_id = self->nodes[0].id;
+    for (size_t idx = 1; idx < num_nodes; idx++)
+        max_id = max2 (max_id, self->nodes[idx].id);
+    size_t *inner_idx =
+        (size_t *) arena_alloc (self->arena, (max_id + 1) * sizeof (size_t));
+    bool *planned =
+        (bool *) arena_alloc (self->arena, num_nodes * sizeof (bool));
+    assert (inner_idx && planned);
+    for (size_t id = 0; id <= max_id; id++)
+        inner_idx[id] = SIZE_NONE;
+    for (size_t idx = 1; idx < num_nodes; idx++) {
+        inner_idx[self->nodes[idx].id] = idx;
+        planned[idx] = false;
+    }
+
+    solution_t *sol = solution_new ();
+    assert (sol);
+    for (size_t idx_r = 0; idx_r < solution_num_routes (previous); idx_r++) {
+        const route_t *prev_route = solution_route (previous, idx_r);
+        route_t *route = route_new (route_size (prev_route) + 2);
+        route_append_node (route, 0);
+        for (size_t idx = 0; idx < route_size (prev_route); idx++) {
+            size_t id = route_at (prev_route, idx);
+            size_t node = (id <= max_id) ? inner_idx[id] : SIZE_NONE;
+            if (node == SIZE_NONE || planned[node])
+                continue;
+            if (node > self->num_customers) {
+                // Anchor: stops before it are executed or left to insertion
+                for (size_t k = 1; k < route_size (route); k++)
+                    planned[route_at (route, k)] = false;
+                route_free (&route);
+                route = route_new (route_size (prev_route) + 1);
+            }
+            route_append_node (route, node);
+            planned[node] = true;
+        }
+        route_append_node (route, 0);
+
+        // Previous route may be broken by changed quantities or time windows
+        bool anchored = (route_at (route, 0) != 0);
+        if ((route_size (route) > 2 || anchored) &&
+            vrptw_route_demand (self, route) <= self->capacity &&
+            vrptw_route_is_on_time (self, route, ID_NONE, 0))
+            solution_append_route (sol, route);
+        else {
+            for (size_t idx = 0; idx + 1 < route_size (route); idx++)
+                planned[route_at (route, idx)] = false;
+            route_free (&route);
+        }
+    }
+
+    // Vehicles with fixed prefix not found in previous solution
+    for (size_t node = self->num_customers + 1; node < num_nodes; node++) {
+        if (!planned[node]) {
+            route_t *route = route_new (2);
+            route_append_node (route, node);
+            route_append_node (route, 0);
+            solution_append_route (sol, route);
+        }
+    }
+
+    for (size_t node = 1; node <= self->num_customers; node++) {
+        if (!planned[node])
+            vrptw_insert_cheapest (self, sol, node);
+    }
+    arena_release (inner_idx);
+    arena_release (planned);
+
+    solution_cal_set_total_distance (sol,
+                                     self,
+                                     (vrp_arc_distance_t) vrptw_arc_distance);
+    return sol;
+}
+
+
+// Perturbation of solution: remove a few random customers and insert them
+// back by cheapest feasible insertion
+static solution_t *vrptw_perturb_solution (const vrptw_t *self,
+                                           const solution_t *sol) {
+    solution_t *perturbed = solution_dup (sol);
+    size_t num_removed = max2 (2, self->num_customers / 10);
+    listu_t *removed = listu_new (num_removed);
+
+    for (size_t cnt = 0; cnt < num_removed; cnt++) {
+        if (solution_num_routes (perturbed) == 0)
+            break;
+        size_t idx_r = rng_random_int (self->rng, 0,
+                                       solution_num_routes (perturbed));
+        route_t *route = solution_route (perturbed, idx_r);
+        if (route_size (route) == 2) // anchor route without customers
+            continue;
+        size_t idx = rng_random_int (self->rng, 1, route_size (route) - 1);
+        listu_append (removed, route_at (route, idx));
+        route_remove_node (route, idx);
+        if (route_size (route) == 2 && route_at (route, 0) == 0)
+            solution_remove_route (perturbed, idx_r);
+    }
+
+    for (size_t idx = 0; idx < listu_size (removed); idx++)
+        vrptw_insert_cheapest (self, perturbed, listu_get (removed, idx));
+    listu_free (&removed);
+
+    solution_cal_set_total_distance (perturbed,
+                                     self,
+                                     (vrp_arc_distance_t) vrptw_arc_distance);
+    return perturbed;
+}
+
+
+// Transform solution of inner node indices to generic node IDs. Depot and
+// the fixed prefix are restored before anchor.
+static void vrptw_solution_to_generic (const vrptw_t *self, solution_t *sol) {
+    for (size_t idx_r = 0; idx_r < solution_num_routes (sol); idx_r++) {
+        route_t *route = solution_route (sol, idx_r);
+        size_t first = route_at (route, 0);
+        for (size_t idx = 0; idx < route_size (route); idx++)
+            route_set_at (route, idx, self->nodes[route_at (route, idx)].id);
+
+        if (first != 0) {
+            const listu_t *prefix = self->nodes[first].fixed_node_ids;
+            route_insert_node (route, 0, self->nodes[0].id);
+            for (size_t idx = 0; idx + 1 < listu_size (prefix); idx++)
+                route_insert_node (route, idx + 1, listu_get (prefix, idx));
+        }
+    }
+    solution_cal_set_total_distance (sol,
+                                     self->vrp,
+                                     (vrp_arc_distance_t) vrp_arc_distance);
+}
+
+
+// ----------------------------------------------------------------------------
+
+// Sorted list of time windows of request node in generic model
+static listu_t *s_time_windows_copy (vrp_t *vrp,
+                                     size_t request_id,
+                                     node_role_t node_role) {
+    listu_t *tws =
+        listu_new_from_array (vrp_time_windows (vrp, request_id, node_role),
+                              2 * vrp_num_time_windows (vrp, request_id,
+                                                        node_role));
+    assert (tws);
+    listu_sort (tws, true);
+    return tws;
+}
+
+
 vrptw_t *vrptw_new_from_generic (vrp_t *vrp) {
     assert (vrp);
 
@@ -1281,18 +1607,23 @@ vrptw_t *vrptw_new_from_generic (vrp_t *vrp) {
     assert (self);
 
     self->vrp = vrp;
+    self->arena = vrp_new_arena (vrp);
 
     self->num_vehicles = vrp_num_vehicles (vrp);
 
     size_t one_vehicle = listu_get (vrp_vehicles (vrp), 0);
     self->capacity = vrp_vehicle_capacity (vrp, one_vehicle);
 
-    const listu_t *requests = vrp_pending_request_ids (vrp);
+    // Customers: pending requests merged by vrp_solve ()
+    const listu_t *requests = vrp_customer_request_ids (vrp);
     size_t num_requests = listu_size (requests);
     assert (num_requests > 0);
 
     self->nodes =
-        (s_node_t *) malloc (sizeof (s_node_t) * (vrp_num_receivers (vrp) + 1));
+        (s_node_t *) arena_alloc (self->arena,
+                                  sizeof (s_node_t) *
+                                  (num_requests + 1 +
+                                   vrp_num_fixed_vehicles (vrp)));
     assert (self->nodes);
     self->nodes[0].id = ID_NONE;
     self->num_customers = num_requests;
@@ -1310,24 +1641,49 @@ vrptw_t *vrptw_new_from_generic (vrp_t *vrp) {
             self->nodes[0].demand = 0;
             self->nodes[0].coord = vrp_node_coord (vrp, self->nodes[0].id);
             self->nodes[0].time_windows =
-                vrp_time_windows (vrp, request, NR_SENDER);
+                s_time_windows_copy (vrp, request, NR_SENDER);
             self->nodes[0].service_duration =
                 vrp_service_duration (vrp, request, NR_SENDER);
+            self->nodes[0].fixed_node_ids = NULL;
         }
         assert (self->nodes[0].id == vrp_request_sender (vrp, request));
 
         // receivers, or customers
         self->nodes[idx+1].id = vrp_request_receiver (vrp, request);
-        self->nodes[idx+1].demand = vrp_request_quantity (vrp, request);
+        self->nodes[idx+1].demand = vrp_customer_quantity (vrp, request);
         self->nodes[idx+1].coord =
             vrp_node_coord (vrp, self->nodes[idx+1].id);
         self->nodes[idx+1].time_windows =
-            vrp_time_windows (vrp, request, NR_RECEIVER);
+            s_time_windows_copy (vrp, request, NR_RECEIVER);
         self->nodes[idx+1].service_duration =
-                vrp_service_duration (vrp, request, NR_RECEIVER);
+                vrp_customer_service_duration (vrp, request);
+        self->nodes[idx+1].fixed_node_ids = NULL;
         // printf ("customer added: %zu\n", self->nodes[idx+1].id);
     }
 
+    // anchors of vehicles with fixed route prefix
+    self->num_anchors = 0;
+    const listu_t *vehicles = vrp_vehicles (vrp);
+    for (size_t idx = 0; idx < listu_size (vehicles); idx++) {
+        size_t vehicle = listu_get (vehicles, idx);
+        const listu_t *prefix = vrp_vehicle_fixed_node_ids (vrp, vehicle);
+        if (prefix == NULL)
+            continue;
+        s_node_t *anchor =
+            &self->nodes[self->num_customers + 1 + self->num_anchors++];
+        anchor->id = listu_last (prefix);
+        anchor->demand = vrp_vehicle_fixed_quantity (vrp, vehicle);
+        anchor->coord = vrp_node_coord (vrp, anchor->id);
+        size_t departure_time = vrp_vehicle_departure_time (vrp, vehicle);
+        listu_t *tws = listu_new (2);
+        listu_append (tws, departure_time);
+        listu_append (tws, departure_time);
+        anchor->time_windows = tws;
+        anchor->service_duration = 0;
+        anchor->fixed_node_ids = prefix;
+    }
+
+    self->sweep_order = NULL;
     self->rng = rng_new ();
     return self;
 }
@@ -1337,8 +1693,12 @@ void vrptw_free (vrptw_t **self_p) {
     assert (self_p);
     if (*self_p) {
         vrptw_t *self = *self_p;
-        free (self->nodes);
+        for (size_t idx = 0;
+             idx <= self->num_customers + self->num_anchors;
+             idx++)
+            listu_free (&self->nodes[idx].time_windows);
         rng_free (&self->rng);
+        arena_free (&self->arena); // nodes and all other objects in arena
         free (self);
         *self_p = NULL;
     }
@@ -1353,10 +1713,44 @@ solution_t *vrptw_solve (vrptw_t *self) {
         return NULL;
 
     // Deal with small numboer of nodes
-    if (self->num_customers <= SMALL_NUM_NODES)
-        return vrptw_solve_small_model (self);
+    if (self->num_customers > SMALL_NUM_NODES)
+        return NULL;
+
+    solution_t *sol = vrptw_solve_small_model (self);
+    vrptw_solution_to_generic (self, sol);
+    return sol;
+}
 
-    return NULL;
+
+solution_t *vrptw_resolve (vrptw_t *self, const solution_t *previous) {
+    assert (self);
+    assert (previous);
+
+    if (!vrptw_is_basically_solvable (self))
+        return NULL;
+
+    solution_t *sol = vrptw_repair_solution (self, previous);
+    vrptw_relocate_nodes (self, sol);
+
+    // Local search from perturbations of repaired plan
+    for (size_t cnt = 0; cnt < NUM_WARM_START_PERTURBATIONS; cnt++) {
+        solution_t *candidate = vrptw_perturb_solution (self, sol);
+        vrptw_relocate_nodes (self, candidate);
+        if (solution_num_routes (candidate) < solution_num_routes (sol) ||
+            (solution_num_routes (candidate) == solution_num_routes (sol) &&
+             solution_total_distance (candidate) <
+             solution_total_distance (sol))) {
+            solution_free (&sol);
+            sol = candidate;
+        }
+        else
+            solution_free (&candidate);
+    }
+
+    assert (vrptw_solution_is_feasible (self, sol));
+    vrptw_print_solution (self, sol);
+    vrptw_solution_to_generic (self, sol);
+    return sol;
 }
 
 
@@ -25,6 +25,10 @@ void vrptw_free (vrptw_t **self_p);
 // Solve
 solution_t *vrptw_solve (vrptw_t *self);
 
+// Solve starting from previous solution (with generic node IDs) of model
+// before requests were added or cancelled
+solution_t *vrptw_resolve (vrptw_t *self, const solution_t *previous);
+
 // Self test
 void vrptw_test (bool verbose);
 